@@ -0,0 +1,54 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: aligned.cpp - Aligned heap allocation helpers
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L //exposes posix_memalign() under -ansi
+#endif
+
+#include "aligned.h"
+#include <cstdlib> //used for posix_memalign(), free(), exit() and EXIT_FAILURE
+#include <cstdio> //used for printf()
+#include <cstring> //used for memset()
+#ifdef _WIN32
+#include <malloc.h> //used for _aligned_malloc(), _aligned_free()
+#endif
+
+/* allocates a zero-filled block of count floats aligned to ALIGNMENT bytes. Exits on failure
+ */
+float *alignedAllocFloats(size_t count)
+{
+   void *block = 0;
+   size_t bytes = (count ? count : 1)*sizeof(float);
+#ifdef _WIN32
+   block = _aligned_malloc(bytes, ALIGNMENT);
+#else
+   if(posix_memalign(&block, ALIGNMENT, bytes)) block = 0;
+#endif
+   if(!block){
+      printf("Unable to allocate %lu bytes\n", (unsigned long)bytes);
+      exit(EXIT_FAILURE);
+   }
+   memset(block, 0, bytes);
+   return static_cast<float*>(block);
+}
+
+/* frees a block returned by alignedAllocFloats()
+ */
+void alignedFree(void *block)
+{
+#ifdef _WIN32
+   _aligned_free(block);
+#else
+   free(block);
+#endif
+}
@@ -0,0 +1,35 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: aligned.h - Aligned heap allocation helpers
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef ALIGNED_H
+#define ALIGNED_H
+
+#include <cstddef> //used for size_t
+
+//::CONSTANTS:://
+//alignment in bytes of every block returned by alignedAlloc(). Wide enough for 256-bit vector loads
+const size_t ALIGNMENT = 32;
+//number of floats in one ALIGNMENT-sized block
+const int ALIGNED_FLOATS = ALIGNMENT/sizeof(float);
+
+//allocates a zero-filled block of count floats aligned to ALIGNMENT bytes. Exits on failure
+float *alignedAllocFloats(size_t count);
+//frees a block returned by alignedAllocFloats()
+void alignedFree(void *block);
+//rounds count up to the next multiple of ALIGNED_FLOATS
+inline int alignedCount(int count)
+{
+   return (count + ALIGNED_FLOATS-1)/ALIGNED_FLOATS*ALIGNED_FLOATS;
+}
+
+#endif // ALIGNED_H
@@ -0,0 +1,193 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: batchlanes.h - The loops over the lanes of a SkirtBatch pack
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef BATCHLANES_H
+#define BATCHLANES_H
+
+#include "skirtbatch.h"
+#include <cmath> //used for sqrt(), fabs()
+#include <cfloat> //used for FLT_MIN
+
+/* The loops that step one pack of a SkirtBatch. Each runs across the LANES instances of a vertex
+ * or spring, so it vectorizes to whatever width the including source is compiled for:
+ * skirtbatch.cpp compiles them for the baseline instruction set and skirtbatch_avx2.cpp for AVX2.
+ * Neither contracts to FMA, so both sets give results bit-identical to the scalar Skirt.
+ * The buffers passed are those of one pack, whose x, y and z planes are plane floats apart.
+ * A lane loop of only LANES trips is otherwise unrolled before the loop vectorizer sees it and the
+ * straight-line code left only partly vectorized, so the loops that need it are kept rolled
+ */
+
+/* accumulates the force of springs [begin, end) into both endpoints for every lane: the force on a
+ * into forceA and the force on b into forceB, as scalarSpringForces(). The pulls of all lanes are
+ * computed before any force is added, so forceA and forceB may be the same buffer
+ */
+static void addLaneSpringForces(const SpringArray &springs, int begin, int end, int plane,
+                                const GLfloat *position, GLfloat *forceA, GLfloat *forceB)
+{
+   const int L = SkirtBatch::LANES;
+   
+   for(int s = begin; s < end; s++){
+      const GLfloat *__restrict__ a = position + springs.a[s]*L;
+      const GLfloat *__restrict__ b = position + springs.b[s]*L;
+      const float rest = springs.rest[s], ksA = springs.ksA[s], ksB = springs.ksB[s];
+      float ux[L], uy[L], uz[L];
+      for(int l = 0; l < L; l++){
+         float dx = a[l] - b[l], dy = a[plane+l] - b[plane+l], dz = a[2*plane+l] - b[2*plane+l];
+         float lengthSq = dx*dx + dy*dy + dz*dz, length = std::sqrt(lengthSq);
+         float stretch = (length - rest)/lengthSq;
+         //signed squared components of a (unit) pull from a toward b
+         ux[l] = dx*std::fabs(dx)*stretch;
+         uy[l] = dy*std::fabs(dy)*stretch;
+         uz[l] = dz*std::fabs(dz)*stretch;
+      }
+      //the planes of a vertex never overlap
+      GLfloat *fa = forceA + springs.a[s]*L, *fb = forceB + springs.b[s]*L;
+#pragma GCC ivdep
+#pragma GCC unroll 1
+      for(int l = 0; l < L; l++){
+         fa[l] -= ksA*ux[l];
+         fa[plane+l] -= ksA*uy[l];
+         fa[2*plane+l] -= ksA*uz[l];
+      }
+#pragma GCC ivdep
+#pragma GCC unroll 1
+      for(int l = 0; l < L; l++){
+         fb[l] += ksB*ux[l];
+         fb[plane+l] += ksB*uy[l];
+         fb[2*plane+l] += ksB*uz[l];
+      }
+   }
+}
+
+/* accumulates the force of the springs into a pack, as Skirt::calcSpringForces(): the springs of
+ * each row in turn, those on the row below into forceBelow
+ */
+static void laneSpringForces(const SpringArray &springs, int xRes, int yRes,
+                             const GLfloat *position, GLfloat *force, GLfloat *forceBelow)
+{
+   const int plane = xRes*yRes*SkirtBatch::LANES;
+   
+   for(int k = 0; k < 3*plane; k++) force[k] = forceBelow[k] = 0;
+   for(int j = 1; j < yRes; j++){
+      addLaneSpringForces(springs, springs.rowStart[j], springs.crossStart[j], plane, position,
+                          force, force);
+      addLaneSpringForces(springs, springs.crossStart[j], springs.rowStart[j+1], plane, position,
+                          force, forceBelow);
+   }
+}
+
+/* integrates the velocities and then the positions of the free rows of a pack by steps hv and hp,
+ * as scalarIntegrateVelocity() and scalarIntegratePosition() with the damping of each row in rowKd
+ */
+static void laneIntegrate(GLfloat *position, GLfloat *velocity, const GLfloat *force,
+                          const GLfloat *forceBelow, const GLfloat *rowKd, int xRes, int yRes,
+                          float hv, float hp, float gravity)
+{
+   const int rowSize = xRes*SkirtBatch::LANES, plane = yRes*rowSize;
+   const GLfloat hg = hv*gravity;
+   
+   for(int c = 0; c < 3; c++){
+      GLfloat *__restrict__ pos = position + c*plane;
+      GLfloat *__restrict__ vel = velocity + c*plane;
+      const GLfloat *__restrict__ f = force + c*plane;
+      const GLfloat *__restrict__ fb = forceBelow + c*plane;
+      for(int j = 2; j < yRes; j++){
+         const GLfloat kd = rowKd[j];
+         for(int k = j*rowSize; k < (j+1)*rowSize; k++){
+            //Velocity Update: Spring Forces
+            vel[k] += hv*(f[k] + fb[k]);
+            //Velocity Update: Gravity
+            if(c == 1) vel[k] += hg;
+            //Velocity Update: Spring Damping
+            vel[k] -= kd*vel[k];
+         }
+      }
+      for(int k = 2*rowSize; k < plane; k++)
+         pos[k] += hp*vel[k];
+   }
+}
+
+/* writes the unit normals of every lane of vertex v from the positions of its neighbours at
+ * v+left, v+right, v+up and v+down, as scalarVertexNormal()
+ */
+static inline void laneVertexNormal(const GLfloat *position, GLfloat *normals, int plane, int v,
+                                    int left, int right, int up, int down, bool hasAbove,
+                                    bool hasBelow)
+{
+   const int L = SkirtBatch::LANES;
+   const GLfloat *__restrict__ px = position + v*L, *__restrict__ py = px + plane;
+   const GLfloat *__restrict__ pz = px + 2*plane;
+   GLfloat *__restrict__ nx = normals + v*L, *__restrict__ ny = nx + plane;
+   GLfloat *__restrict__ nz = nx + 2*plane;
+   const int l0 = left*L, r0 = right*L, u0 = up*L, ul0 = (up+left)*L, d0 = down*L;
+   const int dr0 = (down+right)*L;
+   float sx[L], sy[L], sz[L], lengthSq[L];
+   
+   for(int l = 0; l < L; l++) sx[l] = sy[l] = sz[l] = 0;
+   //the rows above and below are tested once for all lanes, so each loop runs straight through
+   if(hasBelow){
+      for(int l = 0; l < L; l++){
+         float lx = px[l0+l] - px[l], ly = py[l0+l] - py[l], lz = pz[l0+l] - pz[l];
+         float rx = px[r0+l] - px[l], ry = py[r0+l] - py[l], rz = pz[r0+l] - pz[l];
+         float dx = px[d0+l] - px[l], dy = py[d0+l] - py[l], dz = pz[d0+l] - pz[l];
+         float ex = px[dr0+l] - px[l], ey = py[dr0+l] - py[l], ez = pz[dr0+l] - pz[l];
+         float fx = dx - rx, fy = dy - ry, fz = dz - rz;
+         sx[l] += (ey*fz - ez*fy) + (dy*lz - dz*ly);
+         sy[l] += (ez*fx - ex*fz) + (dz*lx - dx*lz);
+         sz[l] += (ex*fy - ey*fx) + (dx*ly - dy*lx);
+      }
+   }
+   if(hasAbove){
+      for(int l = 0; l < L; l++){
+         float lx = px[l0+l] - px[l], ly = py[l0+l] - py[l], lz = pz[l0+l] - pz[l];
+         float rx = px[r0+l] - px[l], ry = py[r0+l] - py[l], rz = pz[r0+l] - pz[l];
+         float ux = px[u0+l] - px[l], uy = py[u0+l] - py[l], uz = pz[u0+l] - pz[l];
+         float ex = px[ul0+l] - px[l], ey = py[ul0+l] - py[l], ez = pz[ul0+l] - pz[l];
+         float fx = ux - lx, fy = uy - ly, fz = uz - lz;
+         sx[l] += (ey*fz - ez*fy) + (uy*rz - uz*ry);
+         sy[l] += (ez*fx - ex*fz) + (uz*rx - ux*rz);
+         sz[l] += (ex*fy - ey*fx) + (ux*ry - uy*rx);
+      }
+   }
+   //clamped in a loop of its own, as the vectorizer gives up on a select in a loop with sqrt()
+#pragma GCC unroll 1
+   for(int l = 0; l < L; l++){
+      float sum = sx[l]*sx[l] + sy[l]*sy[l] + sz[l]*sz[l];
+      lengthSq[l] = (sum > FLT_MIN) ? sum : FLT_MIN;
+   }
+#pragma GCC unroll 1
+   for(int l = 0; l < L; l++){
+      float inverse = 1/std::sqrt(lengthSq[l]);
+      nx[l] = sx[l]*inverse;
+      ny[l] = sy[l]*inverse;
+      nz[l] = sz[l]*inverse;
+   }
+}
+
+/* calculates the unit vertex normals of a pack. Columns 0 and xRes-1 find one neighbour across
+ * the seam
+ */
+static void laneNormals(const GLfloat *position, GLfloat *normals, int xRes, int yRes)
+{
+   const int plane = xRes*yRes*SkirtBatch::LANES;
+   
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         int left = (i == 0) ? xRes-1 : -1, right = (i == xRes-1) ? 1-xRes : 1;
+         laneVertexNormal(position, normals, plane, j*xRes + i, left, right, -xRes, xRes, j > 0,
+                          j < yRes-1);
+      }
+   }
+}
+
+#endif // BATCHLANES_H
@@ -0,0 +1,593 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: bench.cpp - The benchmark suite; times the simulation phase by phase and step by step
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "quaternion.h"
+#include "texturecache.h"
+#include "mappedfile.h"
+#include "timer.h"
+#include <cstdlib> //used for atoi(), atof(), strtod(), EXIT_SUCCESS, EXIT_FAILURE
+#include <cstdio> //used for printf(), fprintf(), sprintf(), fopen(), fclose()
+#include <cstring> //used for strcmp(), strstr(), strncpy(), strcat() and the other string functions
+#include <ctime> //used for time()
+
+//Global Constants
+//the resolutions swept: the stock skirt, and the others SkirtT is built for
+const int RESOLUTIONS[][2] = { {120, 18}, {240, 36}, {256, 256} };
+const int RESOLUTION_COUNT = 3;
+//the motion the skirt is timed in, and the explicit steps it runs into that motion first
+const float AMPLITUDE = 20, FREQUENCY = 0.05f;
+const int WARMUP_STEPS = 400;
+//each measurement is the fastest of REPEATS runs, each of at least 1/REPEATS of the time given
+const int REPEATS = 5;
+const double DEFAULT_SECONDS = 0.25, DEFAULT_THRESHOLD = 10;
+const char *DEFAULT_OUTPUT = "bench.json", *DEFAULT_IMAGE = "assets/skirt_texture.ppm";
+//the most results a run, or a baseline, holds
+const int MAX_RESULTS = 256;
+//the versors the Quaternion benchmarks cycle through, and the points one rotatePoints() call turns
+const int VERSORS = 64, ROTATED_POINTS = 1024;
+
+/* A workload to time. run() makes the given number of calls of what is measured; reset() puts
+ * back, untimed, the state the calls start from
+ */
+class Benchmark
+{
+public:
+   virtual ~Benchmark() {}
+   virtual void reset() {}
+   virtual void run(long calls) = 0;
+};
+
+/* Times the phases of a step of a Skirt, or its whole step, from the state it was in when the
+ * SkirtBench was made. A friend of Skirt
+ */
+class SkirtBench : public Benchmark
+{
+public:
+   enum Phase { OSCILLATION, VELOCITY, POSITION, NORMALS, NORMALS_AIR, STEP };
+   
+   //constructor. Keeps the state of the skirt for reset()
+   SkirtBench(Skirt &skirt);
+   //destructor
+   ~SkirtBench();
+   void setPhase(Phase timed) { phase = timed; }
+   void reset();
+   void run(long calls);
+   
+private:
+   Skirt &skirt;
+   Phase phase;
+   VectorArray position, velocity, normals;
+   GLfloat theta;
+   
+   //not copyable
+   SkirtBench(const SkirtBench &);
+   SkirtBench& operator=(const SkirtBench &);
+};
+
+/* Times an operation of the Quaternion class on a cycle of versors
+ */
+class QuaternionBench : public Benchmark
+{
+public:
+   enum Operation { MULTIPLY, ADD, INVERSE, NORMALIZE, TO_MATRIX, SLERP, ROTATE_POINTS };
+   
+   //constructor
+   QuaternionBench();
+   void setOperation(Operation timed) { operation = timed; }
+   void run(long calls);
+   
+private:
+   Operation operation;
+   Quaternion versors[VERSORS];
+   float x[ROTATED_POINTS], y[ROTATED_POINTS], z[ROTATED_POINTS];
+   float rotX[ROTATED_POINTS], rotY[ROTATED_POINTS], rotZ[ROTATED_POINTS];
+   //where the results go, so they are not optimized away
+   volatile float sink;
+};
+
+/* Times the CPU side of loading the skirt texture: reading the PPM image, building its mip chain,
+ * or mapping the mip chain from its cache
+ */
+class TextureBench : public Benchmark
+{
+public:
+   enum Stage { READ, MIPMAP, MAP };
+   
+   //constructor. Reads the image at path and makes sure its cache at cachePath is built; check
+   //isLoaded()
+   TextureBench(const char *path, const char *cachePath);
+   //destructor
+   ~TextureBench();
+   bool isLoaded() const { return image != 0; }
+   int getPixels() const { return width*height; }
+   void setStage(Stage timed) { stage = timed; }
+   void run(long calls);
+   
+private:
+   const char *path, *cachePath;
+   Stage stage;
+   unsigned char *image, *chain;
+   int width, height;
+   
+   //not copyable
+   TextureBench(const TextureBench &);
+   TextureBench& operator=(const TextureBench &);
+};
+
+//a timing: what was timed, at what resolution and thread count (none for the rest), and how fast.
+//items is what a call works through: vertices, points or pixels
+struct Result
+{
+   char id[64], name[32];
+   int xRes, yRes, threads;
+   long calls, items;
+   double nsPerCall;
+};
+
+//Global Variables
+Result results[MAX_RESULTS];
+int resultCount;
+
+//prints the command line usage
+void usage(const char *prog);
+//returns the fastest time of a call of the benchmark over REPEATS runs of at least
+//seconds/REPEATS each, and in calls the number of calls a run made
+double measure(Benchmark &benchmark, double seconds, long &calls);
+//times the benchmark and adds and prints its result
+void addResult(Benchmark &benchmark, double seconds, const char *name, int xRes, int yRes,
+               int threads, long items);
+//times the phases and the steps of each integrator of a skirt of the given resolution
+void benchSkirt(int xRes, int yRes, int threads, const Kernels &kernels, double seconds);
+//times the Quaternion operations
+void benchQuaternion(double seconds);
+//times loading the texture image at path. Returns false if it cannot be read
+bool benchTexture(const char *path, double seconds);
+//writes the results as JSON to path. Returns false if it cannot be written
+bool writeJSON(const char *path, const Kernels &kernels, double seconds);
+//compares the results with those of the JSON written to path by an earlier run, and prints each
+//change. Returns the number of results slower by more than threshold percent, or -1 if the
+//baseline cannot be read
+int compareBaseline(const char *path, double threshold);
+
+//::MAIN:://////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+   double seconds = DEFAULT_SECONDS, threshold = DEFAULT_THRESHOLD;
+   int maxThreads = ThreadPool::hardwareThreads();
+   bool isQuick = false;
+   const char *outputPath = DEFAULT_OUTPUT, *baselinePath = 0, *imagePath = DEFAULT_IMAGE;
+   const Kernels *kernels = &bestKernels();
+   
+   for(int a = 1; a < argc; a++){
+      if(!strcmp(argv[a], "-o") && a+1 < argc)      outputPath = argv[++a];
+      else if(!strcmp(argv[a], "-c") && a+1 < argc) baselinePath = argv[++a];
+      else if(!strcmp(argv[a], "-r") && a+1 < argc) threshold = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-m") && a+1 < argc) seconds = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-t") && a+1 < argc) maxThreads = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-i") && a+1 < argc) imagePath = argv[++a];
+      else if(!strcmp(argv[a], "-q"))               isQuick = true;
+      else if(!strcmp(argv[a], "-k") && a+1 < argc){
+         kernels = findKernels(argv[++a]);
+         if(!kernels){
+            printf("Unknown or unsupported kernels: %s\n", argv[a]);
+            return EXIT_FAILURE;
+         }
+      }
+      else{
+         usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(seconds <= 0 || threshold <= 0 || maxThreads <= 0){
+      usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   
+   printf("clothSim bench: %s kernels, %d hardware threads, %.2f s per measurement\n",
+          kernels->name, ThreadPool::hardwareThreads(), seconds);
+   for(int r = 0; r < (isQuick ? 1 : RESOLUTION_COUNT); r++)
+      for(int threads = 1; threads <= maxThreads; threads *= 2)
+         benchSkirt(RESOLUTIONS[r][0], RESOLUTIONS[r][1], threads, *kernels, seconds);
+   benchQuaternion(seconds);
+   if(!benchTexture(imagePath, seconds)) printf("texture: skipped, no image at %s\n", imagePath);
+   
+   if(!writeJSON(outputPath, *kernels, seconds)){
+      printf("Unable to write %s\n", outputPath);
+      return EXIT_FAILURE;
+   }
+   printf("results written to %s\n", outputPath);
+   if(baselinePath){
+      int regressions = compareBaseline(baselinePath, threshold);
+      if(regressions < 0){
+         printf("Unable to read a baseline from %s\n", baselinePath);
+         return EXIT_FAILURE;
+      }
+      if(regressions) return EXIT_FAILURE;
+   }
+   
+   return EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* prints the command line usage
+ */
+void usage(const char *prog)
+{
+   printf("usage: %s [-o results] [-c baseline] [-r percent] [-m seconds] [-t threads]\n"
+          "       [-k kernels] [-i image] [-q]\n", prog);
+   printf("   -o  write the results as JSON to this file (default %s)\n", DEFAULT_OUTPUT);
+   printf("   -c  compare with the results of an earlier run, and fail on regressions\n");
+   printf("   -r  slowdown in percent counted as a regression (default %g)\n", DEFAULT_THRESHOLD);
+   printf("   -m  seconds spent on each measurement (default %g)\n", DEFAULT_SECONDS);
+   printf("   -t  most solver threads swept, doubling from 1 (default the hardware threads)\n");
+   printf("   -k  scalar|sse2|avx2 solver kernels (default the fastest the CPU supports)\n");
+   printf("   -i  texture image to time loading (default %s)\n", DEFAULT_IMAGE);
+   printf("   -q  only the stock %dx%d skirt\n", RESOLUTIONS[0][0], RESOLUTIONS[0][1]);
+}
+
+/* returns the fastest time of a call of the benchmark over REPEATS runs. The number of calls of a
+ * run is first grown until one run takes seconds/REPEATS; that run counts as the first
+ */
+double measure(Benchmark &benchmark, double seconds, long &calls)
+{
+   const double target = seconds/REPEATS;
+   double elapsed;
+   
+   calls = 1;
+   for(;;){
+      benchmark.reset();
+      Timer timer;
+      benchmark.run(calls);
+      elapsed = timer.elapsed();
+      if(elapsed >= target) break;
+      calls = (elapsed > target/100) ? long(1.2*calls*target/elapsed) + 1 : 100*calls;
+   }
+   double best = elapsed/calls;
+   for(int r = 1; r < REPEATS; r++){
+      benchmark.reset();
+      Timer timer;
+      benchmark.run(calls);
+      elapsed = timer.elapsed()/calls;
+      if(elapsed < best) best = elapsed;
+   }
+   return best;
+}
+
+/* times the benchmark and adds and prints its result. The id of a result names what was timed,
+ * and at what resolution and thread count if threads is not 0
+ */
+void addResult(Benchmark &benchmark, double seconds, const char *name, int xRes, int yRes,
+               int threads, long items)
+{
+   if(resultCount == MAX_RESULTS) return;
+   Result &result = results[resultCount++];
+   
+   result.nsPerCall = 1e9*measure(benchmark, seconds, result.calls);
+   strncpy(result.name, name, sizeof(result.name) - 1);
+   result.name[sizeof(result.name) - 1] = 0;
+   result.xRes = xRes;
+   result.yRes = yRes;
+   result.threads = threads;
+   result.items = items;
+   if(threads) sprintf(result.id, "%.31s/%dx%d/t%d", name, xRes, yRes, threads);
+   else sprintf(result.id, "%.31s", name);
+   printf("%-32s %14.1f ns/call %10.2f ns/item\n", result.id, result.nsPerCall,
+          result.nsPerCall/items);
+}
+
+/* times the phases of an explicit step of a skirt of the given resolution in motion, then a whole
+ * step of each integrator, each from the same state
+ */
+void benchSkirt(int xRes, int yRes, int threads, const Kernels &kernels, double seconds)
+{
+   Skirt skirt(xRes, yRes);
+   skirt.setAmplitude(AMPLITUDE);
+   skirt.setFrequency(FREQUENCY);
+   skirt.setKernels(kernels);
+   skirt.setThreadCount(threads);
+   for(int s = 0; s < WARMUP_STEPS; s++) skirt.updateSkirt();
+   
+   SkirtBench bench(skirt);
+   const int vertices = skirt.getVertexCount();
+   const char *names[] = { "calcOscillatoryAcc", "updateVelocity", "updatePosition",
+                           "calcNorms", "calcNormsAir", "step.explicit" };
+   for(int p = SkirtBench::OSCILLATION; p <= SkirtBench::STEP; p++){
+      bench.setPhase(SkirtBench::Phase(p));
+      addResult(bench, seconds, names[p], xRes, yRes, threads, vertices);
+   }
+   skirt.setIntegrator(Skirt::IMPLICIT);
+   addResult(bench, seconds, "step.implicit", xRes, yRes, threads, vertices);
+   skirt.setIntegrator(Skirt::XPBD);
+   addResult(bench, seconds, "step.xpbd", xRes, yRes, threads, vertices);
+}
+
+/* times the Quaternion operations one call at a time, and rotatePoints() per call of
+ * ROTATED_POINTS points
+ */
+void benchQuaternion(double seconds)
+{
+   QuaternionBench bench;
+   const char *names[] = { "quaternion.multiply", "quaternion.add", "quaternion.inverse",
+                           "quaternion.normalize", "quaternion.toMatrix", "quaternion.slerp",
+                           "quaternion.rotatePoints" };
+   
+   for(int o = QuaternionBench::MULTIPLY; o <= QuaternionBench::ROTATE_POINTS; o++){
+      bench.setOperation(QuaternionBench::Operation(o));
+      addResult(bench, seconds, names[o], 0, 0, 0,
+                (o == QuaternionBench::ROTATE_POINTS) ? ROTATED_POINTS : 1);
+   }
+}
+
+/* times loading the texture image at path as far as it goes without OpenGL: reading the image,
+ * building its mip chain, and mapping the chain from the cache next to it (built first if need
+ * be). The upload itself is timed by clothSim at startup. Returns false if the image cannot be read
+ */
+bool benchTexture(const char *path, double seconds)
+{
+   //the cache is named as skirtdraw.cpp names it: the image's name with .mip for .ppm
+   char cachePath[1024];
+   strncpy(cachePath, path, sizeof(cachePath) - 5);
+   cachePath[sizeof(cachePath) - 5] = 0;
+   char *extension = strrchr(cachePath, '.');
+   if(extension && !strchr(extension, '/')) *extension = 0;
+   strcat(cachePath, ".mip");
+   
+   FILE *probe = fopen(path, "rb");
+   if(!probe) return false;
+   fclose(probe);
+   TextureBench bench(path, cachePath);
+   if(!bench.isLoaded()) return false;
+   const char *names[] = { "texture.readPPM", "texture.mipmap", "texture.mapCache" };
+   for(int s = TextureBench::READ; s <= TextureBench::MAP; s++){
+      bench.setStage(TextureBench::Stage(s));
+      addResult(bench, seconds, names[s], 0, 0, 0, bench.getPixels());
+   }
+   return true;
+}
+
+/* writes the results as JSON to path: what the run was on, then one result per line
+ */
+bool writeJSON(const char *path, const Kernels &kernels, double seconds)
+{
+   FILE *out = fopen(path, "w");
+   if(!out) return false;
+   
+   fprintf(out, "{\n  \"suite\": \"clothSim bench\",\n  \"time\": %ld,\n  \"kernels\": \"%s\",\n"
+           "  \"hardware_threads\": %d,\n  \"seconds_per_measurement\": %g,\n  \"results\": [\n",
+           long(time(0)), kernels.name, ThreadPool::hardwareThreads(), seconds);
+   for(int r = 0; r < resultCount; r++){
+      const Result &result = results[r];
+      fprintf(out, "    {\"id\": \"%s\", \"name\": \"%s\", \"x_res\": %d, \"y_res\": %d, "
+              "\"threads\": %d, \"calls\": %ld, \"items\": %ld, \"ns_per_call\": %.1f, "
+              "\"ns_per_item\": %.3f}%s\n", result.id, result.name, result.xRes, result.yRes,
+              result.threads, result.calls, result.items, result.nsPerCall,
+              result.nsPerCall/result.items, (r < resultCount - 1) ? "," : "");
+   }
+   fprintf(out, "  ]\n}\n");
+   return fclose(out) == 0;
+}
+
+/* compares the results with those of the JSON written to path by an earlier run, matching them
+ * by id, and prints each change in the time per call. Only what writeJSON() writes is read: the id
+ * of each result and the ns_per_call after it. Returns the number of results slower by more than
+ * threshold percent, or -1 if the baseline cannot be read
+ */
+int compareBaseline(const char *path, double threshold)
+{
+   MappedFile file(path);
+   if(!file.isOpen()) return -1;
+   char *text = new char[file.getSize() + 1];
+   memcpy(text, file.getData(), file.getSize());
+   text[file.getSize()] = 0;
+   
+   int compared = 0, regressions = 0, improvements = 0;
+   printf("compared with %s (slower by more than %g%% is a regression):\n", path, threshold);
+   for(const char *p = strstr(text, "\"id\": \""); p; p = strstr(p, "\"id\": \"")){
+      p += strlen("\"id\": \"");
+      const char *end = strchr(p, '"'), *time = strstr(p, "\"ns_per_call\": ");
+      if(!end || !time) break;
+      double before = strtod(time + strlen("\"ns_per_call\": "), 0);
+      for(int r = 0; r < resultCount; r++){
+         const Result &result = results[r];
+         if(strncmp(result.id, p, end - p) || result.id[end - p] || before <= 0) continue;
+         double change = 100*(result.nsPerCall/before - 1);
+         const char *verdict = "";
+         if(change > threshold){
+            verdict = "  REGRESSION";
+            regressions++;
+         }
+         else if(change < -threshold){
+            verdict = "  faster";
+            improvements++;
+         }
+         printf("%-32s %14.1f -> %14.1f ns/call %+7.1f%%%s\n", result.id, before,
+                result.nsPerCall, change, verdict);
+         compared++;
+      }
+      p = end;
+   }
+   printf("%d results compared: %d regressions, %d faster beyond %g%%\n", compared, regressions,
+          improvements, threshold);
+   delete [] text;
+   return regressions;
+}
+
+//::SKIRTBENCH:://////////////////////////////////////////////////////////////////////////////////
+
+/* SkirtBench - CONSTRUCTOR
+ */
+SkirtBench::SkirtBench(Skirt &skirt) : skirt(skirt)
+{
+   phase = STEP;
+   skirt.allocArray(position);
+   skirt.allocArray(velocity);
+   skirt.allocArray(normals);
+   skirt.copyArray(position, skirt.position);
+   skirt.copyArray(velocity, skirt.velocity);
+   skirt.copyArray(normals, skirt.vertexNormals);
+   theta = skirt.theta;
+}
+
+/* SkirtBench - DESTRUCTOR
+ */
+SkirtBench::~SkirtBench()
+{
+   skirt.freeArray(position);
+   skirt.freeArray(velocity);
+   skirt.freeArray(normals);
+}
+
+/* puts back the state of the skirt when the SkirtBench was made
+ */
+void SkirtBench::reset()
+{
+   skirt.copyArray(skirt.position, position);
+   skirt.copyArray(skirt.velocity, velocity);
+   skirt.copyArray(skirt.vertexNormals, normals);
+   skirt.theta = theta;
+}
+
+/* calls the phase timed the given number of times. Phases run alone carry on from the state they
+ * leave, which need not be one the whole step would reach, but costs the same to work through
+ */
+void SkirtBench::run(long calls)
+{
+   for(long c = 0; c < calls; c++)
+      switch(phase){
+         case OSCILLATION: skirt.calcOscillatoryAcc(1);
+            break;
+         case VELOCITY: skirt.updateVelocity();
+            break;
+         case POSITION: skirt.updatePosition();
+            break;
+         case NORMALS: skirt.calcNorms();
+            break;
+         case NORMALS_AIR: skirt.calcNormsAir();
+            break;
+         case STEP: skirt.updateSkirt();
+            break;
+      }
+}
+
+//::QUATERNIONBENCH:://////////////////////////////////////////////////////////////////////////////
+
+/* QuaternionBench - CONSTRUCTOR. The versors turn about axes spread around the sphere
+ */
+QuaternionBench::QuaternionBench()
+{
+   operation = MULTIPLY;
+   sink = 0;
+   for(int v = 0; v < VERSORS; v++)
+      versors[v] = Quaternion(5.0f*v, float(v%3 == 0), float(v%3 == 1), float(v%3 == 2) + 0.5f);
+   for(int p = 0; p < ROTATED_POINTS; p++){
+      x[p] = 0.001f*p;
+      y[p] = 1 - 0.002f*p;
+      z[p] = 0.5f;
+   }
+}
+
+/* calls the operation timed the given number of times, on the versors in turn. Each result feeds
+ * the sink, so no call can be left out
+ */
+void QuaternionBench::run(long calls)
+{
+   float sum = 0, m[9];
+   
+   for(long c = 0; c < calls; c++){
+      const Quaternion &a = versors[c%VERSORS], &b = versors[(c + 7)%VERSORS];
+      switch(operation){
+         case MULTIPLY: sum += (a*b).getS();
+            break;
+         case ADD: sum += (a + b).getS();
+            break;
+         case INVERSE: sum += a.inverse().getX();
+            break;
+         case NORMALIZE:{
+            Quaternion n(a);
+            n.normalize();
+            sum += n.getS();
+            break;
+         }
+         case TO_MATRIX: a.toMatrix(m);
+                         sum += m[0] + m[4] + m[8];
+            break;
+         case SLERP: sum += slerp(a, b, 0.3f).getS();
+            break;
+         case ROTATE_POINTS: a.toMatrix(m);
+                             Quaternion::rotatePoints(m, x, y, z, rotX, rotY, rotZ,
+                                                      ROTATED_POINTS);
+                             sum += rotX[c%ROTATED_POINTS];
+            break;
+      }
+   }
+   sink = sum;
+}
+
+//::TEXTUREBENCH:://///////////////////////////////////////////////////////////////////////////////
+
+/* TextureBench - CONSTRUCTOR
+ */
+TextureBench::TextureBench(const char *path, const char *cachePath) : path(path),
+                                                                       cachePath(cachePath)
+{
+   stage = READ;
+   chain = 0;
+   image = TextureCache::readPPM(path, width, height);
+   if(!image) return;
+   //the full image and every level below it, as the cache holds them
+   long size = 0;
+   for(int w = width, h = height; ; w = (w > 1) ? w/2 : 1, h = (h > 1) ? h/2 : 1){
+      size += 3L*w*h;
+      if(w == 1 && h == 1) break;
+   }
+   chain = new unsigned char[size];
+   TextureCache cache(path, cachePath);
+}
+
+/* TextureBench - DESTRUCTOR
+ */
+TextureBench::~TextureBench()
+{
+   delete [] image;
+   delete [] chain;
+}
+
+/* calls the stage timed the given number of times: reads the image, halves it down to 1x1, or
+ * maps and unmaps its cache
+ */
+void TextureBench::run(long calls)
+{
+   for(long c = 0; c < calls; c++)
+      switch(stage){
+         case READ:{
+            int w, h;
+            delete [] TextureCache::readPPM(path, w, h);
+            break;
+         }
+         case MIPMAP:{
+            memcpy(chain, image, 3L*width*height);
+            unsigned char *level = chain;
+            for(int w = width, h = height; w > 1 || h > 1; w = (w > 1) ? w/2 : 1,
+                h = (h > 1) ? h/2 : 1){
+               TextureCache::halveImage(level, w, h, level + 3L*w*h);
+               level += 3L*w*h;
+            }
+            break;
+         }
+         case MAP:{
+            TextureCache cache(path, cachePath);
+            break;
+         }
+      }
+}
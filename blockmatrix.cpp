@@ -0,0 +1,108 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: blockmatrix.cpp - Implementation for the BlockMatrix class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "blockmatrix.h"
+
+/* BlockMatrix - CONSTRUCTOR
+ */
+BlockMatrix::BlockMatrix(int first, int end, int edgeCount, const int *a, const int *b) :
+                         first(first), end(end), edgeCount(edgeCount), edgeA(a), edgeB(b)
+{
+   diag = new SymBlock[end - first];
+   diagInverse = new SymBlock[end - first];
+   offDiag = new SymBlock[edgeCount];
+   for(int v = 0; v < end - first; v++) diag[v] = diagInverse[v] = scaledIdentity(0);
+   for(int e = 0; e < edgeCount; e++) offDiag[e] = scaledIdentity(0);
+}
+
+/* BlockMatrix - DESTRUCTOR
+ */
+BlockMatrix::~BlockMatrix()
+{
+   delete [] diag;
+   delete [] diagInverse;
+   delete [] offDiag;
+}
+
+/* computes y = Ax over the vertex range: the diagonal blocks first, then both blocks of each edge
+ */
+void BlockMatrix::multiply(const VectorArray &x, VectorArray &y) const
+{
+   for(int v = first; v < end; v++){
+      const SymBlock &d = diag[v - first];
+      y.x[v] = d.xx*x.x[v] + d.xy*x.y[v] + d.xz*x.z[v];
+      y.y[v] = d.xy*x.x[v] + d.yy*x.y[v] + d.yz*x.z[v];
+      y.z[v] = d.xz*x.x[v] + d.yz*x.y[v] + d.zz*x.z[v];
+   }
+   for(int e = 0; e < edgeCount; e++){
+      const SymBlock &o = offDiag[e];
+      int a = edgeA[e], b = edgeB[e];
+      y.x[a] += o.xx*x.x[b] + o.xy*x.y[b] + o.xz*x.z[b];
+      y.y[a] += o.xy*x.x[b] + o.yy*x.y[b] + o.yz*x.z[b];
+      y.z[a] += o.xz*x.x[b] + o.yz*x.y[b] + o.zz*x.z[b];
+      y.x[b] += o.xx*x.x[a] + o.xy*x.y[a] + o.xz*x.z[a];
+      y.y[b] += o.xy*x.x[a] + o.yy*x.y[a] + o.yz*x.z[a];
+      y.z[b] += o.xz*x.x[a] + o.yz*x.y[a] + o.zz*x.z[a];
+   }
+}
+
+/* computes z = P^-1 r over the vertex range, where P is the block diagonal of the matrix (block
+ * Jacobi preconditioning)
+ */
+void BlockMatrix::precondition(const VectorArray &r, VectorArray &z) const
+{
+   for(int v = first; v < end; v++){
+      const SymBlock &d = diagInverse[v - first];
+      z.x[v] = d.xx*r.x[v] + d.xy*r.y[v] + d.xz*r.z[v];
+      z.y[v] = d.xy*r.x[v] + d.yy*r.y[v] + d.yz*r.z[v];
+      z.z[v] = d.xz*r.x[v] + d.yz*r.y[v] + d.zz*r.z[v];
+   }
+}
+
+/* inverts the diagonal blocks for precondition() by their adjugates. The blocks of an assembled
+ * implicit system are positive definite, so the determinants are positive
+ */
+void BlockMatrix::factorDiagonal()
+{
+   for(int v = 0; v < end - first; v++){
+      const SymBlock &d = diag[v];
+      SymBlock &i = diagInverse[v];
+      i.xx = d.yy*d.zz - d.yz*d.yz;
+      i.xy = d.xz*d.yz - d.xy*d.zz;
+      i.xz = d.xy*d.yz - d.xz*d.yy;
+      i.yy = d.xx*d.zz - d.xz*d.xz;
+      i.yz = d.xy*d.xz - d.xx*d.yz;
+      i.zz = d.xx*d.yy - d.xy*d.xy;
+      float invDet = 1/(d.xx*i.xx + d.xy*i.xy + d.xz*i.xz);
+      i.xx *= invDet; i.xy *= invDet; i.xz *= invDet;
+      i.yy *= invDet; i.yz *= invDet; i.zz *= invDet;
+   }
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the 3x3 identity scaled by s
+ */
+SymBlock BlockMatrix::scaledIdentity(float s)
+{
+   SymBlock block = { s, 0, 0, s, 0, s };
+   return block;
+}
+
+/* adds s times block b to block a
+ */
+void BlockMatrix::addScaled(SymBlock &a, const SymBlock &b, float s)
+{
+   a.xx += s*b.xx; a.xy += s*b.xy; a.xz += s*b.xz;
+   a.yy += s*b.yy; a.yz += s*b.yz; a.zz += s*b.zz;
+}
@@ -0,0 +1,75 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: blockmatrix.h - Interface for the BlockMatrix class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef BLOCKMATRIX_H
+#define BLOCKMATRIX_H
+
+#include "kernels.h"
+
+/* A symmetric 3x3 matrix, stored as its upper triangle
+ */
+struct SymBlock
+{
+   float xx, xy, xz, yy, yz, zz;
+};
+
+/* A sparse symmetric matrix of 3x3 blocks over a range of vertices of the VectorArray buffers, as
+ * assembled for an implicit step of a spring mesh: a block on the diagonal for every vertex in the
+ * range, and a mirrored pair of off-diagonal blocks for every edge joining two of them. Entries of
+ * the range that are not vertices (row padding) should be given an identity diagonal.
+ */
+class BlockMatrix
+{
+public:
+   //constructor. A zero matrix over the vertices [first, end) with one off-diagonal block for each
+   //of the edgeCount edges joining vertex a[e] and vertex b[e]. The edge arrays are not copied
+   BlockMatrix(int first, int end, int edgeCount, const int *a, const int *b);
+   //destructor
+   ~BlockMatrix();
+   
+//::ACCESSORS:://
+   int getFirst() const { return first; }
+   int getEnd() const { return end; }
+   //computes y = Ax over the vertex range
+   void multiply(const VectorArray &x, VectorArray &y) const;
+   //computes z = P^-1 r over the vertex range, where P is the block diagonal of the matrix. Valid
+   //after factorDiagonal()
+   void precondition(const VectorArray &r, VectorArray &z) const;
+   
+//::MUTATORS:://
+   //returns the diagonal block of vertex v
+   SymBlock &diagonal(int v) { return diag[v - first]; }
+   //returns the upper off-diagonal block of edge e; the lower one is its transpose
+   SymBlock &offDiagonal(int e) { return offDiag[e]; }
+   //inverts the diagonal blocks for precondition(). Call once the matrix is assembled
+   void factorDiagonal();
+   
+//::STATIC FUNCTIONS:://
+   //returns the 3x3 identity scaled by s
+   static SymBlock scaledIdentity(float s);
+   //adds s times block b to block a
+   static void addScaled(SymBlock &a, const SymBlock &b, float s);
+   
+private:
+//::VARIABLES:://
+   int first, end, edgeCount;
+   const int *edgeA, *edgeB;
+   SymBlock *diag, *diagInverse, *offDiag;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //not copyable
+   BlockMatrix(const BlockMatrix &);
+   BlockMatrix& operator=(const BlockMatrix &);
+};
+
+#endif //BLOCKMATRIX_H
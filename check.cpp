@@ -0,0 +1,490 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: check.cpp - Checks the optimized solvers against the frozen reference solver
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "skirtt.h"
+#include "skirtbatch.h"
+#include "skirtreference.h"
+#include <cstdlib> //used for atoi(), atof(), EXIT_SUCCESS, EXIT_FAILURE
+#include <cstdio> //used for printf()
+#include <cstring> //used for strcmp(), strstr(), memcpy()
+#include <cmath> //used for sqrt(), fabs(), frexp(), ldexp()
+#include <limits> //used for numeric_limits<>::denorm_min(), numeric_limits<>::infinity()
+
+using namespace std;
+
+//Global Constants
+const int DEFAULT_STEPS = 5000, DEFAULT_REPORT_INTERVAL = 1000, DEFAULT_THREADS = 4;
+const float DEFAULT_AMPLITUDE = 20, DEFAULT_FREQUENCY = 0.05f;
+//the largest difference of a position from the reference allowed along any axis after a single
+//step from the same state (lockstep), and the largest in units in the last place. Running free
+//the motion is chaotic, so the drift only grows to the size of the swing and is bounded only when
+//asked; a NaN fails regardless. A normal is a cross product of short edges, so its ulps grow with
+//the resolution and are only bounded when asked
+const double DEFAULT_STEP_TOLERANCE = 1e-5, DEFAULT_STEP_ULPS = 16;
+//the largest difference of the height of the hem at rest from that at the first number of rows
+const double DEFAULT_HEM_TOLERANCE = 0.1;
+//the solvers checked unless given with -s
+const char *DEFAULT_SOLVERS = "scalar,sse2,avx2,threads,specialized,batch";
+
+/* A solver checked against the reference. It steps a skirt of the reference's resolution and
+ * motion from the same initial state, a Skirt's
+ */
+class Candidate
+{
+public:
+   virtual ~Candidate() {}
+   //advances the skirt by one explicit step
+   virtual void step() = 0;
+   //writes the position and unit normal of the vertex at column col and row row
+   virtual void getVertex(int col, int row, float position[3], float normal[3]) const = 0;
+   //takes the positions, velocities, normals and phase of a skirt of the same resolution
+   virtual void setState(const Skirt &state) = 0;
+};
+
+/* A Skirt with a set of kernels and a number of solver threads
+ */
+class SkirtCandidate : public Candidate
+{
+public:
+   //constructor. motion is a skirt whose resolution and motion are copied
+   SkirtCandidate(const Skirt &motion, const Kernels &kernels, int threads);
+   void step() { skirt.updateSkirt(); }
+   void getVertex(int col, int row, float position[3], float normal[3]) const;
+   void setState(const Skirt &state) { skirt.setState(state); }
+   
+private:
+   Skirt skirt;
+};
+
+/* A SkirtT, specialized at compile time for its resolution
+ */
+template <int XRes, int YRes>
+class SpecializedCandidate : public Candidate
+{
+public:
+   //constructor. motion is a skirt whose motion is copied
+   SpecializedCandidate(const Skirt &motion);
+   void step() { skirt.updateSkirt(); }
+   void getVertex(int col, int row, float position[3], float normal[3]) const;
+   void setState(const Skirt &state) { skirt.setState(state); }
+   
+private:
+   SkirtT<XRes,YRes> skirt;
+};
+
+/* The only instance of a SkirtBatch, stepped with a set of batch kernels
+ */
+class BatchCandidate : public Candidate
+{
+public:
+   //constructor. motion is a skirt whose resolution and motion are copied
+   BatchCandidate(const Skirt &motion, const BatchKernels &kernels);
+   void step() { batch.step(); }
+   void getVertex(int col, int row, float position[3], float normal[3]) const;
+   void setState(const Skirt &state);
+   
+private:
+   SkirtBatch batch;
+};
+
+//how far a solver's skirt is from the reference's after a step: the largest difference of a
+//position along any axis, the root mean square distance of the vertices, and the largest
+//differences of a position and of a normal in units in the last place of their largest component
+struct Difference
+{
+   double maxDrift, rmsDrift, positionUlps, normalUlps;
+};
+
+//what is checked, and how closely
+struct Settings
+{
+   int steps, reportInterval, threads;
+   bool isLockstep;
+   double tolerance, ulpTolerance, normalUlpTolerance;
+};
+
+//prints the command line usage
+void usage(const char *prog);
+//returns the candidate solver of the given name for a skirt with the resolution and motion of
+//motion, or 0 if there is none for it on this CPU or at this resolution
+Candidate *makeCandidate(const char *name, const Skirt &motion, int threads);
+//steps a candidate solver alongside the reference and reports how far apart they are. Returns
+//true if they stayed within the tolerances
+bool check(const char *name, Candidate &candidate, const Skirt &motion, const Settings &settings);
+//settles a Skirt at each of the comma separated numbers of rows and compares the heights of the
+//hems. Returns true if they are within the tolerance of the first
+bool checkHem(char *rows, int xRes, double tolerance);
+//returns how far the candidate's skirt is from the reference's
+Difference compare(const SkirtReference &reference, const Candidate &candidate);
+//returns the largest difference of a component of vector a from vector b, in units in the last
+//place of the largest component of b
+double ulpDistance(const float a[3], const float b[3]);
+
+//::MAIN:://////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+   Settings settings = { DEFAULT_STEPS, DEFAULT_REPORT_INTERVAL, DEFAULT_THREADS, false, -1, -1,
+                         -1 };
+   int xRes = Skirt::DEFAULT_X_RES, yRes = Skirt::DEFAULT_Y_RES;
+   float amplitude = DEFAULT_AMPLITUDE, frequency = DEFAULT_FREQUENCY;
+   bool is3D = true;
+   char solvers[256], rows[256] = "";
+   
+   strcpy(solvers, DEFAULT_SOLVERS);
+   for(int a = 1; a < argc; a++){
+      if(!strcmp(argv[a], "-n") && a+1 < argc)      settings.steps = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-a") && a+1 < argc) amplitude = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-f") && a+1 < argc) frequency = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-x") && a+1 < argc) xRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-y") && a+1 < argc) yRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-t") && a+1 < argc) settings.threads = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-e") && a+1 < argc) settings.reportInterval = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-d") && a+1 < argc) settings.tolerance = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-u") && a+1 < argc) settings.ulpTolerance = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-v") && a+1 < argc) settings.normalUlpTolerance = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-l"))               settings.isLockstep = true;
+      else if(!strcmp(argv[a], "-2"))               is3D = false;
+      else if(!strcmp(argv[a], "-3"))               is3D = true;
+      else if(!strcmp(argv[a], "-s") && a+1 < argc && strlen(argv[a+1]) < sizeof(solvers))
+         strcpy(solvers, argv[++a]);
+      else if(!strcmp(argv[a], "-r") && a+1 < argc && strlen(argv[a+1]) < sizeof(rows))
+         strcpy(rows, argv[++a]);
+      else{
+         usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(settings.steps <= 0 || settings.threads <= 0 || xRes < 3 || yRes < 3){
+      usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   if(rows[0]){
+      if(settings.tolerance < 0) settings.tolerance = DEFAULT_HEM_TOLERANCE;
+      printf("clothSim check: the hem at rest, %d vertices around the waist, rows %s, tolerance "
+             "%g\n", xRes, rows, settings.tolerance);
+      return checkHem(rows, xRes, settings.tolerance) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+   if(settings.tolerance < 0)
+      settings.tolerance = settings.isLockstep ? DEFAULT_STEP_TOLERANCE :
+                                                 numeric_limits<double>::infinity();
+   //running free, the rounding of the vectors compounds far beyond any bound in units
+   if(settings.ulpTolerance < 0 && settings.isLockstep) settings.ulpTolerance = DEFAULT_STEP_ULPS;
+   
+   Skirt motion(xRes, yRes);
+   motion.setAmplitude(amplitude);
+   motion.setFrequency(frequency);
+   if(is3D) motion.rotate3D();
+   else motion.rotate2D();
+   printf("clothSim check: %dx%d vertices, %d steps, amplitude %g, frequency %g, %s rotation, %s, "
+          "tolerance %g", xRes, yRes, settings.steps, motion.getAmplitude(), motion.getFrequency(),
+          is3D ? "3D" : "2D", settings.isLockstep ? "lockstep" : "running free",
+          settings.tolerance);
+   if(settings.ulpTolerance >= 0) printf(", %g position ulps", settings.ulpTolerance);
+   if(settings.normalUlpTolerance >= 0) printf(", %g normal ulps", settings.normalUlpTolerance);
+   printf("\n");
+   
+   int failures = 0;
+   for(char *name = strtok(solvers, ","); name; name = strtok(0, ",")){
+      Candidate *candidate = makeCandidate(name, motion, settings.threads);
+      if(!candidate){
+         printf("%s: skipped, not available on this CPU or at this resolution\n", name);
+         continue;
+      }
+      if(!check(name, *candidate, motion, settings)) failures++;
+      delete candidate;
+   }
+   
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* prints the command line usage
+ */
+void usage(const char *prog)
+{
+   printf("usage: %s [-n steps] [-a amplitude] [-f frequency] [-2 | -3] [-x columns] [-y rows]\n"
+          "       [-s solvers] [-t threads] [-l] [-d tolerance] [-u ulps] [-v ulps] [-e steps]\n"
+          "       [-r rows]\n", prog);
+   printf("   -n  number of steps to run (default %d)\n", DEFAULT_STEPS);
+   printf("   -a  amplitude of the oscillatory motion in degrees (default %g)\n",
+          DEFAULT_AMPLITUDE);
+   printf("   -f  frequency of the oscillatory motion in radians per step (default %g)\n",
+          DEFAULT_FREQUENCY);
+   printf("   -2  2D rotation about the z-axis\n");
+   printf("   -3  3D rotation about both the x-axis and z-axis (default)\n");
+   printf("   -x  vertices around the waist (default %d)\n", Skirt::DEFAULT_X_RES);
+   printf("   -y  rows of vertices from waist to hem (default %d)\n", Skirt::DEFAULT_Y_RES);
+   printf("   -s  comma separated solvers to check: scalar, sse2 and avx2 (a Skirt with those\n"
+          "       kernels), threads (the fastest kernels on -t threads), specialized (SkirtT)\n"
+          "       and batch (SkirtBatch) (default all)\n");
+   printf("   -t  solver threads of the threads solver (default %d)\n", DEFAULT_THREADS);
+   printf("   -l  lockstep: the solver takes the reference's state before every step, so each\n"
+          "       step is checked on its own rather than the drift accumulated\n");
+   printf("   -d  largest difference of a position along any axis allowed (default any, %g with\n"
+          "       -l)\n", DEFAULT_STEP_TOLERANCE);
+   printf("   -u  largest difference of a position allowed, in units in the last place of its\n"
+          "       largest component (default any, %g with -l)\n", DEFAULT_STEP_ULPS);
+   printf("   -v  largest difference of a normal allowed, in units in the last place of its\n"
+          "       largest component (default any)\n");
+   printf("   -e  steps between progress lines (default %d)\n", DEFAULT_REPORT_INTERVAL);
+   printf("   -r  rather than the solvers, check that a skirt of each of the given comma\n"
+          "       separated numbers of rows comes to rest with its hem within -d (default %g)\n"
+          "       of the height at the first\n", DEFAULT_HEM_TOLERANCE);
+}
+
+/* returns the candidate solver of the given name for a skirt with the resolution and motion of
+ * motion, or 0 if the CPU lacks its instruction set or there is no SkirtT of the resolution
+ */
+Candidate *makeCandidate(const char *name, const Skirt &motion, int threads)
+{
+   const int x = motion.getXRes(), y = motion.getYRes();
+   const Kernels *kernels = findKernels(name);
+   
+   if(kernels) return new SkirtCandidate(motion, *kernels, 1);
+   if(!strcmp(name, "threads")) return new SkirtCandidate(motion, bestKernels(), threads);
+   if(!strcmp(name, "batch")) return new BatchCandidate(motion, bestBatchKernels());
+   if(strcmp(name, "specialized")) return 0;
+   if(x == 120 && y == 18) return new SpecializedCandidate<120,18>(motion);
+   if(x == 240 && y == 36) return new SpecializedCandidate<240,36>(motion);
+   if(x == 256 && y == 256) return new SpecializedCandidate<256,256>(motion);
+   return 0;
+}
+
+/* steps a candidate solver alongside the reference from the initial state of a Skirt and prints
+ * how far apart they are every reportInterval steps, then the largest differences over all the
+ * steps. In lockstep the candidate takes the reference's state before every step, so each step
+ * is compared on its own; otherwise the differences accumulate as they would in a run. A lockstep
+ * step beyond the tolerances is excused, and left out of the worst differences, when the reference
+ * drove the skirt toward a near tie of waist vertices, as rounding then decides the drive. Returns
+ * true if the largest difference of a position stayed within the tolerance, and the differences
+ * in units in the last place within theirs where given
+ */
+bool check(const char *name, Candidate &candidate, const Skirt &motion, const Settings &settings)
+{
+   SkirtReference reference(motion);
+   Skirt state(motion.getXRes(), motion.getYRes());
+   Difference worst = { 0, 0, 0, 0 };
+   int worstStep = 0, firstFailure = 0, excused = 0;
+   
+   for(int s = 1; s <= settings.steps; s++){
+      if(settings.isLockstep){
+         reference.getState(state);
+         candidate.setState(state);
+      }
+      reference.updateSkirt();
+      candidate.step();
+      Difference step = compare(reference, candidate);
+      bool isFailed = !(step.maxDrift <= settings.tolerance) ||
+                      (settings.ulpTolerance >= 0 &&
+                       !(step.positionUlps <= settings.ulpTolerance)) ||
+                      (settings.normalUlpTolerance >= 0 &&
+                       !(step.normalUlps <= settings.normalUlpTolerance));
+      if(isFailed && settings.isLockstep && reference.isDriveTied()){
+         if(!excused++)
+            printf("%s: step %d: drift max %.3g, ulps position %.3g  <- excused, the drive is "
+                   "tied\n", name, s, step.maxDrift, step.positionUlps);
+         continue;
+      }
+      //the comparisons are written so that a NaN counts as the worst
+      if(!(step.maxDrift <= worst.maxDrift) || (s == 1)){
+         worst.maxDrift = step.maxDrift;
+         worstStep = s;
+      }
+      if(!(step.rmsDrift <= worst.rmsDrift)) worst.rmsDrift = step.rmsDrift;
+      if(!(step.positionUlps <= worst.positionUlps)) worst.positionUlps = step.positionUlps;
+      if(!(step.normalUlps <= worst.normalUlps)) worst.normalUlps = step.normalUlps;
+      if(isFailed && !firstFailure) firstFailure = s;
+      if(s % settings.reportInterval == 0 || (isFailed && firstFailure == s))
+         printf("%s: step %d: drift max %.3g rms %.3g, ulps position %.3g normal %.3g%s\n", name,
+                s, step.maxDrift, step.rmsDrift, step.positionUlps, step.normalUlps,
+                isFailed ? "  <- beyond the tolerance" : "");
+   }
+   printf("%s: %s: worst drift max %.3g (step %d) rms %.3g, ulps position %.3g normal %.3g",
+          name, firstFailure ? "FAILED" : "passed", worst.maxDrift, worstStep, worst.rmsDrift,
+          worst.positionUlps, worst.normalUlps);
+   if(excused) printf(", %d tied steps excused", excused);
+   printf("\n");
+   return !firstFailure;
+}
+
+/* settles a Skirt of xRes columns at each of the comma separated numbers of rows and compares the
+ * mean height of its hem with that at the first. A skirt that does not come to rest fails. Returns
+ * true if every hem is within the tolerance of the first
+ */
+bool checkHem(char *rows, int xRes, double tolerance)
+{
+   double first = 0, worst = 0;
+   int worstRows = 0, failures = 0;
+   
+   for(char *row = strtok(rows, ","); row; row = strtok(0, ",")){
+      const int yRes = atoi(row);
+      if(yRes < 3){
+         printf("hem: %s rows: FAILED, a skirt needs at least 3\n", row);
+         failures++;
+         continue;
+      }
+      Skirt skirt(xRes, yRes);
+      int steps = skirt.settle();
+      double hem = 0;
+      for(int i = 0; i < xRes; i++) hem += skirt.getY(i, yRes-1);
+      hem /= xRes;
+      if(!worstRows) first = hem;
+      double difference = fabs(hem - first);
+      bool isFailed = !(difference <= tolerance) || steps >= Skirt::MAX_SETTLE_STEPS;
+      if(!(difference <= worst) || !worstRows){
+         worst = difference;
+         worstRows = yRes;
+      }
+      printf("hem: %dx%d: %s in %d steps, height %.4g, %.3g from the first%s\n", xRes, yRes,
+             (steps < Skirt::MAX_SETTLE_STEPS) ? "at rest" : "still moving", steps, hem,
+             difference, isFailed ? "  <- beyond the tolerance" : "");
+      if(isFailed) failures++;
+   }
+   printf("hem: %s: worst difference %.3g (%dx%d)\n", failures ? "FAILED" : "passed", worst, xRes,
+          worstRows);
+   return !failures;
+}
+
+/* returns how far the candidate's skirt is from the reference's, over every vertex
+ */
+Difference compare(const SkirtReference &reference, const Candidate &candidate)
+{
+   Difference difference = { 0, 0, 0, 0 };
+   double sumSq = 0;
+   
+   for(int j = 0; j < reference.getYRes(); j++)
+      for(int i = 0; i < reference.getXRes(); i++){
+         float ref[3] = { reference.getX(i,j), reference.getY(i,j), reference.getZ(i,j) };
+         float refNormal[3] = { reference.getNormalX(i,j), reference.getNormalY(i,j),
+                                reference.getNormalZ(i,j) };
+         float position[3], normal[3];
+         candidate.getVertex(i, j, position, normal);
+         double positionUlps = ulpDistance(position, ref);
+         double normalUlps = ulpDistance(normal, refNormal);
+         //a NaN is as far off as can be
+         if(!(positionUlps <= difference.positionUlps)) difference.positionUlps = positionUlps;
+         if(!(normalUlps <= difference.normalUlps)) difference.normalUlps = normalUlps;
+         for(int c = 0; c < 3; c++){
+            double drift = fabs(double(position[c]) - ref[c]);
+            if(!(drift <= difference.maxDrift)) difference.maxDrift = drift;
+            sumSq += drift*drift;
+         }
+      }
+   difference.rmsDrift = sqrt(sumSq/(reference.getXRes()*reference.getYRes()));
+   return difference;
+}
+
+/* returns the largest difference of a component of vector a from vector b, in units in the last
+ * place of the largest component of b: the spacing of the floats around its magnitude. A component
+ * near zero is as precise as the vector it belongs to, not as its own tiny magnitude allows, so
+ * counting its own units would make a rounding of the vector look like a huge error
+ */
+double ulpDistance(const float a[3], const float b[3])
+{
+   double scale = 0, difference = 0;
+   int exponent;
+   
+   for(int c = 0; c < 3; c++){
+      if(fabs(b[c]) > scale) scale = fabs(b[c]);
+      if(!(fabs(double(a[c]) - b[c]) <= difference)) difference = fabs(double(a[c]) - b[c]);
+   }
+   if(scale == 0) return difference/numeric_limits<float>::denorm_min();
+   //a float has 24 significant bits, so the floats in [2^(e-1), 2^e) lie 2^(e-24) apart
+   frexp(scale, &exponent);
+   return difference/ldexp(1.0, exponent - 24);
+}
+
+//::CANDIDATES::////////////////////////////////////////////////////////////////////////////////////
+
+/* SkirtCandidate - CONSTRUCTOR
+ */
+SkirtCandidate::SkirtCandidate(const Skirt &motion, const Kernels &kernels, int threads) :
+                               skirt(motion.getXRes(), motion.getYRes())
+{
+   skirt.setAmplitude(motion.getAmplitude());
+   skirt.setFrequency(motion.getFrequency());
+   if(motion.getIs3DRotation()) skirt.rotate3D();
+   else skirt.rotate2D();
+   skirt.setKernels(kernels);
+   skirt.setThreadCount(threads);
+}
+
+/* writes the position and unit normal of the vertex at column col and row row
+ */
+void SkirtCandidate::getVertex(int col, int row, float position[3], float normal[3]) const
+{
+   position[0] = skirt.getX(col, row);
+   position[1] = skirt.getY(col, row);
+   position[2] = skirt.getZ(col, row);
+   normal[0] = skirt.getNormalX(col, row);
+   normal[1] = skirt.getNormalY(col, row);
+   normal[2] = skirt.getNormalZ(col, row);
+}
+
+/* SpecializedCandidate - CONSTRUCTOR
+ */
+template <int XRes, int YRes>
+SpecializedCandidate<XRes,YRes>::SpecializedCandidate(const Skirt &motion)
+{
+   skirt.setAmplitude(motion.getAmplitude());
+   skirt.setFrequency(motion.getFrequency());
+   if(motion.getIs3DRotation()) skirt.rotate3D();
+   else skirt.rotate2D();
+}
+
+/* writes the position and unit normal of the vertex at column col and row row
+ */
+template <int XRes, int YRes>
+void SpecializedCandidate<XRes,YRes>::getVertex(int col, int row, float position[3],
+                                                float normal[3]) const
+{
+   position[0] = skirt.getX(col, row);
+   position[1] = skirt.getY(col, row);
+   position[2] = skirt.getZ(col, row);
+   normal[0] = skirt.getNormalX(col, row);
+   normal[1] = skirt.getNormalY(col, row);
+   normal[2] = skirt.getNormalZ(col, row);
+}
+
+/* BatchCandidate - CONSTRUCTOR
+ */
+BatchCandidate::BatchCandidate(const Skirt &motion, const BatchKernels &kernels) :
+                               batch(1, motion.getXRes(), motion.getYRes())
+{
+   batch.setAmplitude(0, motion.getAmplitude());
+   batch.setFrequency(0, motion.getFrequency());
+   if(motion.getIs3DRotation()) batch.rotate3D(0);
+   else batch.rotate2D(0);
+   batch.setKernels(kernels);
+}
+
+/* takes the positions, velocities, normals and phase of a skirt of the same resolution
+ */
+void BatchCandidate::setState(const Skirt &state)
+{
+   batch.setState(0, state);
+   batch.setTheta(0, state.getTheta());
+}
+
+/* writes the position and unit normal of the vertex at column col and row row
+ */
+void BatchCandidate::getVertex(int col, int row, float position[3], float normal[3]) const
+{
+   position[0] = batch.getX(0, col, row);
+   position[1] = batch.getY(0, col, row);
+   position[2] = batch.getZ(0, col, row);
+   normal[0] = batch.getNormalX(0, col, row);
+   normal[1] = batch.getNormalY(0, col, row);
+   normal[2] = batch.getNormalZ(0, col, row);
+}
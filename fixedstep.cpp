@@ -0,0 +1,58 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: fixedstep.cpp - Implementation for the FixedStep class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "fixedstep.h"
+
+/* FixedStep - CONSTRUCTOR
+ */
+FixedStep::FixedStep(double stepSeconds, int maxSteps) : banked(0), droppedSteps(0)
+{
+   setStepSeconds(stepSeconds);
+   setMaxSteps(maxSteps);
+}
+
+/* banks the real time elapsed since the last call (or since the clock was reset) and returns the
+ * number of whole steps to run for this frame. If the bank holds more than maxSteps steps, the
+ * surplus whole steps are dropped and only the fraction of a step is kept
+ */
+int FixedStep::advance()
+{
+   banked += clock.elapsed();
+   clock.start();
+   
+   int steps = int(banked/stepSeconds);
+   banked -= steps*stepSeconds;
+   //rounding can leave the bank a hair below zero
+   if(banked < 0) banked = 0;
+   if(steps > maxSteps){
+      droppedSteps += steps - maxSteps;
+      steps = maxSteps;
+   }
+   return steps;
+}
+
+/* sets the length of a step. The banked time is kept, so a frame may pay out one step less or more
+ * than usual
+ */
+void FixedStep::setStepSeconds(double seconds)
+{
+   stepSeconds = (seconds > 0) ? seconds : 1e-6;
+}
+
+/* empties the bank and restarts the clock, e.g. after the simulation was paused
+ */
+void FixedStep::reset()
+{
+   banked = 0;
+   clock.start();
+}
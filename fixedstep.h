@@ -0,0 +1,61 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: fixedstep.h - Interface for the FixedStep class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef FIXEDSTEP_H
+#define FIXEDSTEP_H
+
+#include "timer.h"
+
+/* A fixed timestep accumulator. The real time that passes between frames is banked and paid out in
+ * whole steps of a fixed length, so a simulation advances at the same rate however fast or slow the
+ * frames come. No more than a set number of steps are paid out per frame; time beyond that is
+ * dropped, so a frame that runs long cannot make the next frame run longer still. The time left in
+ * the bank is reported as a fraction of a step for interpolating between the last two states.
+ */
+class FixedStep
+{
+public:
+   //constructor. Steps of stepSeconds, at most maxSteps of them per frame. The clock starts now
+   FixedStep(double stepSeconds, int maxSteps);
+   
+   //banks the real time elapsed since the last call (or since the clock was reset) and returns the
+   //number of whole steps to run for this frame
+   int advance();
+   
+//::ACCESSORS:://
+   double getStepSeconds() const { return stepSeconds; }
+   int getMaxSteps() const { return maxSteps; }
+   //returns the time left in the bank as a fraction of a step, in [0, 1)
+   double getAlpha() const { return banked/stepSeconds; }
+   //returns the number of steps dropped so far because a frame would have needed more than
+   //maxSteps
+   long getDroppedSteps() const { return droppedSteps; }
+   
+//::MUTATORS:://
+   //sets the length of a step. The banked time is kept, so a frame may pay out one step less or
+   //more than usual
+   void setStepSeconds(double seconds);
+   //sets the most steps paid out per frame
+   void setMaxSteps(int steps) { maxSteps = (steps < 1) ? 1 : steps; }
+   //empties the bank and restarts the clock, e.g. after the simulation was paused
+   void reset();
+   
+private:
+//::VARIABLES:://
+   Timer clock;
+   double stepSeconds, banked;
+   int maxSteps;
+   long droppedSteps;
+};
+
+#endif // FIXEDSTEP_H
@@ -0,0 +1,160 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: framewriter.cpp - Implementation for the FrameWriter class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "framewriter.h"
+#include "timer.h"
+#include <cstdio> //used for fopen(), fprintf(), fwrite(), sprintf()
+#include <cstring> //used for strlen(), strcpy()
+
+/* FrameWriter - CONSTRUCTOR
+ */
+FrameWriter::FrameWriter(const char *prefix, int width, int height, int bufferCount) :
+                         width(width), height(height), bufferCount(bufferCount)
+{
+   this->prefix = new char[strlen(prefix) + 1];
+   strcpy(this->prefix, prefix);
+   //room for the frame number and the extension
+   fileName = new char[strlen(prefix) + 16];
+   images = new unsigned char*[bufferCount];
+   for(int b = 0; b < bufferCount; b++) images[b] = new unsigned char[3*width*height];
+   frames = new int[bufferCount];
+   head = tail = queued = 0;
+   written = failed = 0;
+   waitSeconds = 0;
+   isQuitting = false;
+   
+   pthread_mutex_init(&lock, 0);
+   pthread_cond_init(&wake, 0);
+   pthread_cond_init(&space, 0);
+   isRunning = !pthread_create(&thread, 0, threadMain, this);
+}
+
+/* FrameWriter - DESTRUCTOR
+ */
+FrameWriter::~FrameWriter()
+{
+   finish();
+   pthread_cond_destroy(&space);
+   pthread_cond_destroy(&wake);
+   pthread_mutex_destroy(&lock);
+   for(int b = 0; b < bufferCount; b++) delete [] images[b];
+   delete [] images;
+   delete [] frames;
+   delete [] fileName;
+   delete [] prefix;
+}
+
+/* returns the buffer to fill with the next frame, waiting for one to be written if none is free
+ */
+unsigned char *FrameWriter::nextImage()
+{
+   Timer timer;
+   
+   pthread_mutex_lock(&lock);
+   while(queued == bufferCount) pthread_cond_wait(&space, &lock);
+   unsigned char *image = images[head];
+   pthread_mutex_unlock(&lock);
+   waitSeconds += timer.elapsed();
+   return image;
+}
+
+/* queues the buffer last returned by nextImage() to be written as frame number frame. Without a
+ * writing thread the frame is written at once
+ */
+void FrameWriter::write(int frame)
+{
+   if(!isRunning){
+      if(writeImage(images[head], frame)) written++;
+      else failed++;
+      return;
+   }
+   pthread_mutex_lock(&lock);
+   frames[head] = frame;
+   head = (head + 1)%bufferCount;
+   queued++;
+   pthread_cond_signal(&wake);
+   pthread_mutex_unlock(&lock);
+}
+
+/* counts the frame last returned by nextImage() as not written, as when its file cannot be written.
+ * Its buffer is not queued, so the next call to nextImage() returns it again
+ */
+void FrameWriter::skip()
+{
+   pthread_mutex_lock(&lock);
+   failed++;
+   pthread_mutex_unlock(&lock);
+}
+
+/* waits until every queued frame is written, then stops the thread
+ */
+void FrameWriter::finish()
+{
+   if(!isRunning) return;
+   pthread_mutex_lock(&lock);
+   isQuitting = true;
+   pthread_cond_signal(&wake);
+   pthread_mutex_unlock(&lock);
+   pthread_join(thread, 0);
+   isRunning = false;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* entry point of the writing thread. arg is the FrameWriter
+ */
+void *FrameWriter::threadMain(void *arg)
+{
+   static_cast<FrameWriter*>(arg)->run();
+   return 0;
+}
+
+/* writes queued frames until finish(). The lock is released while a frame is written, so the
+ * rendering thread can fill and queue other buffers meanwhile
+ */
+void FrameWriter::run()
+{
+   pthread_mutex_lock(&lock);
+   for(;;){
+      while(!queued && !isQuitting) pthread_cond_wait(&wake, &lock);
+      if(!queued) break;
+      const unsigned char *image = images[tail];
+      int frame = frames[tail];
+      pthread_mutex_unlock(&lock);
+      
+      bool isWritten = writeImage(image, frame);
+      
+      pthread_mutex_lock(&lock);
+      if(isWritten) written++;
+      else failed++;
+      tail = (tail + 1)%bufferCount;
+      queued--;
+      pthread_cond_signal(&space);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+/* writes an image as frame number frame. Rows are written top first, the reverse of how they are
+ * stored. Returns false if the file could not be written
+ */
+bool FrameWriter::writeImage(const unsigned char *image, int frame)
+{
+   sprintf(fileName, "%s%04d.ppm", prefix, frame);
+   FILE *out = fopen(fileName, "wb");
+   if(!out) return false;
+   
+   bool isWritten = fprintf(out, "P6\n%d %d\n255\n", width, height) > 0;
+   for(int row = height - 1; row >= 0 && isWritten; row--)
+      isWritten = fwrite(image + 3*width*row, 1, 3*width, out) == size_t(3*width);
+   return fclose(out) == 0 && isWritten;
+}
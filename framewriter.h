@@ -0,0 +1,78 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: framewriter.h - Interface for the FrameWriter class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <pthread.h> //used for pthread_t, pthread_mutex_t, pthread_cond_t
+
+/* Writes a sequence of rendered frames to disk as numbered binary PPM images on a thread of its
+ * own, so the rendering thread can go on to the next frame while the last is written. Frames pass
+ * through a fixed ring of image buffers: the rendering thread fills the buffer nextImage() returns
+ * and queues it with write(), waiting only when every buffer is still queued. Images are given
+ * bottom row first, as glReadPixels() reads them, with tightly packed RGB pixels
+ */
+class FrameWriter
+{
+public:
+   //constructor. Frame n of width x height pixels is written to <prefix><n>.ppm, n padded to four
+   //digits, through bufferCount image buffers. Starts the writing thread
+   FrameWriter(const char *prefix, int width, int height, int bufferCount);
+   //destructor. Writes the queued frames and joins the thread
+   ~FrameWriter();
+   
+   //returns the buffer to fill with the next frame, waiting for one to be written if none is free
+   unsigned char *nextImage();
+   //queues the buffer last returned by nextImage() to be written as frame number frame
+   void write(int frame);
+   //counts the frame last returned by nextImage() as not written, leaving its buffer free
+   void skip();
+   //waits until every queued frame is written, then stops the thread
+   void finish();
+   
+//::ACCESSORS:://
+   //returns the number of frames written, and that could not be written
+   int getWritten() const { return written; }
+   int getFailed() const { return failed; }
+   //returns the time the rendering thread spent in nextImage() waiting for a free buffer
+   double getWaitSeconds() const { return waitSeconds; }
+   
+private:
+//::VARIABLES:://
+   char *prefix, *fileName;
+   int width, height, bufferCount;
+   unsigned char **images;
+   int *frames;
+   //the next buffer to fill, the next to write and the number queued, guarded by lock
+   int head, tail, queued;
+   int written, failed;
+   double waitSeconds;
+   bool isRunning, isQuitting;
+   pthread_t thread;
+   pthread_mutex_t lock;
+   pthread_cond_t wake, space;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //entry point of the writing thread. arg is the FrameWriter
+   static void *threadMain(void *arg);
+   //writes queued frames until finish()
+   void run();
+   //writes an image as frame number frame. Returns false if the file could not be written
+   bool writeImage(const unsigned char *image, int frame);
+   
+   //not copyable
+   FrameWriter(const FrameWriter &);
+   FrameWriter& operator=(const FrameWriter &);
+};
+
+#endif // FRAMEWRITER_H
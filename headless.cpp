@@ -0,0 +1,460 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: headless.cpp - Batch simulation runner. Steps the skirt without opening a window so the
+         solver can be run and timed on machines with no display or OpenGL driver.
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "skirtt.h"
+#include "skirtbatch.h"
+#include "trajectoryrecorder.h"
+#include "profiler.h"
+#include "timer.h"
+#include <cstdlib> //used for atoi(), atof(), EXIT_SUCCESS, EXIT_FAILURE
+#include <cstdio> //used for printf(), sscanf()
+#include <cstring> //used for strcmp(), strstr()
+#include <cmath> //used for fabs()
+
+//Global Constants
+const int DEFAULT_STEPS = 1000;
+//explicit steps per second of clothSim's real-time clock
+const int REAL_TIME_RATE = 240;
+//explicit steps a batch takes per call, i.e. per frame of clothSim at 60 frames per second
+const int BATCH_FRAME_STEPS = 4;
+//steps from one recorded frame to the next unless given with -e: one frame of clothSim
+const int DEFAULT_RECORD_INTERVAL = 4;
+
+//prints the command line usage
+void usage(const char *prog);
+//steps a specialized skirt alongside the generic one and compares their speed and state
+template <int XRes, int YRes> void compare(Skirt &generic, int steps, double genericSeconds);
+//runs compare() if the resolution of the skirt has a specialized solver; returns false otherwise
+bool compareSpecialized(Skirt &generic, int steps, double genericSeconds);
+//prints the statistics of the timed sections and writes their trace to path; false if it could not
+//be written
+bool reportProfile(const char *path);
+//warm starts the skirt from the rest state cached in directory and reports how
+void warmStart(Skirt &skirt, const char *directory);
+//steps a batch of instances with their phases spread over a cycle and reports its throughput.
+//With a restDirectory, they start from the rest state cached there
+void runBatch(int instances, int steps, int xRes, int yRes, float amplitude, float frequency,
+              bool is3D, int threads, const Kernels &kernels, bool isCompared,
+              const char *restDirectory);
+
+//::MAIN:://////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+   int steps = DEFAULT_STEPS, threads = 1, xRes = Skirt::DEFAULT_X_RES, yRes = Skirt::DEFAULT_Y_RES;
+   int implicitStep = 0, xpbdStep = 0, constraintIterations = Skirt::DEFAULT_CONSTRAINT_ITERATIONS;
+   int instances = 0, recordInterval = DEFAULT_RECORD_INTERVAL, collisions = Skirt::NO_COLLISIONS;
+   float amplitude = 0, frequency = 0, windX = 0, windY = 0, windZ = 0;
+   bool is3D = true, isCompared = false, isNormalsRecorded = false;
+   bool isAerodynamic = false;
+   const char *restDirectory = 0, *loadPath = 0, *savePath = 0, *recordPath = 0, *tracePath = 0;
+   const Kernels *kernels = &bestKernels();
+   
+   for(int a = 1; a < argc; a++){
+      if(!strcmp(argv[a], "-n") && a+1 < argc)      steps = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-a") && a+1 < argc) amplitude = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-f") && a+1 < argc) frequency = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-t") && a+1 < argc) threads = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-x") && a+1 < argc) xRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-y") && a+1 < argc) yRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-i") && a+1 < argc) implicitStep = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-p") && a+1 < argc) xpbdStep = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-c") && a+1 < argc) constraintIterations = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-b") && a+1 < argc) instances = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-w") && a+1 < argc) restDirectory = argv[++a];
+      else if(!strcmp(argv[a], "-l") && a+1 < argc) loadPath = argv[++a];
+      else if(!strcmp(argv[a], "-o") && a+1 < argc) savePath = argv[++a];
+      else if(!strcmp(argv[a], "-r") && a+1 < argc) recordPath = argv[++a];
+      else if(!strcmp(argv[a], "-e") && a+1 < argc) recordInterval = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-g") && a+1 < argc) tracePath = argv[++a];
+      else if(!strcmp(argv[a], "-d") && a+1 < argc){
+         const char *list = argv[++a];
+         if(strstr(list, "body")) collisions |= Skirt::BODY_COLLISIONS;
+         if(strstr(list, "self")) collisions |= Skirt::SELF_COLLISIONS;
+      }
+      else if(!strcmp(argv[a], "-u") && a+1 < argc){
+         if(sscanf(argv[++a], "%f,%f,%f", &windX, &windY, &windZ) != 3){
+            usage(argv[0]);
+            return EXIT_FAILURE;
+         }
+         isAerodynamic = true;
+      }
+      else if(!strcmp(argv[a], "-v"))               isNormalsRecorded = true;
+      else if(!strcmp(argv[a], "-2"))               is3D = false;
+      else if(!strcmp(argv[a], "-3"))               is3D = true;
+      else if(!strcmp(argv[a], "-s"))               isCompared = true;
+      else if(!strcmp(argv[a], "-k") && a+1 < argc){
+         kernels = findKernels(argv[++a]);
+         if(!kernels){
+            printf("Unknown or unsupported kernels: %s\n", argv[a]);
+            return EXIT_FAILURE;
+         }
+      }
+      else{
+         usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(steps <= 0 || threads <= 0 || xRes < 3 || yRes < 3 || implicitStep < 0 || xpbdStep < 0 ||
+      (implicitStep && xpbdStep) || constraintIterations <= 0 || instances < 0 ||
+      recordInterval <= 0 ||
+      (instances && (implicitStep || xpbdStep || loadPath || savePath || recordPath)) ||
+      (restDirectory && loadPath) || (isCompared && !instances && (restDirectory || loadPath)) ||
+      ((collisions || isAerodynamic) && (instances || isCompared)) ||
+      ((collisions & Skirt::BODY_COLLISIONS) && !implicitStep && !xpbdStep && !loadPath)){
+      usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   if(instances){
+      runBatch(instances, steps, xRes, yRes, amplitude, frequency, is3D, threads, *kernels,
+               isCompared, restDirectory);
+      return EXIT_SUCCESS;
+   }
+   
+   Skirt skirt(xRes, yRes);
+   if(implicitStep){
+      skirt.setIntegrator(Skirt::IMPLICIT);
+      skirt.setImplicitStep(implicitStep);
+   }
+   if(xpbdStep){
+      skirt.setIntegrator(Skirt::XPBD);
+      skirt.setImplicitStep(xpbdStep);
+      skirt.setConstraintIterations(constraintIterations);
+   }
+   //the body allows a larger amplitude under the implicit and XPBD integrators
+   skirt.setCollisions(collisions);
+   skirt.setAerodynamic(isAerodynamic);
+   skirt.setWind(windX, windY, windZ);
+   skirt.setAmplitude(amplitude);
+   skirt.setFrequency(frequency);
+   skirt.setKernels(*kernels);
+   skirt.setThreadCount(threads);
+   if(is3D) skirt.rotate3D();
+   else skirt.rotate2D();
+   //a checkpoint brings its own motion, integrator and air
+   if(loadPath){
+      Timer timer;
+      if(!skirt.restoreState(loadPath)){
+         printf("Unable to restore a %dx%d checkpoint from %s\n", xRes, yRes, loadPath);
+         return EXIT_FAILURE;
+      }
+      printf("checkpoint restored from %s in %.3f ms\n", loadPath, 1e3*timer.elapsed());
+   }
+   
+   if(restDirectory) warmStart(skirt, restDirectory);
+   printf("clothSim headless: %dx%d vertices, %d steps, amplitude %g, frequency %g, %s rotation, "
+          "%s kernels, %d threads\n", skirt.getXRes(), skirt.getYRes(), steps,
+          skirt.getAmplitude(), skirt.getFrequency(), skirt.getIs3DRotation() ? "3D" : "2D",
+          skirt.getKernels().name, skirt.getThreadCount());
+   if(skirt.getCollisions())
+      printf("collisions with the %s\n",
+             (skirt.getCollisions() == Skirt::BODY_COLLISIONS) ? "body" :
+             (skirt.getCollisions() == Skirt::SELF_COLLISIONS) ? "skirt itself" :
+                                                                 "body and the skirt itself");
+   if(skirt.getIsAerodynamic())
+      printf("air drag and lift, wind (%g, %g, %g)\n", windX, windY, windZ);
+   if(skirt.getIntegrator() == Skirt::IMPLICIT)
+      printf("implicit integrator: each step covers %d explicit steps\n", skirt.getImplicitStep());
+   if(skirt.getIntegrator() == Skirt::XPBD)
+      printf("XPBD integrator: each step covers %d explicit steps, %d iterations each\n",
+             skirt.getImplicitStep(), skirt.getConstraintIterations());
+   
+   TrajectoryRecorder *recorder = 0;
+   if(recordPath){
+      recorder = new TrajectoryRecorder(recordPath, skirt, recordInterval, isNormalsRecorded);
+      if(!recorder->isOpen()){
+         printf("Unable to open %s for recording\n", recordPath);
+         return EXIT_FAILURE;
+      }
+      //the state the skirt starts from is the first frame
+      recorder->record(skirt);
+   }
+   
+   long iterations = 0;
+   Timer timer;
+   for(int s = 0; s < steps; s++){
+      skirt.updateSkirt();
+      iterations += skirt.getSolverIterations();
+      if(recorder) recorder->record(skirt);
+   }
+   double seconds = timer.elapsed();
+   
+   printf("elapsed: %.3f s\n", seconds);
+   printf("steps/second: %.1f\n", steps/seconds);
+   printf("ns/vertex/step: %.2f\n", 1e9*seconds/(double(steps)*skirt.getVertexCount()));
+   if(skirt.getIntegrator() == Skirt::IMPLICIT){
+      printf("conjugate gradient iterations/step: %.1f\n", double(iterations)/steps);
+   }
+   if(skirt.getIntegrator() != Skirt::EXPLICIT)
+      printf("hem height: %g\n", skirt.getY(0, skirt.getYRes()-1));
+   if(tracePath && !reportProfile(tracePath)){
+      printf("Unable to write a trace to %s\n", tracePath);
+      return EXIT_FAILURE;
+   }
+   if(recorder){
+      recorder->finish();
+      int frames = recorder->getFrames();
+      int values = (isNormalsRecorded ? 6 : 3)*skirt.getVertexCount();
+      printf("recorded %d frames to %s: %.1f bytes/frame, %.1f%% of %d as floats\n", frames,
+             recordPath, double(recorder->getBytes())/frames,
+             100.0*recorder->getBytes()/(double(frames)*values*sizeof(float)),
+             int(values*sizeof(float)));
+      printf("recording on the simulating thread: %.3f ms/frame, %.1f%% of the elapsed time, "
+             "%.3f s of it waiting for the writer\n", 1e3*recorder->getRecordSeconds()/frames,
+             100*recorder->getRecordSeconds()/seconds, recorder->getWaitSeconds());
+      bool isFailed = recorder->getFailed();
+      delete recorder;
+      if(isFailed){
+         printf("Unable to write %s\n", recordPath);
+         return EXIT_FAILURE;
+      }
+   }
+   if(savePath){
+      if(!skirt.saveState(savePath)){
+         printf("Unable to write a checkpoint to %s\n", savePath);
+         return EXIT_FAILURE;
+      }
+      printf("checkpoint written to %s\n", savePath);
+   }
+   if(isCompared && !compareSpecialized(skirt, steps, seconds)){
+      printf("No specialized solver for %dx%d; built for 120x18, 240x36 and 256x256\n",
+             skirt.getXRes(), skirt.getYRes());
+      return EXIT_FAILURE;
+   }
+   
+   return EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* prints the command line usage
+ */
+void usage(const char *prog)
+{
+   printf("usage: %s [-n steps] [-a amplitude] [-f frequency] [-2 | -3] [-k kernels] [-t threads]\n"
+          "       [-x columns] [-y rows] [-i explicit steps] [-p explicit steps] [-c iterations]\n"
+          "       [-s] [-b instances] [-w directory] [-l checkpoint] [-o checkpoint]\n"
+          "       [-r trajectory] [-e steps] [-v] [-g trace] [-d collisions] [-u x,y,z]\n", prog);
+   printf("   -n  number of simulation steps to run (default %d)\n", DEFAULT_STEPS);
+   printf("   -a  amplitude of the oscillatory motion in degrees (0 to 30, 60 with the body)\n");
+   printf("   -f  frequency of the oscillatory motion in radians per step (0 to 0.1)\n");
+   printf("   -2  2D rotation about the z-axis\n");
+   printf("   -3  3D rotation about both the x-axis and z-axis (default)\n");
+   printf("   -k  solver kernels: scalar, sse2 or avx2 (default: fastest the CPU supports)\n");
+   printf("   -t  number of solver threads (default 1)\n");
+   printf("   -x  vertices around the waist (default %d)\n", Skirt::DEFAULT_X_RES);
+   printf("   -y  rows of vertices from waist to hem (default %d)\n", Skirt::DEFAULT_Y_RES);
+   printf("   -i  use the implicit integrator, each step covering the given number of explicit\n"
+          "       steps\n");
+   printf("   -p  use the XPBD integrator, each step covering the given number of explicit\n"
+          "       steps\n");
+   printf("   -c  constraint iterations of each explicit step an XPBD step covers (default %d)\n",
+          Skirt::DEFAULT_CONSTRAINT_ITERATIONS);
+   printf("   -s  also run the solver specialized at compile time for this resolution and\n"
+          "       compare the two\n");
+   printf("   -b  step the given number of explicit instances at once as a SkirtBatch, their\n"
+          "       phases spread over a cycle. With -s, also step the last one as a Skirt with\n"
+          "       the scalar kernels and compare the two\n");
+   printf("   -w  start from the skirt at rest, restored from the rest state cached in the given\n"
+          "       directory, or settled and cached there if there is none\n");
+   printf("   -l  restore the skirt, its motion, integrator and air from a checkpoint first\n");
+   printf("   -o  write a checkpoint of the skirt once the steps are done\n");
+   printf("   -r  record the motion to the given trajectory file\n");
+   printf("   -e  steps from one recorded frame to the next (default %d)\n",
+          DEFAULT_RECORD_INTERVAL);
+   printf("   -v  record the vertex normals too\n");
+   printf("   -g  time the phases of the last %d steps, print their statistics and write them to\n"
+          "       the given file as a Chrome trace\n", Profiler::HISTORY);
+   printf("   -d  resolve the collisions in the given comma separated list: body (the hips and\n"
+          "       legs, with -i or -p) and self (the skirt with itself)\n");
+   printf("   -u  apply the drag and lift of air blowing at the given comma separated velocity;\n"
+          "       0,0,0 for still air\n");
+}
+
+/* prints the minimum, average and 99th percentile of each timed section over the samples it
+ * keeps, the last HISTORY steps, and writes the samples to path as a Chrome trace. Returns false
+ * if the trace could not be written
+ */
+bool reportProfile(const char *path)
+{
+   if(!Profiler::isCompiledIn()){
+      printf("phase timers compiled out; build with make profile to time the steps\n");
+      return true;
+   }
+   printf("%-12s %8s %10s %10s %10s\n", "section", "samples", "min us", "avg us", "p99 us");
+   for(int s = 0; s < Profiler::SECTION_COUNT; s++){
+      Profiler::Section section = Profiler::Section(s);
+      Profiler::Stats stats = Profiler::getStats(section, Profiler::HISTORY);
+      if(stats.samples)
+         printf("%-12s %8d %10.2f %10.2f %10.2f\n", Profiler::getName(section), stats.samples,
+                1e6*stats.min, 1e6*stats.avg, 1e6*stats.p99);
+   }
+   long events = Profiler::writeTrace(path);
+   if(events < 0) return false;
+   printf("trace of %ld timed events written to %s\n", events, path);
+   return true;
+}
+
+/* steps a SkirtT of the resolution of the generic skirt with the same motion for the same number
+ * of steps, then prints its timings, its speedup over the generic solver, and the largest distance
+ * between a vertex of the two skirts along any axis. The two evaluate the same springs in a
+ * different order, so they agree to within rounding until the motion amplifies the difference
+ */
+template <int XRes, int YRes>
+void compare(Skirt &generic, int steps, double genericSeconds)
+{
+   SkirtT<XRes,YRes> skirt;
+   skirt.setAmplitude(generic.getAmplitude());
+   skirt.setFrequency(generic.getFrequency());
+   if(generic.getIs3DRotation()) skirt.rotate3D();
+   else skirt.rotate2D();
+   
+   Timer timer;
+   for(int s = 0; s < steps; s++)
+      skirt.updateSkirt();
+   double seconds = timer.elapsed();
+   
+   float maxDiff = 0;
+   for(int j = 0; j < YRes; j++){
+      for(int i = 0; i < XRes; i++){
+         float dx = fabs(skirt.getX(i,j) - generic.getX(i,j));
+         float dy = fabs(skirt.getY(i,j) - generic.getY(i,j));
+         float dz = fabs(skirt.getZ(i,j) - generic.getZ(i,j));
+         if(dx > maxDiff) maxDiff = dx;
+         if(dy > maxDiff) maxDiff = dy;
+         if(dz > maxDiff) maxDiff = dz;
+      }
+   }
+   
+   printf("specialized %dx%d elapsed: %.3f s\n", XRes, YRes, seconds);
+   printf("specialized steps/second: %.1f\n", steps/seconds);
+   printf("specialized ns/vertex/step: %.2f\n", 1e9*seconds/(double(steps)*XRes*YRes));
+   printf("speedup over generic: %.2fx\n", genericSeconds/seconds);
+   printf("max vertex difference: %g\n", maxDiff);
+}
+
+/* runs compare() if the resolution of the skirt has a specialized solver; returns false otherwise.
+ * Each resolution listed here is a separate instantiation of SkirtT
+ */
+bool compareSpecialized(Skirt &generic, int steps, double genericSeconds)
+{
+   int xRes = generic.getXRes(), yRes = generic.getYRes();
+   
+   if(xRes == 120 && yRes == 18)        compare<120,18>(generic, steps, genericSeconds);
+   else if(xRes == 240 && yRes == 36)   compare<240,36>(generic, steps, genericSeconds);
+   else if(xRes == 256 && yRes == 256)  compare<256,256>(generic, steps, genericSeconds);
+   else return false;
+   return true;
+}
+
+/* warm starts the skirt from the rest state cached in directory, and reports whether it was
+ * restored or had to settle from the initial cone, and how long that took
+ */
+void warmStart(Skirt &skirt, const char *directory)
+{
+   Timer timer;
+   bool isCached;
+   int settled = skirt.warmStart(directory, &isCached);
+   double seconds = timer.elapsed();
+   
+   if(!settled) printf("rest state: restored from %s in %.3f ms\n", directory, 1e3*seconds);
+   else if(isCached)
+      printf("rest state: settled in %d steps, %.1f ms, and cached in %s\n", settled, 1e3*seconds,
+             directory);
+   else printf("rest state: settled in %d steps, %.1f ms; unable to cache it in %s\n", settled,
+               1e3*seconds, directory);
+}
+
+/* steps a SkirtBatch of the given number of instances, all with the same motion but their phases
+ * spread evenly over a cycle, with the batch kernels for the given kernels' instruction set.
+ * Prints its throughput and how many instances it could step in real time. If isCompared, also
+ * steps the last instance alone as a Skirt with the scalar kernels and prints how far apart the
+ * two ended up; the batch evaluates the same operations in the same order, so that is zero unless
+ * the compiler contracted them differently. With a restDirectory, every instance starts from the
+ * rest state cached there
+ */
+void runBatch(int instances, int steps, int xRes, int yRes, float amplitude, float frequency,
+              bool is3D, int threads, const Kernels &kernels, bool isCompared,
+              const char *restDirectory)
+{
+   SkirtBatch batch(instances, xRes, yRes);
+   batch.setThreadCount(threads);
+   //the batch has no scalar or SSE2 set of its own; its baseline loops stand in for both
+   if(strcmp(kernels.name, "avx2")) batch.setKernels(baselineBatchKernels());
+   for(int k = 0; k < instances; k++){
+      batch.setAmplitude(k, amplitude);
+      batch.setFrequency(k, frequency);
+      batch.setTheta(k, 2*M_PI*k/instances);
+      if(is3D) batch.rotate3D(k);
+      else batch.rotate2D(k);
+   }
+   if(restDirectory){
+      Skirt rest(xRes, yRes);
+      rest.setThreadCount(threads);
+      warmStart(rest, restDirectory);
+      for(int k = 0; k < instances; k++) batch.setState(k, rest);
+   }
+   
+   printf("clothSim headless batch: %d instances of %dx%d vertices in packs of %d, %d steps, "
+          "amplitude %g, frequency %g, %s rotation, %s kernels, %d threads\n", instances,
+          batch.getXRes(), batch.getYRes(), int(SkirtBatch::LANES), steps, batch.getAmplitude(0),
+          batch.getFrequency(0), is3D ? "3D" : "2D", batch.getKernels().name,
+          batch.getThreadCount());
+   
+   const int last = instances-1;
+   const float lastTheta = batch.getTheta(last);
+   Timer timer;
+   for(int s = 0; s < steps; s += BATCH_FRAME_STEPS)
+      batch.step((steps - s < BATCH_FRAME_STEPS) ? steps - s : BATCH_FRAME_STEPS);
+   double seconds = timer.elapsed();
+   double instanceSteps = double(steps)*instances;
+   
+   printf("elapsed: %.3f s\n", seconds);
+   printf("instance steps/second: %.1f\n", instanceSteps/seconds);
+   printf("real-time instances at %d steps/second: %.1f\n", REAL_TIME_RATE,
+          instanceSteps/seconds/REAL_TIME_RATE);
+   printf("ns/vertex/step: %.2f\n", 1e9*seconds/(instanceSteps*batch.getVertexCount()));
+   if(!isCompared) return;
+   
+   Skirt skirt(xRes, yRes);
+   skirt.setKernels(scalarKernels());
+   skirt.setAmplitude(amplitude);
+   skirt.setFrequency(frequency);
+   skirt.setTheta(lastTheta);
+   if(is3D) skirt.rotate3D();
+   else skirt.rotate2D();
+   if(restDirectory && skirt.warmStart(restDirectory))
+      printf("Unable to restore the rest state; the Skirt settled on its own kernels instead\n");
+   for(int s = 0; s < steps; s++)
+      skirt.updateSkirt();
+   
+   float maxDiff = 0, maxNormalDiff = 0;
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         float dx = fabs(batch.getX(last,i,j) - skirt.getX(i,j));
+         float dy = fabs(batch.getY(last,i,j) - skirt.getY(i,j));
+         float dz = fabs(batch.getZ(last,i,j) - skirt.getZ(i,j));
+         if(dx > maxDiff) maxDiff = dx;
+         if(dy > maxDiff) maxDiff = dy;
+         if(dz > maxDiff) maxDiff = dz;
+         float nx = fabs(batch.getNormalX(last,i,j) - skirt.getNormalX(i,j));
+         float ny = fabs(batch.getNormalY(last,i,j) - skirt.getNormalY(i,j));
+         float nz = fabs(batch.getNormalZ(last,i,j) - skirt.getNormalZ(i,j));
+         if(nx > maxNormalDiff) maxNormalDiff = nx;
+         if(ny > maxNormalDiff) maxNormalDiff = ny;
+         if(nz > maxNormalDiff) maxNormalDiff = nz;
+      }
+   }
+   printf("max vertex difference from Skirt: %g\n", maxDiff);
+   printf("max normal difference from Skirt: %g\n", maxNormalDiff);
+}
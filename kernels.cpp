@@ -0,0 +1,276 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: kernels.cpp - Scalar reference kernels and run-time selection of the fastest kernels
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "kernels.h"
+#include <cmath> //used for sqrt(), fabs()
+#include <cstring> //used for strcmp()
+#include <cfloat> //used for FLT_MIN
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h> //used for __get_cpuid(), __get_cpuid_count()
+#endif
+
+using namespace std;
+
+//sums the cross products of the edges of the triangles around vertex v into (nx, ny, nz)
+static void sumFaceNormals(const VectorArray &position, int v, int left, int right, int stride,
+                           bool hasAbove, bool hasBelow, float &nx, float &ny, float &nz);
+
+//::SCALAR KERNELS:://
+
+/* accumulates the force of springs [begin, end) into their endpoints: the force on a into forceA
+ * and the force on b into forceB. Each spring's length and direction are computed once. A spring
+ * stretched by s pulls its endpoints together with magnitude ks*s, split across x, y and z by the
+ * squared direction cosines (dx/L)^2, (dy/L)^2, (dz/L)^2 with the sign of the respective component
+ */
+void scalarSpringForces(const SpringArray &springs, int begin, int end,
+                        const VectorArray &position, VectorArray &forceA, VectorArray &forceB)
+{
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   
+   for(int s = begin; s < end; s++){
+      int a = springs.a[s], b = springs.b[s];
+      float dx = px[a] - px[b], dy = py[a] - py[b], dz = pz[a] - pz[b];
+      float lengthSq = dx*dx + dy*dy + dz*dz, length = sqrt(lengthSq);
+      float stretch = (length - springs.rest[s])/lengthSq;
+      //signed squared components of a (unit) pull from a toward b
+      float ux = dx*fabs(dx)*stretch, uy = dy*fabs(dy)*stretch, uz = dz*fabs(dz)*stretch;
+      forceA.x[a] -= springs.ksA[s]*ux;
+      forceA.y[a] -= springs.ksA[s]*uy;
+      forceA.z[a] -= springs.ksA[s]*uz;
+      forceB.x[b] += springs.ksB[s]*ux;
+      forceB.y[b] += springs.ksB[s]*uy;
+      forceB.z[b] += springs.ksB[s]*uz;
+   }
+}
+
+/* integrates count velocities starting at first: spring force (the sum of force and forceAcross),
+ * then gravity (y only), then damping by the fraction kd
+ */
+void scalarIntegrateVelocity(VectorArray &velocity, const VectorArray &force,
+                             const VectorArray &forceAcross, int first, int count, float hv,
+                             float gravity, float kd)
+{
+   for(int v = first; v < first+count; v++){
+      //Velocity Update: Spring Forces
+      velocity.x[v] += hv*(force.x[v] + forceAcross.x[v]);
+      velocity.y[v] += hv*(force.y[v] + forceAcross.y[v]);
+      velocity.z[v] += hv*(force.z[v] + forceAcross.z[v]);
+      //Velocity Update: Gravity
+      velocity.y[v] += hv*gravity;
+      //Velocity Update: Spring Damping
+      velocity.x[v] -= kd*velocity.x[v];
+      velocity.y[v] -= kd*velocity.y[v];
+      velocity.z[v] -= kd*velocity.z[v];
+   }
+}
+
+/* integrates count positions starting at first from their velocities
+ */
+void scalarIntegratePosition(VectorArray &position, const VectorArray &velocity, int first,
+                             int count, float hp)
+{
+   for(int v = first; v < first+count; v++){
+      position.x[v] += hp*velocity.x[v];
+      position.y[v] += hp*velocity.y[v];
+      position.z[v] += hp*velocity.z[v];
+   }
+}
+
+/* writes the unit normals of count vertices starting at first, as scalarVertexNormal() with the
+ * left and right neighbours of each at the entries next to it
+ */
+void scalarVertexNormals(const VectorArray &position, VectorArray &normals, int first, int count,
+                         int stride, bool hasAbove, bool hasBelow)
+{
+   for(int v = first; v < first+count; v++)
+      scalarVertexNormal(position, normals, v, -1, 1, stride, hasAbove, hasBelow);
+}
+
+/* writes the unit normals of count vertices starting at first, as scalarVertexNormalAir() with the
+ * left and right neighbours of each at the entries next to it
+ */
+void scalarVertexNormalsAir(const VectorArray &position, VectorArray &velocity,
+                            VectorArray &normals, int first, int count, int stride, bool hasAbove,
+                            bool hasBelow, const AirFlow &air)
+{
+   for(int v = first; v < first+count; v++)
+      scalarVertexNormalAir(position, velocity, normals, v, -1, 1, stride, hasAbove, hasBelow, air);
+}
+
+/* writes the unit normal of vertex v of a mesh of rows stride entries apart: the normalized sum of
+ * the face normals of the triangles around it (see sumFaceNormals()). Its left and right
+ * neighbours are at v+left and v+right; the rows above and below exist if hasAbove and hasBelow
+ */
+void scalarVertexNormal(const VectorArray &position, VectorArray &normals, int v, int left,
+                        int right, int stride, bool hasAbove, bool hasBelow)
+{
+   float nx, ny, nz;
+   
+   sumFaceNormals(position, v, left, right, stride, hasAbove, hasBelow, nx, ny, nz);
+   //a vertex with no area around it gets a zero normal rather than a NaN
+   float lengthSq = nx*nx + ny*ny + nz*nz;
+   float inverse = 1/sqrt((lengthSq > FLT_MIN) ? lengthSq : FLT_MIN);
+   normals.x[v] = nx*inverse;
+   normals.y[v] = ny*inverse;
+   normals.z[v] = nz*inverse;
+}
+
+/* writes the unit normal of vertex v as scalarVertexNormal(), and adds to its velocity the drag
+ * and lift of the air on the faces around it from the same sum of face normals N, which is 6 times
+ * the vertex's share A of their area along their mean normal n. With u the velocity of the vertex
+ * relative to the wind and c the cosine between u and n, a flat plate of area A feels
+ *    drag = -drag*A*|u|^2*|c| u/|u|                   along -u
+ *    lift =  lift*A*|u|^2*c (c u/|u| - n)             across u, most at 45 degrees
+ * which in terms of N and s = N.u (air's coefficients hold the 1/6) are
+ *    -drag*|s| u   and   lift*(s/|N|)((s/|u|) u - |u| N)
+ * and take no square root but that of |u|. Either side of the face may face the air; the sign of
+ * c cancels in both. The forces are applied explicitly, so drag*|s| and lift*|s| are capped at 1
+ */
+void scalarVertexNormalAir(const VectorArray &position, VectorArray &velocity,
+                           VectorArray &normals, int v, int left, int right, int stride,
+                           bool hasAbove, bool hasBelow, const AirFlow &air)
+{
+   float nx, ny, nz;
+   
+   sumFaceNormals(position, v, left, right, stride, hasAbove, hasBelow, nx, ny, nz);
+   float lengthSq = nx*nx + ny*ny + nz*nz;
+   float inverse = 1/sqrt((lengthSq > FLT_MIN) ? lengthSq : FLT_MIN);
+   normals.x[v] = nx*inverse;
+   normals.y[v] = ny*inverse;
+   normals.z[v] = nz*inverse;
+   //the air force, as a change of velocity over the step
+   float ux = velocity.x[v] - air.windX, uy = velocity.y[v] - air.windY,
+         uz = velocity.z[v] - air.windZ;
+   float speedSq = ux*ux + uy*uy + uz*uz, s = nx*ux + ny*uy + nz*uz;
+   float inverseSpeed = 1/sqrt((speedSq > FLT_MIN) ? speedSq : FLT_MIN);
+   float speed = speedSq*inverseSpeed;
+   //neither force changes the relative velocity by more than itself over a step, however large
+   //the face or long the step. lift*s/|N| is taken as (lift*|s|)(sign of s)/|N| to cap it
+   float absS = fabs(s), dragged = air.drag*absS, lifted = air.lift*absS;
+   dragged = (dragged < 1) ? dragged : 1;
+   lifted = (lifted < 1) ? lifted : 1;
+   float liftT = ((s < 0) ? -lifted : lifted)*inverse;
+   float along = -dragged + liftT*(s*inverseSpeed);
+   float across = -liftT*speed;
+   velocity.x[v] += along*ux + across*nx;
+   velocity.y[v] += along*uy + across*ny;
+   velocity.z[v] += along*uz + across*nz;
+}
+
+//::STATIC FUNCTIONS:://
+
+/* sums the face normals of the triangles around vertex v into (nx, ny, nz), each as the cross
+ * product of two of its edges, so in proportion to its area. Each quad of the mesh is split along
+ * the diagonal from its upper left to its lower right corner, so with e the edges from v to its
+ * neighbours (l)eft, (r)ight, (u)p, (d)own, up-left (ul) and down-right (dr), the six triangles
+ * around v sum to
+ *    r x dr + dr x d + d x l    (the strip below)
+ *  + l x ul + ul x u + u x r    (the strip above)
+ * which is computed as dr x (d - r) + d x l + ul x (u - l) + u x r
+ */
+void sumFaceNormals(const VectorArray &position, int v, int left, int right, int stride,
+                    bool hasAbove, bool hasBelow, float &nx, float &ny, float &nz)
+{
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   float lx = px[v+left] - px[v], ly = py[v+left] - py[v], lz = pz[v+left] - pz[v];
+   float rx = px[v+right] - px[v], ry = py[v+right] - py[v], rz = pz[v+right] - pz[v];
+   
+   nx = ny = nz = 0;
+   if(hasBelow){
+      int d = v+stride, dr = d+right;
+      float dx = px[d] - px[v], dy = py[d] - py[v], dz = pz[d] - pz[v];
+      float ex = px[dr] - px[v], ey = py[dr] - py[v], ez = pz[dr] - pz[v];
+      float fx = dx - rx, fy = dy - ry, fz = dz - rz;
+      nx += (ey*fz - ez*fy) + (dy*lz - dz*ly);
+      ny += (ez*fx - ex*fz) + (dz*lx - dx*lz);
+      nz += (ex*fy - ey*fx) + (dx*ly - dy*lx);
+   }
+   if(hasAbove){
+      int u = v-stride, ul = u+left;
+      float ux = px[u] - px[v], uy = py[u] - py[v], uz = pz[u] - pz[v];
+      float ex = px[ul] - px[v], ey = py[ul] - py[v], ez = pz[ul] - pz[v];
+      float fx = ux - lx, fy = uy - ly, fz = uz - lz;
+      nx += (ey*fz - ez*fy) + (uy*rz - uz*ry);
+      ny += (ez*fx - ex*fz) + (uz*rx - ux*rz);
+      nz += (ex*fy - ey*fx) + (ux*ry - uy*rx);
+   }
+}
+
+//::CPU DETECTION:://
+
+/* returns true if the CPU supports SSE2
+ */
+bool cpuHasSSE2()
+{
+#if defined(__i386__) || defined(__x86_64__)
+   unsigned int eax, ebx, ecx, edx;
+   if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+   return edx & bit_SSE2;
+#else
+   return false;
+#endif
+}
+
+/* returns true if the CPU supports AVX2 and FMA and the OS saves the AVX registers on a context
+ * switch
+ */
+bool cpuHasAVX2()
+{
+#if defined(__i386__) || defined(__x86_64__)
+   unsigned int eax, ebx, ecx, edx, xcr0Low, xcr0High;
+   if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+   if(!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) || !(ecx & bit_FMA)) return false;
+   //XCR0 bits 1 and 2: the OS preserves the SSE and AVX state
+   __asm__ ("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+   if((xcr0Low & 6) != 6) return false;
+   if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+   return ebx & bit_AVX2;
+#else
+   return false;
+#endif
+}
+
+//::KERNEL SELECTION:://
+
+/* returns the scalar reference kernels
+ */
+const Kernels &scalarKernels()
+{
+   static const Kernels kernels = { "scalar", scalarSpringForces, scalarIntegrateVelocity,
+                                    scalarIntegratePosition, scalarVertexNormals,
+                                    scalarVertexNormalsAir };
+   return kernels;
+}
+
+/* returns the fastest kernels supported by this CPU, as determined by CPUID on first use
+ */
+const Kernels &bestKernels()
+{
+   static const Kernels *best = 0;
+   if(!best){
+      if(cpuHasAVX2())      best = &avx2Kernels();
+      else if(cpuHasSSE2()) best = &sse2Kernels();
+      else                  best = &scalarKernels();
+   }
+   return *best;
+}
+
+/* returns the kernels with the given name, or 0 if unknown or unsupported by this CPU
+ */
+const Kernels *findKernels(const char *name)
+{
+   if(!strcmp(name, "scalar"))                 return &scalarKernels();
+   if(!strcmp(name, "sse2") && cpuHasSSE2())   return &sse2Kernels();
+   if(!strcmp(name, "avx2") && cpuHasAVX2())   return &avx2Kernels();
+   return 0;
+}
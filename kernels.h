@@ -0,0 +1,108 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: kernels.h - Interchangeable implementations of the solver's inner loops
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+//structure-of-arrays storage for a per-vertex vector field (positions, velocities or normals).
+//Each component is one contiguous, aligned, row-major buffer
+struct VectorArray { float *x, *y, *z; };
+
+//the spring topology of the mesh as parallel arrays, one entry per edge. Each spring joins vertex a
+//to vertex b (indices into the VectorArray buffers) and is evaluated once per step. ksA and ksB are
+//the stiffness felt by a and b respectively, so the per-row stiffness profile survives on the
+//springs joining two rows; it is 0 for an endpoint in the pinned rows.
+//Springs are grouped by the row of a: the springs of row j are [rowStart[j], rowStart[j+1]), and
+//those from crossStart[j] on have b in row j+1 instead of row j
+struct SpringArray { int *a, *b, *rowStart, *crossStart, count; float *rest, *ksA, *ksB; };
+
+//the air the skirt moves through, as vertexNormalsAir takes it: the wind velocity, and the drag and
+//lift coefficients, each already multiplied by the velocity step and divided by 6 (the sum of the
+//cross products around a vertex is 6 times its share of the area of the faces around it)
+struct AirFlow { float windX, windY, windZ, drag, lift; };
+
+/* A set of implementations of the per-step loops of the Skirt solver. The scalar set is the
+ * reference; the SSE2 and AVX2 sets process 4 and 8 vertices or springs per instruction and agree
+ * with it up to floating point rounding.
+ */
+struct Kernels
+{
+   //name of the instruction set used ("scalar", "sse2" or "avx2")
+   const char *name;
+   //accumulates the force of springs [begin, end) into their endpoints: the force on a into forceA
+   //and the force on b into forceB
+   void (*springForces)(const SpringArray &springs, int begin, int end,
+                        const VectorArray &position, VectorArray &forceA, VectorArray &forceB);
+   //integrates count velocities starting at first: spring force (the sum of force and
+   //forceAcross), then gravity (y only), then damping by the fraction kd
+   void (*integrateVelocity)(VectorArray &velocity, const VectorArray &force,
+                             const VectorArray &forceAcross, int first, int count, float hv,
+                             float gravity, float kd);
+   //integrates count positions starting at first from their velocities
+   void (*integratePosition)(VectorArray &position, const VectorArray &velocity, int first,
+                             int count, float hp);
+   //writes the unit normals of count vertices starting at first, as scalarVertexNormal() with the
+   //left and right neighbours of each at the entries next to it
+   void (*vertexNormals)(const VectorArray &position, VectorArray &normals, int first, int count,
+                         int stride, bool hasAbove, bool hasBelow);
+   //writes the unit normals of count vertices starting at first as vertexNormals does, and in the
+   //same sweep adds the drag and lift of the air on the faces around each to its velocity, as
+   //scalarVertexNormalAir()
+   void (*vertexNormalsAir)(const VectorArray &position, VectorArray &velocity,
+                            VectorArray &normals, int first, int count, int stride,
+                            bool hasAbove, bool hasBelow, const AirFlow &air);
+};
+
+//the scalar reference kernels. See Kernels for what each does. The vectorized kernels also use
+//these for the remainders they cannot process a full vector at a time
+void scalarSpringForces(const SpringArray &springs, int begin, int end,
+                        const VectorArray &position, VectorArray &forceA, VectorArray &forceB);
+void scalarIntegrateVelocity(VectorArray &velocity, const VectorArray &force,
+                             const VectorArray &forceAcross, int first, int count, float hv,
+                             float gravity, float kd);
+void scalarIntegratePosition(VectorArray &position, const VectorArray &velocity, int first,
+                             int count, float hp);
+void scalarVertexNormals(const VectorArray &position, VectorArray &normals, int first, int count,
+                         int stride, bool hasAbove, bool hasBelow);
+void scalarVertexNormalsAir(const VectorArray &position, VectorArray &velocity,
+                            VectorArray &normals, int first, int count, int stride, bool hasAbove,
+                            bool hasBelow, const AirFlow &air);
+//writes the unit normal of vertex v of a mesh of rows stride entries apart: the normalized sum of
+//the face normals of the triangles around it, gathered from the positions of its neighbours. Its
+//left and right neighbours are at v+left and v+right; the rows above and below exist if hasAbove
+//and hasBelow
+void scalarVertexNormal(const VectorArray &position, VectorArray &normals, int v, int left,
+                        int right, int stride, bool hasAbove, bool hasBelow);
+//writes the unit normal of vertex v as scalarVertexNormal(), and adds to its velocity the drag
+//and lift of the air on the faces around it, taken as one face of the vertex's share of their area
+//and of their summed normal, moving at the vertex's velocity
+void scalarVertexNormalAir(const VectorArray &position, VectorArray &velocity,
+                           VectorArray &normals, int v, int left, int right, int stride,
+                           bool hasAbove, bool hasBelow, const AirFlow &air);
+
+//returns the scalar reference kernels
+const Kernels &scalarKernels();
+//returns the fastest kernels supported by this CPU, as determined by CPUID on first use
+const Kernels &bestKernels();
+//returns the kernels with the given name, or 0 if unknown or unsupported by this CPU
+const Kernels *findKernels(const char *name);
+//returns true if the CPU supports SSE2
+bool cpuHasSSE2();
+//returns true if the CPU supports AVX2 and FMA and the OS saves the AVX registers
+bool cpuHasAVX2();
+
+//the vectorized sets. Only call these when findKernels() reports the CPU supports them
+const Kernels &sse2Kernels();
+const Kernels &avx2Kernels();
+
+#endif // KERNELS_H
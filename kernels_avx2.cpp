@@ -0,0 +1,240 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: kernels_avx2.cpp - AVX2/FMA kernels, processing 8 springs or vertices per instruction
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "kernels.h"
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h> //used for the AVX2 and FMA intrinsics
+#include <cfloat> //used for FLT_MIN
+
+/* returns the component ay*bz - az*by of a cross product, for 8 pairs of vectors at a time
+ */
+static inline __m256 crossTerm(__m256 ay, __m256 az, __m256 by, __m256 bz)
+{
+   return _mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by));
+}
+
+/* returns one component of the edges from 8 vertices to 8 consecutive others starting at p[to]
+ */
+static inline __m256 edge(const float *p, int to, __m256 from)
+{
+   return _mm256_sub_ps(_mm256_loadu_ps(p + to), from);
+}
+
+/* sums the face normals of the triangles around 8 consecutive vertices starting at v into
+ * (nx, ny, nz), as sumFaceNormals() in kernels.cpp with the left and right neighbours of each at
+ * the entries next to it
+ */
+static inline void sumFaceNormals(const VectorArray &position, int v, int stride, bool hasAbove,
+                                  bool hasBelow, __m256 &nx, __m256 &ny, __m256 &nz)
+{
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   __m256 x = _mm256_loadu_ps(px + v), y = _mm256_loadu_ps(py + v), z = _mm256_loadu_ps(pz + v);
+   __m256 lx = edge(px, v-1, x), ly = edge(py, v-1, y), lz = edge(pz, v-1, z);
+   __m256 rx = edge(px, v+1, x), ry = edge(py, v+1, y), rz = edge(pz, v+1, z);
+   
+   nx = ny = nz = _mm256_setzero_ps();
+   if(hasBelow){
+      const int d = v+stride;
+      __m256 dx = edge(px, d, x), dy = edge(py, d, y), dz = edge(pz, d, z);
+      __m256 ex = edge(px, d+1, x), ey = edge(py, d+1, y), ez = edge(pz, d+1, z);
+      __m256 fx = _mm256_sub_ps(dx, rx), fy = _mm256_sub_ps(dy, ry), fz = _mm256_sub_ps(dz, rz);
+      nx = _mm256_add_ps(nx, _mm256_add_ps(crossTerm(ey, ez, fy, fz), crossTerm(dy, dz, ly, lz)));
+      ny = _mm256_add_ps(ny, _mm256_add_ps(crossTerm(ez, ex, fz, fx), crossTerm(dz, dx, lz, lx)));
+      nz = _mm256_add_ps(nz, _mm256_add_ps(crossTerm(ex, ey, fx, fy), crossTerm(dx, dy, lx, ly)));
+   }
+   if(hasAbove){
+      const int u = v-stride;
+      __m256 ux = edge(px, u, x), uy = edge(py, u, y), uz = edge(pz, u, z);
+      __m256 ex = edge(px, u-1, x), ey = edge(py, u-1, y), ez = edge(pz, u-1, z);
+      __m256 fx = _mm256_sub_ps(ux, lx), fy = _mm256_sub_ps(uy, ly), fz = _mm256_sub_ps(uz, lz);
+      nx = _mm256_add_ps(nx, _mm256_add_ps(crossTerm(ey, ez, fy, fz), crossTerm(uy, uz, ry, rz)));
+      ny = _mm256_add_ps(ny, _mm256_add_ps(crossTerm(ez, ex, fz, fx), crossTerm(uz, ux, rz, rx)));
+      nz = _mm256_add_ps(nz, _mm256_add_ps(crossTerm(ex, ey, fx, fy), crossTerm(ux, uy, rx, ry)));
+   }
+}
+
+/* accumulates the force of springs [begin, end) into their endpoints: the force on a into forceA
+ * and the force on b into forceB. Blocks of 8 springs whose endpoints are both runs of consecutive
+ * vertices (the usual case, see Skirt::generateSprings()) are evaluated in one go; any other block
+ * falls back to the scalar code
+ */
+void avx2SpringForces(const SpringArray &springs, int begin, int end,
+                      const VectorArray &position, VectorArray &forceA, VectorArray &forceB)
+{
+   const __m256 signMask = _mm256_set1_ps(-0.0f);
+   const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   int s = begin;
+   
+   for(; s+8 <= end; s += 8){
+      int a = springs.a[s], b = springs.b[s];
+      __m256i runA = _mm256_add_epi32(_mm256_set1_epi32(a), lanes),
+              runB = _mm256_add_epi32(_mm256_set1_epi32(b), lanes),
+              isRun = _mm256_and_si256(
+                 _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(springs.a + s)), runA),
+                 _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(springs.b + s)), runB));
+      if(_mm256_movemask_epi8(isRun) != -1){
+         scalarSpringForces(springs, s, s+8, position, forceA, forceB);
+         continue;
+      }
+      __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(px + a), _mm256_loadu_ps(px + b)),
+             dy = _mm256_sub_ps(_mm256_loadu_ps(py + a), _mm256_loadu_ps(py + b)),
+             dz = _mm256_sub_ps(_mm256_loadu_ps(pz + a), _mm256_loadu_ps(pz + b));
+      __m256 lengthSq = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+      __m256 stretch = _mm256_sub_ps(_mm256_sqrt_ps(lengthSq), _mm256_loadu_ps(springs.rest + s));
+      stretch = _mm256_div_ps(stretch, lengthSq);
+      //signed squared components of a (unit) pull from a toward b
+      __m256 ux = _mm256_mul_ps(_mm256_mul_ps(dx, _mm256_andnot_ps(signMask, dx)), stretch),
+             uy = _mm256_mul_ps(_mm256_mul_ps(dy, _mm256_andnot_ps(signMask, dy)), stretch),
+             uz = _mm256_mul_ps(_mm256_mul_ps(dz, _mm256_andnot_ps(signMask, dz)), stretch);
+      __m256 ksA = _mm256_loadu_ps(springs.ksA + s), ksB = _mm256_loadu_ps(springs.ksB + s);
+      _mm256_storeu_ps(forceA.x + a, _mm256_fnmadd_ps(ksA, ux, _mm256_loadu_ps(forceA.x + a)));
+      _mm256_storeu_ps(forceA.y + a, _mm256_fnmadd_ps(ksA, uy, _mm256_loadu_ps(forceA.y + a)));
+      _mm256_storeu_ps(forceA.z + a, _mm256_fnmadd_ps(ksA, uz, _mm256_loadu_ps(forceA.z + a)));
+      _mm256_storeu_ps(forceB.x + b, _mm256_fmadd_ps(ksB, ux, _mm256_loadu_ps(forceB.x + b)));
+      _mm256_storeu_ps(forceB.y + b, _mm256_fmadd_ps(ksB, uy, _mm256_loadu_ps(forceB.y + b)));
+      _mm256_storeu_ps(forceB.z + b, _mm256_fmadd_ps(ksB, uz, _mm256_loadu_ps(forceB.z + b)));
+   }
+   scalarSpringForces(springs, s, end, position, forceA, forceB);
+}
+
+/* integrates count velocities starting at first: spring force (the sum of force and forceAcross),
+ * then gravity (y only), then damping by the fraction kd
+ */
+void avx2IntegrateVelocity(VectorArray &velocity, const VectorArray &force,
+                           const VectorArray &forceAcross, int first, int count, float hv,
+                           float gravity, float kd)
+{
+   const __m256 h = _mm256_set1_ps(hv), g = _mm256_set1_ps(hv*gravity), k = _mm256_set1_ps(kd);
+   int v = first, end = first+count;
+   
+   for(; v+8 <= end; v += 8){
+      __m256 fx = _mm256_add_ps(_mm256_loadu_ps(force.x + v), _mm256_loadu_ps(forceAcross.x + v)),
+             fy = _mm256_add_ps(_mm256_loadu_ps(force.y + v), _mm256_loadu_ps(forceAcross.y + v)),
+             fz = _mm256_add_ps(_mm256_loadu_ps(force.z + v), _mm256_loadu_ps(forceAcross.z + v));
+      __m256 vx = _mm256_fmadd_ps(h, fx, _mm256_loadu_ps(velocity.x + v)),
+             vy = _mm256_fmadd_ps(h, fy, _mm256_loadu_ps(velocity.y + v)),
+             vz = _mm256_fmadd_ps(h, fz, _mm256_loadu_ps(velocity.z + v));
+      vy = _mm256_add_ps(vy, g);
+      _mm256_storeu_ps(velocity.x + v, _mm256_fnmadd_ps(k, vx, vx));
+      _mm256_storeu_ps(velocity.y + v, _mm256_fnmadd_ps(k, vy, vy));
+      _mm256_storeu_ps(velocity.z + v, _mm256_fnmadd_ps(k, vz, vz));
+   }
+   scalarIntegrateVelocity(velocity, force, forceAcross, v, end-v, hv, gravity, kd);
+}
+
+/* integrates count positions starting at first from their velocities
+ */
+void avx2IntegratePosition(VectorArray &position, const VectorArray &velocity, int first,
+                           int count, float hp)
+{
+   const __m256 h = _mm256_set1_ps(hp);
+   int v = first, end = first+count;
+   
+   for(; v+8 <= end; v += 8){
+      _mm256_storeu_ps(position.x + v, _mm256_fmadd_ps(h, _mm256_loadu_ps(velocity.x + v),
+                                                       _mm256_loadu_ps(position.x + v)));
+      _mm256_storeu_ps(position.y + v, _mm256_fmadd_ps(h, _mm256_loadu_ps(velocity.y + v),
+                                                       _mm256_loadu_ps(position.y + v)));
+      _mm256_storeu_ps(position.z + v, _mm256_fmadd_ps(h, _mm256_loadu_ps(velocity.z + v),
+                                                       _mm256_loadu_ps(position.z + v)));
+   }
+   scalarIntegratePosition(position, velocity, v, end-v, hp);
+}
+
+/* writes the unit normals of count vertices starting at first, as scalarVertexNormal() with the
+ * left and right neighbours of each at the entries next to it, 8 vertices at a time
+ */
+void avx2VertexNormals(const VectorArray &position, VectorArray &normals, int first, int count,
+                        int stride, bool hasAbove, bool hasBelow)
+{
+   const __m256 tiny = _mm256_set1_ps(FLT_MIN), one = _mm256_set1_ps(1);
+   int v = first, end = first+count;
+   
+   for(; v+8 <= end; v += 8){
+      __m256 nx, ny, nz;
+      sumFaceNormals(position, v, stride, hasAbove, hasBelow, nx, ny, nz);
+      __m256 lengthSq = _mm256_fmadd_ps(nz, nz, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nx, nx)));
+      __m256 inverse = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(lengthSq, tiny)));
+      _mm256_storeu_ps(normals.x + v, _mm256_mul_ps(nx, inverse));
+      _mm256_storeu_ps(normals.y + v, _mm256_mul_ps(ny, inverse));
+      _mm256_storeu_ps(normals.z + v, _mm256_mul_ps(nz, inverse));
+   }
+   scalarVertexNormals(position, normals, v, end-v, stride, hasAbove, hasBelow);
+}
+
+/* writes the unit normals of count vertices starting at first and adds the air force on them to
+ * their velocities, as scalarVertexNormalAir() with the left and right neighbours of each at the
+ * entries next to it, 8 vertices at a time
+ */
+void avx2VertexNormalsAir(const VectorArray &position, VectorArray &velocity,
+                          VectorArray &normals, int first, int count, int stride, bool hasAbove,
+                          bool hasBelow, const AirFlow &air)
+{
+   const __m256 tiny = _mm256_set1_ps(FLT_MIN), one = _mm256_set1_ps(1),
+                signMask = _mm256_set1_ps(-0.0f);
+   const __m256 windX = _mm256_set1_ps(air.windX), windY = _mm256_set1_ps(air.windY),
+                windZ = _mm256_set1_ps(air.windZ);
+   const __m256 drag = _mm256_set1_ps(air.drag), lift = _mm256_set1_ps(air.lift);
+   int v = first, end = first+count;
+   
+   for(; v+8 <= end; v += 8){
+      __m256 nx, ny, nz;
+      sumFaceNormals(position, v, stride, hasAbove, hasBelow, nx, ny, nz);
+      __m256 lengthSq = _mm256_fmadd_ps(nz, nz, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nx, nx)));
+      __m256 inverse = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(lengthSq, tiny)));
+      _mm256_storeu_ps(normals.x + v, _mm256_mul_ps(nx, inverse));
+      _mm256_storeu_ps(normals.y + v, _mm256_mul_ps(ny, inverse));
+      _mm256_storeu_ps(normals.z + v, _mm256_mul_ps(nz, inverse));
+      //the air force, as a change of velocity over the step
+      __m256 vx = _mm256_loadu_ps(velocity.x + v), vy = _mm256_loadu_ps(velocity.y + v),
+             vz = _mm256_loadu_ps(velocity.z + v);
+      __m256 ux = _mm256_sub_ps(vx, windX), uy = _mm256_sub_ps(vy, windY),
+             uz = _mm256_sub_ps(vz, windZ);
+      __m256 speedSq = _mm256_fmadd_ps(uz, uz, _mm256_fmadd_ps(uy, uy, _mm256_mul_ps(ux, ux)));
+      __m256 s = _mm256_fmadd_ps(nz, uz, _mm256_fmadd_ps(ny, uy, _mm256_mul_ps(nx, ux)));
+      __m256 inverseSpeed = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(speedSq, tiny)));
+      __m256 absS = _mm256_andnot_ps(signMask, s);
+      __m256 dragged = _mm256_min_ps(_mm256_mul_ps(drag, absS), one);
+      __m256 lifted = _mm256_min_ps(_mm256_mul_ps(lift, absS), one);
+      __m256 liftT = _mm256_mul_ps(_mm256_or_ps(lifted, _mm256_and_ps(signMask, s)), inverse);
+      __m256 along = _mm256_fmsub_ps(liftT, _mm256_mul_ps(s, inverseSpeed), dragged);
+      __m256 across = _mm256_mul_ps(_mm256_xor_ps(signMask, liftT),
+                                    _mm256_mul_ps(speedSq, inverseSpeed));
+      _mm256_storeu_ps(velocity.x + v, _mm256_fmadd_ps(along, ux, _mm256_fmadd_ps(across, nx, vx)));
+      _mm256_storeu_ps(velocity.y + v, _mm256_fmadd_ps(along, uy, _mm256_fmadd_ps(across, ny, vy)));
+      _mm256_storeu_ps(velocity.z + v, _mm256_fmadd_ps(along, uz, _mm256_fmadd_ps(across, nz, vz)));
+   }
+   scalarVertexNormalsAir(position, velocity, normals, v, end-v, stride, hasAbove, hasBelow, air);
+}
+
+/* returns the AVX2 kernels
+ */
+const Kernels &avx2Kernels()
+{
+   static const Kernels kernels = { "avx2", avx2SpringForces, avx2IntegrateVelocity,
+                                    avx2IntegratePosition, avx2VertexNormals,
+                                    avx2VertexNormalsAir };
+   return kernels;
+}
+
+#else
+
+/* returns the scalar kernels; this compiler cannot target AVX2 and FMA
+ */
+const Kernels &avx2Kernels()
+{
+   return scalarKernels();
+}
+
+#endif // __AVX2__ && __FMA__
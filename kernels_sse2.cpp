@@ -0,0 +1,246 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: kernels_sse2.cpp - SSE2 kernels, processing 4 springs or vertices per instruction
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "kernels.h"
+#ifdef __SSE2__
+#include <emmintrin.h> //used for the SSE2 intrinsics
+#include <cfloat> //used for FLT_MIN
+
+/* returns the component ay*bz - az*by of a cross product, for 4 pairs of vectors at a time
+ */
+static inline __m128 crossTerm(__m128 ay, __m128 az, __m128 by, __m128 bz)
+{
+   return _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+}
+
+/* returns one component of the edges from 4 vertices to 4 consecutive others starting at p[to]
+ */
+static inline __m128 edge(const float *p, int to, __m128 from)
+{
+   return _mm_sub_ps(_mm_loadu_ps(p + to), from);
+}
+
+/* sums the face normals of the triangles around 4 consecutive vertices starting at v into
+ * (nx, ny, nz), as sumFaceNormals() in kernels.cpp with the left and right neighbours of each at
+ * the entries next to it
+ */
+static inline void sumFaceNormals(const VectorArray &position, int v, int stride, bool hasAbove,
+                                  bool hasBelow, __m128 &nx, __m128 &ny, __m128 &nz)
+{
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   __m128 x = _mm_loadu_ps(px + v), y = _mm_loadu_ps(py + v), z = _mm_loadu_ps(pz + v);
+   __m128 lx = edge(px, v-1, x), ly = edge(py, v-1, y), lz = edge(pz, v-1, z);
+   __m128 rx = edge(px, v+1, x), ry = edge(py, v+1, y), rz = edge(pz, v+1, z);
+   
+   nx = ny = nz = _mm_setzero_ps();
+   if(hasBelow){
+      const int d = v+stride;
+      __m128 dx = edge(px, d, x), dy = edge(py, d, y), dz = edge(pz, d, z);
+      __m128 ex = edge(px, d+1, x), ey = edge(py, d+1, y), ez = edge(pz, d+1, z);
+      __m128 fx = _mm_sub_ps(dx, rx), fy = _mm_sub_ps(dy, ry), fz = _mm_sub_ps(dz, rz);
+      nx = _mm_add_ps(nx, _mm_add_ps(crossTerm(ey, ez, fy, fz), crossTerm(dy, dz, ly, lz)));
+      ny = _mm_add_ps(ny, _mm_add_ps(crossTerm(ez, ex, fz, fx), crossTerm(dz, dx, lz, lx)));
+      nz = _mm_add_ps(nz, _mm_add_ps(crossTerm(ex, ey, fx, fy), crossTerm(dx, dy, lx, ly)));
+   }
+   if(hasAbove){
+      const int u = v-stride;
+      __m128 ux = edge(px, u, x), uy = edge(py, u, y), uz = edge(pz, u, z);
+      __m128 ex = edge(px, u-1, x), ey = edge(py, u-1, y), ez = edge(pz, u-1, z);
+      __m128 fx = _mm_sub_ps(ux, lx), fy = _mm_sub_ps(uy, ly), fz = _mm_sub_ps(uz, lz);
+      nx = _mm_add_ps(nx, _mm_add_ps(crossTerm(ey, ez, fy, fz), crossTerm(uy, uz, ry, rz)));
+      ny = _mm_add_ps(ny, _mm_add_ps(crossTerm(ez, ex, fz, fx), crossTerm(uz, ux, rz, rx)));
+      nz = _mm_add_ps(nz, _mm_add_ps(crossTerm(ex, ey, fx, fy), crossTerm(ux, uy, rx, ry)));
+   }
+}
+
+/* accumulates the force of springs [begin, end) into their endpoints: the force on a into forceA
+ * and the force on b into forceB. Blocks of 4 springs whose endpoints are both runs of consecutive
+ * vertices (the usual case, see Skirt::generateSprings()) are evaluated in one go; any other block
+ * falls back to the scalar code
+ */
+void sse2SpringForces(const SpringArray &springs, int begin, int end,
+                      const VectorArray &position, VectorArray &forceA, VectorArray &forceB)
+{
+   const __m128 signMask = _mm_set1_ps(-0.0f);
+   const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+   const float *px = position.x, *py = position.y, *pz = position.z;
+   int s = begin;
+   
+   for(; s+4 <= end; s += 4){
+      int a = springs.a[s], b = springs.b[s];
+      __m128i runA = _mm_add_epi32(_mm_set1_epi32(a), lanes),
+              runB = _mm_add_epi32(_mm_set1_epi32(b), lanes),
+              isRun = _mm_and_si128(
+                 _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(springs.a + s)), runA),
+                 _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(springs.b + s)), runB));
+      if(_mm_movemask_epi8(isRun) != 0xFFFF){
+         scalarSpringForces(springs, s, s+4, position, forceA, forceB);
+         continue;
+      }
+      __m128 dx = _mm_sub_ps(_mm_loadu_ps(px + a), _mm_loadu_ps(px + b)),
+             dy = _mm_sub_ps(_mm_loadu_ps(py + a), _mm_loadu_ps(py + b)),
+             dz = _mm_sub_ps(_mm_loadu_ps(pz + a), _mm_loadu_ps(pz + b));
+      __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                   _mm_mul_ps(dz, dz));
+      __m128 stretch = _mm_sub_ps(_mm_sqrt_ps(lengthSq), _mm_loadu_ps(springs.rest + s));
+      stretch = _mm_div_ps(stretch, lengthSq);
+      //signed squared components of a (unit) pull from a toward b
+      __m128 ux = _mm_mul_ps(_mm_mul_ps(dx, _mm_andnot_ps(signMask, dx)), stretch),
+             uy = _mm_mul_ps(_mm_mul_ps(dy, _mm_andnot_ps(signMask, dy)), stretch),
+             uz = _mm_mul_ps(_mm_mul_ps(dz, _mm_andnot_ps(signMask, dz)), stretch);
+      __m128 ksA = _mm_loadu_ps(springs.ksA + s), ksB = _mm_loadu_ps(springs.ksB + s);
+      _mm_storeu_ps(forceA.x + a, _mm_sub_ps(_mm_loadu_ps(forceA.x + a), _mm_mul_ps(ksA, ux)));
+      _mm_storeu_ps(forceA.y + a, _mm_sub_ps(_mm_loadu_ps(forceA.y + a), _mm_mul_ps(ksA, uy)));
+      _mm_storeu_ps(forceA.z + a, _mm_sub_ps(_mm_loadu_ps(forceA.z + a), _mm_mul_ps(ksA, uz)));
+      _mm_storeu_ps(forceB.x + b, _mm_add_ps(_mm_loadu_ps(forceB.x + b), _mm_mul_ps(ksB, ux)));
+      _mm_storeu_ps(forceB.y + b, _mm_add_ps(_mm_loadu_ps(forceB.y + b), _mm_mul_ps(ksB, uy)));
+      _mm_storeu_ps(forceB.z + b, _mm_add_ps(_mm_loadu_ps(forceB.z + b), _mm_mul_ps(ksB, uz)));
+   }
+   scalarSpringForces(springs, s, end, position, forceA, forceB);
+}
+
+/* integrates count velocities starting at first: spring force (the sum of force and forceAcross),
+ * then gravity (y only), then damping by the fraction kd
+ */
+void sse2IntegrateVelocity(VectorArray &velocity, const VectorArray &force,
+                           const VectorArray &forceAcross, int first, int count, float hv,
+                           float gravity, float kd)
+{
+   const __m128 h = _mm_set1_ps(hv), g = _mm_set1_ps(hv*gravity), k = _mm_set1_ps(kd);
+   int v = first, end = first+count;
+   
+   for(; v+4 <= end; v += 4){
+      __m128 vx = _mm_loadu_ps(velocity.x + v), vy = _mm_loadu_ps(velocity.y + v),
+             vz = _mm_loadu_ps(velocity.z + v);
+      __m128 fx = _mm_add_ps(_mm_loadu_ps(force.x + v), _mm_loadu_ps(forceAcross.x + v)),
+             fy = _mm_add_ps(_mm_loadu_ps(force.y + v), _mm_loadu_ps(forceAcross.y + v)),
+             fz = _mm_add_ps(_mm_loadu_ps(force.z + v), _mm_loadu_ps(forceAcross.z + v));
+      vx = _mm_add_ps(vx, _mm_mul_ps(h, fx));
+      vy = _mm_add_ps(vy, _mm_mul_ps(h, fy));
+      vz = _mm_add_ps(vz, _mm_mul_ps(h, fz));
+      vy = _mm_add_ps(vy, g);
+      _mm_storeu_ps(velocity.x + v, _mm_sub_ps(vx, _mm_mul_ps(k, vx)));
+      _mm_storeu_ps(velocity.y + v, _mm_sub_ps(vy, _mm_mul_ps(k, vy)));
+      _mm_storeu_ps(velocity.z + v, _mm_sub_ps(vz, _mm_mul_ps(k, vz)));
+   }
+   scalarIntegrateVelocity(velocity, force, forceAcross, v, end-v, hv, gravity, kd);
+}
+
+/* integrates count positions starting at first from their velocities
+ */
+void sse2IntegratePosition(VectorArray &position, const VectorArray &velocity, int first,
+                           int count, float hp)
+{
+   const __m128 h = _mm_set1_ps(hp);
+   int v = first, end = first+count;
+   
+   for(; v+4 <= end; v += 4){
+      __m128 dx = _mm_mul_ps(h, _mm_loadu_ps(velocity.x + v)),
+             dy = _mm_mul_ps(h, _mm_loadu_ps(velocity.y + v)),
+             dz = _mm_mul_ps(h, _mm_loadu_ps(velocity.z + v));
+      _mm_storeu_ps(position.x + v, _mm_add_ps(_mm_loadu_ps(position.x + v), dx));
+      _mm_storeu_ps(position.y + v, _mm_add_ps(_mm_loadu_ps(position.y + v), dy));
+      _mm_storeu_ps(position.z + v, _mm_add_ps(_mm_loadu_ps(position.z + v), dz));
+   }
+   scalarIntegratePosition(position, velocity, v, end-v, hp);
+}
+
+/* writes the unit normals of count vertices starting at first, as scalarVertexNormal() with the
+ * left and right neighbours of each at the entries next to it, 4 vertices at a time
+ */
+void sse2VertexNormals(const VectorArray &position, VectorArray &normals, int first, int count,
+                        int stride, bool hasAbove, bool hasBelow)
+{
+   const __m128 tiny = _mm_set1_ps(FLT_MIN), one = _mm_set1_ps(1);
+   int v = first, end = first+count;
+   
+   for(; v+4 <= end; v += 4){
+      __m128 nx, ny, nz;
+      sumFaceNormals(position, v, stride, hasAbove, hasBelow, nx, ny, nz);
+      __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+                                   _mm_mul_ps(nz, nz));
+      __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSq, tiny)));
+      _mm_storeu_ps(normals.x + v, _mm_mul_ps(nx, inverse));
+      _mm_storeu_ps(normals.y + v, _mm_mul_ps(ny, inverse));
+      _mm_storeu_ps(normals.z + v, _mm_mul_ps(nz, inverse));
+   }
+   scalarVertexNormals(position, normals, v, end-v, stride, hasAbove, hasBelow);
+}
+
+/* writes the unit normals of count vertices starting at first and adds the air force on them to
+ * their velocities, as scalarVertexNormalAir() with the left and right neighbours of each at the
+ * entries next to it, 4 vertices at a time
+ */
+void sse2VertexNormalsAir(const VectorArray &position, VectorArray &velocity,
+                          VectorArray &normals, int first, int count, int stride, bool hasAbove,
+                          bool hasBelow, const AirFlow &air)
+{
+   const __m128 tiny = _mm_set1_ps(FLT_MIN), one = _mm_set1_ps(1), signMask = _mm_set1_ps(-0.0f);
+   const __m128 windX = _mm_set1_ps(air.windX), windY = _mm_set1_ps(air.windY),
+                windZ = _mm_set1_ps(air.windZ);
+   const __m128 drag = _mm_set1_ps(air.drag), lift = _mm_set1_ps(air.lift);
+   int v = first, end = first+count;
+   
+   for(; v+4 <= end; v += 4){
+      __m128 nx, ny, nz;
+      sumFaceNormals(position, v, stride, hasAbove, hasBelow, nx, ny, nz);
+      __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+                                   _mm_mul_ps(nz, nz));
+      __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSq, tiny)));
+      _mm_storeu_ps(normals.x + v, _mm_mul_ps(nx, inverse));
+      _mm_storeu_ps(normals.y + v, _mm_mul_ps(ny, inverse));
+      _mm_storeu_ps(normals.z + v, _mm_mul_ps(nz, inverse));
+      //the air force, as a change of velocity over the step
+      __m128 vx = _mm_loadu_ps(velocity.x + v), vy = _mm_loadu_ps(velocity.y + v),
+             vz = _mm_loadu_ps(velocity.z + v);
+      __m128 ux = _mm_sub_ps(vx, windX), uy = _mm_sub_ps(vy, windY), uz = _mm_sub_ps(vz, windZ);
+      __m128 speedSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy)),
+                                  _mm_mul_ps(uz, uz));
+      __m128 s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, ux), _mm_mul_ps(ny, uy)), _mm_mul_ps(nz, uz));
+      __m128 inverseSpeed = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(speedSq, tiny)));
+      __m128 absS = _mm_andnot_ps(signMask, s);
+      __m128 dragged = _mm_min_ps(_mm_mul_ps(drag, absS), one);
+      __m128 lifted = _mm_min_ps(_mm_mul_ps(lift, absS), one);
+      __m128 liftT = _mm_mul_ps(_mm_or_ps(lifted, _mm_and_ps(signMask, s)), inverse);
+      __m128 along = _mm_sub_ps(_mm_mul_ps(liftT, _mm_mul_ps(s, inverseSpeed)), dragged);
+      __m128 across = _mm_mul_ps(_mm_xor_ps(signMask, liftT), _mm_mul_ps(speedSq, inverseSpeed));
+      _mm_storeu_ps(velocity.x + v, _mm_add_ps(vx, _mm_add_ps(_mm_mul_ps(along, ux),
+                                                              _mm_mul_ps(across, nx))));
+      _mm_storeu_ps(velocity.y + v, _mm_add_ps(vy, _mm_add_ps(_mm_mul_ps(along, uy),
+                                                              _mm_mul_ps(across, ny))));
+      _mm_storeu_ps(velocity.z + v, _mm_add_ps(vz, _mm_add_ps(_mm_mul_ps(along, uz),
+                                                              _mm_mul_ps(across, nz))));
+   }
+   scalarVertexNormalsAir(position, velocity, normals, v, end-v, stride, hasAbove, hasBelow, air);
+}
+
+/* returns the SSE2 kernels
+ */
+const Kernels &sse2Kernels()
+{
+   static const Kernels kernels = { "sse2", sse2SpringForces, sse2IntegrateVelocity,
+                                    sse2IntegratePosition, sse2VertexNormals,
+                                    sse2VertexNormalsAir };
+   return kernels;
+}
+
+#else
+
+/* returns the scalar kernels; this build targets a CPU without SSE2
+ */
+const Kernels &sse2Kernels()
+{
+   return scalarKernels();
+}
+
+#endif // __SSE2__
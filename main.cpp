@@ -12,20 +12,65 @@
  */
 
 #include "skirt.h"
-#include <cstdlib> //used for exit() and EXIT_SUCCESS
+#include "simthread.h"
+#include "skirtrenderer.h"
+#include "scene.h"
+#include "trajectoryplayer.h"
+#include "profiler.h"
+#include "timer.h"
+#include <cmath> //used for fmod() and floor()
+#include <cstdlib> //used for exit(), atexit(), atoi(), EXIT_SUCCESS and EXIT_FAILURE
+#include <cstring> //used for strcmp()
+#include <cstdio> //used for printf(), sprintf()
 #include <GL/gl.h> //used for various gl types and functions
-#include <GL/glu.h> //used for gluPerspective()
 #include <GL/glut.h> //used for various glut-based functions and constants
 
 //Global Constants
 const GLint WINDOW_WIDTH = 720, WINDOW_HEIGHT = 720, WIN_POS_X = 200, WIN_POS_Y = 100;
-const GLdouble FOV = 45, CLIP_NEAR = 0.1, CLIP_FAR = 100;
+//the simulation runs the substeps (DEFAULT_SUBSTEPS unless given with -s) explicit steps per frame
+//of FRAME_RATE frames per second, whatever the real display rate. A frame runs at most
+//MAX_FRAME_STEPS times that many; a slower display falls behind real time rather than ever further
+const double FRAME_RATE = 60;
+const int DEFAULT_SUBSTEPS = 4, MAX_FRAME_STEPS = 4;
+//where the rest state of the skirt is cached, as the texture's mipmaps are
+const char *REST_DIRECTORY = "assets";
+//where t writes the trace of the timed sections, and how often the overlay of their statistics is
+//refreshed, in seconds, so that it can be read
+const char *TRACE_PATH = "clothSim.trace.json";
+const double PROFILE_REFRESH = 0.5;
 
 //Global Variables
-Skirt skirt;
+//runs from before the skirt is built until the first frame has been drawn
+Timer startup;
+//built at the resolution of the trajectory played back, if any, and left to the OS at exit
+Skirt *skirt;
+//steps the skirt on its own thread from the start of the main loop to exit; none during playback
+SimThread *sim;
+//with -p, plays back a recorded trajectory into playFrame instead of simulating. The motion is
+//playStep explicit steps in as of when playClock was last started, and runs on from there at the
+//simulation's pace unless paused
+TrajectoryPlayer *player;
+SkirtFrame playFrame;
+Timer playClock;
+double playStep, stepsPerSecond;
+bool isPaused = false;
+//the CPU time spent loading played back frames
+double loadSeconds;
+//draws the frames; made once the GL context exists and, like the texture, left to the OS at exit
+SkirtRenderer *renderer;
+//the CPU time spent drawing the skirt and the frames drawn, by Skirt::draw() and from the buffers
+double drawSeconds[2];
+long drawFrames[2];
+//the seconds spent loading the texture, and whether from its cache (false with -u)
+double textureSeconds;
+bool isTextureCached = true;
 int xPrev, horizAngle = 90;
-bool isWireframe = false;
-GLdouble aspectRatio = 1.0;
+bool isWireframe = false, isFirstFrame = true;
+//whether the statistics of the timed sections are drawn over the frame, as last refreshed
+bool isProfileShown = false;
+char profileLines[Profiler::SECTION_COUNT + 1][64];
+int profileLineCount;
+Timer profileClock;
 
 //initializes the OpenGL framework such as lighting, shading, depth, culling, and materials
 GLvoid init();
@@ -37,7 +82,12 @@ GLvoid reshape(int w, int h);
 GLvoid display();
 //called from display. where all of the custom rendering takes place
 GLvoid drawScene();
-//used to change the skirt motion between 2D and 3D
+//draws the rolling statistics of the timed sections over the frame
+GLvoid drawProfile();
+//draws a line of text with its baseline starting at the given pixel
+GLvoid drawText(int x, int y, const char *text);
+//used to change the skirt motion between 2D and 3D, the integrator, the XPBD constraint iterations,
+//the collisions, the wind, the way the skirt is drawn, and the profiling overlay and trace
 GLvoid keyboard(unsigned char key, int mouseX, int mouseY);
 //used to change the amplitude or frequency of the skirt's oscillatory motion
 GLvoid keyboardArrows(int key, int x, int y);
@@ -45,11 +95,68 @@ GLvoid keyboardArrows(int key, int x, int y);
 GLvoid mouseButtonState(int button, int state, int x, int y);
 //used to rotate the camera around the skirt horizontally
 GLvoid mouseMove(int x, int y);
+//queues a command for the simulation thread, if simulating
+GLvoid post(SimThread::Command command);
+//returns how many explicit steps into the trajectory played back the motion is, looping over it
+double playbackStep();
+//moves the playback the given number of explicit steps on, or back if negative
+GLvoid seekPlayback(double steps);
+//pauses the playback, or resumes it if paused
+GLvoid pausePlayback();
+//writes the trace of the timed sections to TRACE_PATH
+GLvoid writeTrace();
+//stops the simulation thread at exit
+GLvoid stopSimulation();
+//prints the average CPU time per frame spent drawing the skirt, for each way of drawing it used
+GLvoid reportDrawTimes();
 
 //::MAIN:://////////////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv)
 {
+   int substeps = DEFAULT_SUBSTEPS;
+   bool isWarmStarted = true;
+   const char *playPath = 0;
+   
    glutInit(&argc, argv);
+   //glutInit() has removed the arguments meant for GLUT
+   for(int a = 1; a < argc; a++)
+      if(!strcmp(argv[a], "-s") && a+1 < argc) substeps = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-u"))          isTextureCached = false;
+      else if(!strcmp(argv[a], "-c"))          isWarmStarted = false;
+      else if(!strcmp(argv[a], "-p") && a+1 < argc) playPath = argv[++a];
+   if(substeps < 1) substeps = 1;
+   stepsPerSecond = FRAME_RATE*substeps;
+   if(playPath){
+      player = new TrajectoryPlayer(playPath);
+      if(!player->isOpen()){
+         printf("Unable to read a trajectory from %s\n", playPath);
+         return EXIT_FAILURE;
+      }
+      skirt = new Skirt(player->getXRes(), player->getYRes());
+      skirt->allocFrame(playFrame);
+      printf("playing %d frames of %dx%d vertices from %s, %d steps apart (%.1f s)\n",
+             player->getFrameCount(), player->getXRes(), player->getYRes(), playPath,
+             player->getStepsPerFrame(), player->getSteps()/stepsPerSecond);
+   }
+   else{
+      skirt = new Skirt();
+      //the simulation thread works the first band of rows itself; one hardware thread is left to
+      //draw
+      skirt->setThreadCount(ThreadPool::hardwareThreads() - 1);
+      //the skirt starts hanging at rest rather than as the cone it is built as
+      if(isWarmStarted){
+         Timer timer;
+         bool isCached;
+         int settled = skirt->warmStart(REST_DIRECTORY, &isCached);
+         if(!settled) printf("rest state: restored in %.3f ms\n", 1e3*timer.elapsed());
+         else if(isCached)
+            printf("rest state: settled in %d steps, %.1f ms, and cached in %s\n", settled,
+                   1e3*timer.elapsed(), REST_DIRECTORY);
+         else printf("rest state: settled in %d steps, %.1f ms; unable to cache it in %s\n",
+                     settled, 1e3*timer.elapsed(), REST_DIRECTORY);
+      }
+      sim = new SimThread(*skirt, 1/(FRAME_RATE*substeps), MAX_FRAME_STEPS*substeps);
+   }
    glutInitDisplayMode(GLUT_RGB | GLUT_DEPTH | GLUT_DOUBLE);
    glutInitWindowPosition(WIN_POS_X, WIN_POS_Y);
    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -61,6 +168,11 @@ int main(int argc, char** argv)
    init();
    initWindow();
    
+   //GLUT leaves its main loop only by exit(), which runs these
+   atexit(stopSimulation);
+   atexit(reportDrawTimes);
+   if(sim) sim->start();
+   playClock.start();
    glutMainLoop();
    
    return EXIT_SUCCESS;
@@ -71,24 +183,12 @@ int main(int argc, char** argv)
  */
 GLvoid init()
 {
-   skirt.loadTexture();
-   glEnable(GL_TEXTURE_2D);
-   
-   glShadeModel(GL_SMOOTH);
-   glEnable(GL_NORMALIZE);
-   glClearColor(0.4f, 0.4f, 0.7f, 0.0f);
-   glClearDepth(1.0f);
-   glEnable(GL_DEPTH_TEST);
-   glDepthFunc(GL_LEQUAL);
-   
-   //lighting init
-   GLfloat lightPos[] = {1, 0.25, 0.5, 0};
-   glEnable(GL_LIGHTING);
-   glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
-   glEnable(GL_LIGHT0);
-   glEnable(GL_COLOR_MATERIAL);
-   
-   glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+   Timer timer;
+   isTextureCached = skirt->loadTexture(isTextureCached);
+   textureSeconds = timer.elapsed();
+   renderer = new SkirtRenderer(*skirt);
+   renderer->init();
+   initScene();
 }
 
 /* links GLUT functions for windowing, keyboard, and mouse utilization
@@ -108,51 +208,150 @@ GLvoid initWindow()
  */
 GLvoid reshape(int w, int h)
 {
-   h = h?h:1;
-   aspectRatio = (GLdouble)w/h;
-   glViewport(0, 0, w, h);
-   
-   //update projection matrix
-   glMatrixMode(GL_PROJECTION);
-   glLoadIdentity();
-   gluPerspective(FOV, aspectRatio, CLIP_NEAR, CLIP_FAR);
-   
-   //init model-view matrix
-   glMatrixMode(GL_MODELVIEW);
-   glLoadIdentity();
+   projectScene(w, h);
 }
 
-/* primary rendering function from which all rendering takes place
+/* primary rendering function from which all rendering takes place. Reports the startup time once
+ * the first frame is finished
  */
 GLvoid display()
 {
-   glLoadIdentity();
-
-   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   PROFILE_SCOPE(DISPLAY);
    
+   placeSkirt(*skirt, horizAngle);
    drawScene();
+   if(isProfileShown) drawProfile();
    glutSwapBuffers(); //contains an implicit glFlush call
+   if(isFirstFrame){
+      glFinish();
+      printf("startup to first frame: %.1f ms, texture %s in %.1f ms\n", 1e3*startup.elapsed(),
+             isTextureCached ? "mapped from its cache" : "mipmapped from the image",
+             1e3*textureSeconds);
+      isFirstFrame = false;
+   }
 }
 
-/* called from display. where all of the custom rendering takes place
+/* called from display. where all of the custom rendering takes place. Draws the latest frame of
+ * the simulation thread between its two states as far as real time has reached, or during playback
+ * the recorded frames real time has reached, and times the CPU side of drawing it
  */
 GLvoid drawScene()
 {
-   glTranslatef(0, 1.5*skirt.getHeight(), -7); //centers the skirt in front of the camera
-   glRotatef(horizAngle, 0,1,0); //rotates the skirt so the texture is centered
-   skirt.draw();
+   GLfloat alpha;
+   const SkirtFrame *frame = &playFrame;
+   
+   if(player){
+      Timer loadTimer;
+      player->loadFrame(player->frameAt(playbackStep(), alpha), *skirt, playFrame);
+      loadSeconds += loadTimer.elapsed();
+   }
+   else frame = &sim->latestFrame(alpha);
+   
+   Timer timer;
+   renderer->draw(*frame, alpha);
+   drawSeconds[renderer->getIsBuffered()] += timer.elapsed();
+   drawFrames[renderer->getIsBuffered()]++;
+}
+
+/* draws the minimum, average and 99th percentile of the latest samples of each timed section
+ * over the top left of the frame, in microseconds. The figures are refreshed every
+ * PROFILE_REFRESH seconds
+ */
+GLvoid drawProfile()
+{
+   const int LINE_HEIGHT = 15, MARGIN = 8;
+   int width = glutGet(GLUT_WINDOW_WIDTH), height = glutGet(GLUT_WINDOW_HEIGHT);
+   
+   if(!profileLineCount || profileClock.elapsed() >= PROFILE_REFRESH){
+      profileClock.start();
+      profileLineCount = 0;
+      if(!Profiler::isCompiledIn())
+         sprintf(profileLines[profileLineCount++], "timers compiled out (make PROFILE=1)");
+      else sprintf(profileLines[profileLineCount++], "%-12s %9s %9s %9s  (us, last %d)", "", "min",
+                   "avg", "p99", Profiler::WINDOW);
+      for(int s = 0; s < Profiler::SECTION_COUNT; s++){
+         Profiler::Section section = Profiler::Section(s);
+         Profiler::Stats stats = Profiler::getStats(section);
+         if(stats.samples)
+            sprintf(profileLines[profileLineCount++], "%-12s %9.1f %9.1f %9.1f",
+                    Profiler::getName(section), 1e6*stats.min, 1e6*stats.avg, 1e6*stats.p99);
+      }
+   }
+   glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+   glDisable(GL_LIGHTING);
+   glDisable(GL_TEXTURE_2D);
+   glDisable(GL_DEPTH_TEST);
+   glMatrixMode(GL_PROJECTION);
+   glPushMatrix();
+   glLoadIdentity();
+   gluOrtho2D(0, width, 0, height);
+   glMatrixMode(GL_MODELVIEW);
+   glPushMatrix();
+   glLoadIdentity();
+   glColor3f(1, 1, 1);
+   for(int l = 0; l < profileLineCount; l++)
+      drawText(MARGIN, height - MARGIN - (l+1)*LINE_HEIGHT, profileLines[l]);
+   glPopMatrix();
+   glMatrixMode(GL_PROJECTION);
+   glPopMatrix();
+   glMatrixMode(GL_MODELVIEW);
+   glPopAttrib();
+}
+
+/* draws a line of text with its baseline starting at the given pixel
+ */
+GLvoid drawText(int x, int y, const char *text)
+{
+   glRasterPos2i(x, y);
+   for(; *text; text++) glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *text);
 }
 
-/* captures and processes keyboard input
+/* captures and processes keyboard input. Changes to the simulation are queued for its thread
  * press 1 to have the skirt move in 2D
  * press 2 to have the skirt move in 3D
+ * press i to switch between the explicit and the implicit integrator
+ * press p to switch between the explicit and the XPBD integrator
+ * press + or - to double or halve the XPBD constraint iterations
+ * press b to switch the collisions with the body on or off (implicit and XPBD integrators only)
+ * press c to switch the collisions of the skirt with itself on or off
+ * press w to switch the drag and lift of the wind on or off
+ * press v to switch between drawing from vertex buffers and drawing vertex by vertex
+ * press o to show or hide the statistics of the timed sections, and t to write their trace
+ * during playback, press space to pause or resume, and , or . to step back or on a recorded frame
  */
 GLvoid keyboard(unsigned char key, int mouseX, int mouseY)
 {
    switch(key){
-      case '1': skirt.rotate2D();
+      case '1': post(SimThread::ROTATE_2D);
+         break;
+      case '2': post(SimThread::ROTATE_3D);
+         break;
+      case 'i': post(SimThread::TOGGLE_IMPLICIT);
+         break;
+      case 'p': post(SimThread::TOGGLE_XPBD);
+         break;
+      case '+': post(SimThread::DOUBLE_ITERATIONS);
+         break;
+      case '-': post(SimThread::HALVE_ITERATIONS);
+         break;
+      case 'b': post(SimThread::TOGGLE_BODY_COLLISIONS);
          break;
-      case '2': skirt.rotate3D();
+      case 'c': post(SimThread::TOGGLE_SELF_COLLISIONS);
+         break;
+      case 'w': post(SimThread::TOGGLE_AIR);
+         break;
+      case 'v': renderer->setBuffered(!renderer->getIsBuffered());
+         break;
+      case 'o': isProfileShown = !isProfileShown;
+                profileLineCount = 0;
+         break;
+      case 't': writeTrace();
+         break;
+      case ' ': if(player) pausePlayback();
+         break;
+      case ',': if(player) seekPlayback(-player->getStepsPerFrame());
+         break;
+      case '.': if(player) seekPlayback(player->getStepsPerFrame());
          break;
       //Esc Key
       case 27:  exit(EXIT_SUCCESS);
@@ -160,20 +359,22 @@ GLvoid keyboard(unsigned char key, int mouseX, int mouseY)
    }
 }
 
-/* captures and processes arrow keys
+/* captures and processes arrow keys. Changes to the simulation are queued for its thread
  * up/down keys change the skirt motion's amplitude
- * left/right keys change the skirt motion's frequency
+ * left/right keys change the skirt motion's frequency, or during playback seek a second back or on
  */
 GLvoid keyboardArrows(int key, int x, int y)
 {
    switch(key){
-      case GLUT_KEY_UP: skirt.incAmplitude();
+      case GLUT_KEY_UP: post(SimThread::INC_AMPLITUDE);
          break;
-      case GLUT_KEY_DOWN: skirt.decAmplitude();
+      case GLUT_KEY_DOWN: post(SimThread::DEC_AMPLITUDE);
          break;
-      case GLUT_KEY_RIGHT: skirt.incFrequency();
+      case GLUT_KEY_RIGHT: if(player) seekPlayback(stepsPerSecond);
+                           else post(SimThread::INC_FREQUENCY);
          break;
-      case GLUT_KEY_LEFT: skirt.decFrequency();
+      case GLUT_KEY_LEFT: if(player) seekPlayback(-stepsPerSecond);
+                          else post(SimThread::DEC_FREQUENCY);
          break;
    }
 }
@@ -197,3 +398,81 @@ GLvoid mouseMove(int x, int y)
    horizAngle += (x > xPrev) ? 2 : -2;
    xPrev = x;
 }
+
+/* queues a command for the simulation thread, if simulating; during playback the motion is as
+ * recorded
+ */
+GLvoid post(SimThread::Command command)
+{
+   if(sim) sim->post(command);
+}
+
+/* returns how many explicit steps into the trajectory played back the motion is. It plays on in
+ * real time at the simulation's pace unless paused, and starts over once past the end
+ */
+double playbackStep()
+{
+   double steps = player->getSteps();
+   double step = playStep + (isPaused ? 0 : playClock.elapsed()*stepsPerSecond);
+   
+   return (steps > 0) ? fmod(step, steps + player->getStepsPerFrame()) : 0;
+}
+
+/* moves the playback the given number of explicit steps on, or back if negative, stopping at
+ * either end. While paused it lands on a recorded frame, so , and . step from frame to frame
+ */
+GLvoid seekPlayback(double steps)
+{
+   double step = playbackStep() + steps;
+   
+   if(isPaused){
+      int frameSteps = player->getStepsPerFrame();
+      step = frameSteps*floor(step/frameSteps + 0.5);
+   }
+   playStep = (step < 0) ? 0 : (step > player->getSteps()) ? player->getSteps() : step;
+   playClock.start();
+}
+
+/* pauses the playback where it is, or resumes it from there if paused
+ */
+GLvoid pausePlayback()
+{
+   playStep = playbackStep();
+   playClock.start();
+   isPaused = !isPaused;
+}
+
+/* writes the samples the timed sections keep to TRACE_PATH as a Chrome trace
+ */
+GLvoid writeTrace()
+{
+   long events = Profiler::writeTrace(TRACE_PATH);
+   
+   if(events < 0) printf("Unable to write %s\n", TRACE_PATH);
+   else printf("trace of %ld timed events written to %s\n", events, TRACE_PATH);
+}
+
+/* stops the simulation thread at exit
+ */
+GLvoid stopSimulation()
+{
+   delete sim;
+   sim = 0;
+}
+
+/* prints the average CPU time per frame spent drawing the skirt, for each way of drawing it used,
+ * and during playback spent loading the recorded frames
+ */
+GLvoid reportDrawTimes()
+{
+   const char *names[] = { "vertex by vertex", "from vertex buffers" };
+   long frames = drawFrames[0] + drawFrames[1];
+   
+   for(int b = 0; b < 2; b++)
+      if(drawFrames[b])
+         printf("drawing %s: %.3f ms CPU/frame over %ld frames\n", names[b],
+                1e3*drawSeconds[b]/drawFrames[b], drawFrames[b]);
+   if(player && frames)
+      printf("loading played back frames: %.3f ms CPU/frame, %ld frames decoded\n",
+             1e3*loadSeconds/frames, player->getDecodedFrames());
+}
@@ -0,0 +1,88 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: mappedfile.cpp - Implementation for the MappedFile class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "mappedfile.h"
+#include <cstdio> //used for fopen(), fclose(), fread(), fwrite(), sprintf(), rename(), remove()
+#include <cstring> //used for strlen()
+#include <sys/stat.h> //used for stat()
+#ifndef _WIN32
+#include <sys/mman.h> //used for mmap(), munmap()
+#include <fcntl.h> //used for open()
+#include <unistd.h> //used for close()
+#endif
+
+/* MappedFile - CONSTRUCTOR
+ */
+MappedFile::MappedFile(const char *path)
+{
+   struct stat info;
+   
+   data = 0;
+   size = 0;
+   if(stat(path, &info) || !info.st_size) return;
+   size = info.st_size;
+#ifndef _WIN32
+   int file = open(path, O_RDONLY);
+   if(file < 0) return;
+   void *map = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+   close(file);
+   if(map != MAP_FAILED) data = static_cast<unsigned char*>(map);
+#else
+   FILE *in = fopen(path, "rb");
+   if(!in) return;
+   data = new unsigned char[size];
+   if(fread(data, 1, size, in) != size){
+      delete [] data;
+      data = 0;
+   }
+   fclose(in);
+#endif
+}
+
+/* MappedFile - DESTRUCTOR
+ */
+MappedFile::~MappedFile()
+{
+   if(!data) return;
+#ifndef _WIN32
+   munmap(data, size);
+#else
+   delete [] data;
+#endif
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* replaces the file at path with the given parts, one after another. They are written to a
+ * temporary file that is renamed over path once complete, so a reader never sees a file half
+ * written. Returns false if it could not be written
+ */
+bool MappedFile::write(const char *path, const void *const *parts, const size_t *sizes, int count)
+{
+   char *temporary = new char[strlen(path) + 5];
+   sprintf(temporary, "%s.tmp", path);
+   FILE *out = fopen(temporary, "wb");
+   bool isWritten = out != 0;
+   
+   for(int p = 0; isWritten && p < count; p++)
+      isWritten = fwrite(parts[p], 1, sizes[p], out) == sizes[p];
+   if(out && fclose(out)) isWritten = false;
+   //rename() does not replace an existing file everywhere
+   if(isWritten){
+      remove(path);
+      isWritten = !rename(temporary, path);
+   }
+   if(!isWritten) remove(temporary);
+   delete [] temporary;
+   return isWritten;
+}
@@ -0,0 +1,53 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: mappedfile.h - Interface for the MappedFile class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef> //used for size_t
+
+/* A read-only view of a whole file, mapped into memory so it is read straight from the page cache
+ * as it is touched. Where mapping is unavailable the file is read into memory instead. Used for the
+ * binary caches and checkpoints that let a run skip work done by an earlier one.
+ */
+class MappedFile
+{
+public:
+   //constructor. Maps the file at path; check isOpen()
+   MappedFile(const char *path);
+   //destructor. Unmaps the file
+   ~MappedFile();
+   
+//::ACCESSORS:://
+   bool isOpen() const { return data != 0; }
+   const unsigned char *getData() const { return data; }
+   size_t getSize() const { return size; }
+   
+//::STATIC FUNCTIONS:://
+   //replaces the file at path with the given parts, one after another. They are written to a
+   //temporary file that is renamed over path once complete, so a reader never sees a file half
+   //written. Returns false if it could not be written
+   static bool write(const char *path, const void *const *parts, const size_t *sizes, int count);
+   
+private:
+//::VARIABLES:://
+   unsigned char *data;
+   size_t size;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //not copyable
+   MappedFile(const MappedFile &);
+   MappedFile& operator=(const MappedFile &);
+};
+
+#endif // MAPPEDFILE_H
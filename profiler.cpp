@@ -0,0 +1,135 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: profiler.cpp - Implementation for the Profiler class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "profiler.h"
+#include "timer.h"
+#include <cstdio> //used for FILE, fopen(), fprintf(), fclose()
+#include <cstdlib> //used for qsort()
+
+using namespace std;
+
+//the clock is measured against the monotonic clock over at least this many seconds
+const double CALIBRATION_SECONDS = 0.05;
+const char *SECTION_NAMES[Profiler::SECTION_COUNT] = { "step", "drive", "springs", "velocity",
+   "assemble", "solve", "constraints", "position", "collisions", "normals", "draw", "display" };
+
+//orders doubles ascending for qsort()
+static int compareDoubles(const void *a, const void *b);
+
+Profiler::Sample Profiler::samples[SECTION_COUNT][HISTORY];
+long Profiler::counts[SECTION_COUNT];
+__thread long long Profiler::lapMark;
+__thread int Profiler::threadNumber;
+int Profiler::threadCount;
+//where the trace starts, and where the clock is measured from
+static const long long startTicks = Profiler::ticks();
+static const double startSeconds = Timer::now();
+
+//::ACCESSORS:://///////////////////////////////////////////////////////////////////////////////////
+
+/* returns whether the timers are compiled in
+ */
+bool Profiler::isCompiledIn()
+{
+#ifdef CLOTHSIM_PROFILE
+   return true;
+#else
+   return false;
+#endif
+}
+
+/* returns the name of a section
+ */
+const char *Profiler::getName(Section section)
+{
+   return SECTION_NAMES[section];
+}
+
+/* returns the minimum, the average and the 99th percentile of the latest window samples of a
+ * section, at most HISTORY, in seconds
+ */
+Profiler::Stats Profiler::getStats(Section section, int window)
+{
+   double durations[HISTORY];
+   Stats stats = { 0, 0, 0, 0 };
+   long count = counts[section];
+   double sum = 0, scale = secondsPerTick();
+   
+   if(window > HISTORY) window = HISTORY;
+   for(long s = count - 1; s >= 0 && s >= count - window; s--){
+      const Sample &sample = samples[section][s % HISTORY];
+      durations[stats.samples++] = scale*(sample.end - sample.start);
+      sum += durations[stats.samples-1];
+   }
+   if(!stats.samples) return stats;
+   qsort(durations, stats.samples, sizeof(double), compareDoubles);
+   stats.min = durations[0];
+   stats.avg = sum/stats.samples;
+   //the smallest duration at least 99% of the samples do not exceed
+   stats.p99 = durations[(99*stats.samples + 99)/100 - 1];
+   return stats;
+}
+
+/* writes the samples kept as complete events of a Chrome trace to the given path, timed in
+ * microseconds from the start of the program, each on the thread that recorded it. Returns the
+ * number of events written, or -1 if the file could not be written
+ */
+long Profiler::writeTrace(const char *path)
+{
+   FILE *file = fopen(path, "w");
+   double scale = 1e6*secondsPerTick();
+   long events = 0;
+   
+   if(!file) return -1;
+   fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+   for(int section = 0; section < SECTION_COUNT; section++){
+      long count = counts[section];
+      for(long s = (count > HISTORY) ? count - HISTORY : 0; s < count; s++){
+         const Sample &sample = samples[section][s % HISTORY];
+         fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                 "\"dur\":%.3f}", events ? "," : "", SECTION_NAMES[section], sample.thread,
+                 scale*(sample.start - startTicks), scale*(sample.end - sample.start));
+         events++;
+      }
+   }
+   fprintf(file, "\n]}\n");
+   return (fclose(file) == 0) ? events : -1;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* returns the seconds per tick, as the ticks since the start against the monotonic clock. Waits
+ * out the rest of CALIBRATION_SECONDS if asked sooner
+ */
+double Profiler::secondsPerTick()
+{
+   double seconds;
+   long long ticks;
+   
+   do{
+      seconds = Timer::now() - startSeconds;
+      ticks = Profiler::ticks() - startTicks;
+   }while(seconds < CALIBRATION_SECONDS);
+   return seconds/ticks;
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* orders doubles ascending for qsort()
+ */
+int compareDoubles(const void *a, const void *b)
+{
+   double x = *static_cast<const double*>(a), y = *static_cast<const double*>(b);
+   
+   return (x < y) ? -1 : (x > y);
+}
@@ -0,0 +1,196 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: profiler.h - Interface for the Profiler class and its scoped timers
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h> //used for __rdtsc()
+#else
+#include "timer.h"
+#endif
+
+//The timers are compiled in with CLOTHSIM_PROFILE (make profile, or PROFILE=1) and out without.
+//PROFILE_SCOPE times the rest of the enclosing scope as a section. A step's phases follow each
+//other, so rather than two clock reads each they are laps: PROFILE_LAPS starts this thread's lap
+//clock and times the rest of the enclosing scope up to the last lap as a section, and PROFILE_LAP
+//times a section from the previous lap to now. Laps taken with no lap clock running are ignored
+#ifdef CLOTHSIM_PROFILE
+#define PROFILE_SCOPE(section) ProfileScope profileScope(Profiler::section)
+#define PROFILE_LAPS(section) ProfileLaps profileLaps(Profiler::section)
+#define PROFILE_LAP(section) Profiler::lap(Profiler::section)
+#else
+#define PROFILE_SCOPE(section)
+#define PROFILE_LAPS(section)
+#define PROFILE_LAP(section)
+#endif
+
+/* Records how long the sections of the program take: a simulation step, its phases and the
+ * drawing of a frame. Every section keeps its latest HISTORY samples in a ring, as the start and
+ * end of each in ticks of the time stamp counter, for rolling statistics and a Chrome trace. Any
+ * thread may record a section: each sample claims its slot in the ring by an atomic increment of
+ * the section's count, so recording takes no locks. A reader may see a sample being written as the
+ * one HISTORY before it
+ */
+class Profiler
+{
+public:
+   //the sections timed. The phases of a step depend on the integrator: explicit steps take DRIVE,
+   //SPRINGS, VELOCITY and POSITION, implicit ones DRIVE, SPRINGS, ASSEMBLE, SOLVE and POSITION,
+   //and XPBD ones DRIVE, POSITION (the prediction), CONSTRAINTS and VELOCITY (the damping); all
+   //end with NORMALS, after COLLISIONS if any are resolved (before VELOCITY under XPBD). DRAW is
+   //the skirt's draw call and DISPLAY the whole frame
+   enum Section { STEP, DRIVE, SPRINGS, VELOCITY, ASSEMBLE, SOLVE, CONSTRAINTS, POSITION,
+                  COLLISIONS, NORMALS, DRAW, DISPLAY, SECTION_COUNT };
+   //the samples kept per section, and how many of the latest the rolling statistics cover
+   static const int HISTORY = 4096, WINDOW = 256;
+   
+   //the statistics of a section's latest samples, in seconds
+   struct Stats
+   {
+      int samples;
+      double min, avg, p99;
+   };
+   
+//::ACCESSORS:://
+   //returns whether the timers are compiled in
+   static bool isCompiledIn();
+   //returns the name of a section
+   static const char *getName(Section section);
+   //returns the number of samples a section has recorded in all
+   static long getCount(Section section) { return counts[section]; }
+   //returns the statistics of the latest window samples of a section, at most HISTORY
+   static Stats getStats(Section section, int window = WINDOW);
+   //writes the samples kept as a Chrome trace (chrome://tracing, Perfetto) to the given path.
+   //Returns the number of events written, or -1 if the file could not be written
+   static long writeTrace(const char *path);
+   
+//::MUTATORS:://
+   //returns the time stamp counter
+   static long long ticks();
+   //records a sample of a section from start to end ticks
+   static void record(Section section, long long start, long long end);
+   //starts the lap clock of this thread and returns its start
+   static long long startLaps() { return lapMark = ticks(); }
+   //stops the lap clock of this thread and returns its last lap
+   static long long stopLaps();
+   //records a section from the last lap of this thread to now, if its lap clock is running
+   static void lap(Section section);
+   
+private:
+//::VARIABLES:://
+   struct Sample
+   {
+      long long start, end;
+      int thread;
+   };
+   static Sample samples[SECTION_COUNT][HISTORY];
+   static long counts[SECTION_COUNT];
+   //this thread's last lap, zero with its lap clock stopped, and its number in the trace
+   static __thread long long lapMark;
+   static __thread int threadNumber;
+   static int threadCount;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //returns the seconds per tick, measured against the monotonic clock since the start
+   static double secondsPerTick();
+   //only static members
+   Profiler();
+};
+
+/* Times the rest of the scope it is made in as a section; see PROFILE_SCOPE
+ */
+class ProfileScope
+{
+public:
+   //constructor
+   ProfileScope(Profiler::Section section) : section(section), start(Profiler::ticks()) {}
+   //destructor
+   ~ProfileScope() { Profiler::record(section, start, Profiler::ticks()); }
+   
+private:
+   Profiler::Section section;
+   long long start;
+   
+   //not copyable
+   ProfileScope(const ProfileScope &);
+   ProfileScope& operator=(const ProfileScope &);
+};
+
+/* Runs the lap clock of its thread over the rest of the scope it is made in, and times that scope
+ * up to the last lap as a section; see PROFILE_LAPS
+ */
+class ProfileLaps
+{
+public:
+   //constructor
+   ProfileLaps(Profiler::Section section) : section(section), start(Profiler::startLaps()) {}
+   //destructor
+   ~ProfileLaps() { Profiler::record(section, start, Profiler::stopLaps()); }
+   
+private:
+   Profiler::Section section;
+   long long start;
+   
+   //not copyable
+   ProfileLaps(const ProfileLaps &);
+   ProfileLaps& operator=(const ProfileLaps &);
+};
+
+//::INLINE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* returns the time stamp counter, or where there is none the monotonic clock in nanoseconds
+ */
+inline long long Profiler::ticks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+   return __rdtsc();
+#else
+   return (long long)(1e9*Timer::now());
+#endif
+}
+
+/* records a sample of a section from start to end ticks into its ring, in the slot its count
+ * claims. Threads recording the same section at once each claim a slot of their own
+ */
+inline void Profiler::record(Section section, long long start, long long end)
+{
+   if(!threadNumber) threadNumber = __sync_add_and_fetch(&threadCount, 1);
+   Sample &sample = samples[section][__sync_fetch_and_add(&counts[section], 1) % HISTORY];
+   sample.start = start;
+   sample.end = end;
+   sample.thread = threadNumber;
+}
+
+/* stops the lap clock of this thread and returns its last lap
+ */
+inline long long Profiler::stopLaps()
+{
+   long long last = lapMark;
+   
+   lapMark = 0;
+   return last;
+}
+
+/* records a section from the last lap of this thread to now, if its lap clock is running, and
+ * makes now the last lap
+ */
+inline void Profiler::lap(Section section)
+{
+   if(!lapMark) return;
+   long long now = ticks();
+   record(section, lapMark, now);
+   lapMark = now;
+}
+
+#endif //PROFILER_H
@@ -63,6 +63,18 @@ Quaternion Quaternion::inverse() const
    return inverse;
 }
 
+/* writes the 3x3 rotation matrix of this versor to m, row by row. Expanding q*p*inverse() for a
+ * point p gives each coordinate of the result as a fixed combination of those of p
+ */
+void Quaternion::toMatrix(float m[9]) const
+{
+   float s = q[S], x = q[X], y = q[Y], z = q[Z];
+   
+   m[0] = 1 - 2*(y*y + z*z);  m[1] = 2*(x*y - s*z);      m[2] = 2*(x*z + s*y);
+   m[3] = 2*(x*y + s*z);      m[4] = 1 - 2*(x*x + z*z);  m[5] = 2*(y*z - s*x);
+   m[6] = 2*(x*z - s*y);      m[7] = 2*(y*z + s*x);      m[8] = 1 - 2*(x*x + y*y);
+}
+
 /* makes this quaternion a unit quaternion
  */
 void Quaternion::normalize()
@@ -115,17 +127,63 @@ Quaternion Quaternion::operator*(const Quaternion &Q) const
    return product;
 }
 
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* rotates count points by the rotation matrix m. The loop streams through the arrays with no
+ * quaternion temporaries, so it vectorizes
+ */
+void Quaternion::rotatePoints(const float m[9], const float *x, const float *y, const float *z,
+                              float *rotX, float *rotY, float *rotZ, int count)
+{
+   const float m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3], m4 = m[4], m5 = m[5], m6 = m[6],
+               m7 = m[7], m8 = m[8];
+   const float *__restrict__ px = x, *__restrict__ py = y, *__restrict__ pz = z;
+   float *__restrict__ rx = rotX, *__restrict__ ry = rotY, *__restrict__ rz = rotZ;
+   
+   for(int i = 0; i < count; i++){
+      rx[i] = m0*px[i] + m1*py[i] + m2*pz[i];
+      ry[i] = m3*px[i] + m4*py[i] + m5*pz[i];
+      rz[i] = m6*px[i] + m7*py[i] + m8*pz[i];
+   }
+}
+
+/* writes to results the slerps of versors q1 and q2 at each of the count steps. The angle between
+ * them and its sine are found once for all the steps. q2 is negated if needed so the slerp takes
+ * the shorter way round, and versors too close for the sine to divide by are interpolated linearly
+ * and renormalized instead
+ */
+void Quaternion::slerp(const Quaternion &q1, const Quaternion &q2, const float *steps,
+                       Quaternion *results, int count)
+{
+   float cosTheta = q1.q[S]*q2.q[S] + q1.q[X]*q2.q[X] + q1.q[Y]*q2.q[Y] + q1.q[Z]*q2.q[Z];
+   float sign = (cosTheta < 0) ? -1 : 1;
+   cosTheta *= sign;
+   
+   if(cosTheta > 0.9995f){
+      for(int k = 0; k < count; k++){
+         float c1 = 1 - steps[k], c2 = sign*steps[k];
+         Quaternion &r = results[k];
+         for(int c = 0; c < 4; c++) r.q[c] = c1*q1.q[c] + c2*q2.q[c];
+         float mag = sqrt(r.q[S]*r.q[S] + r.q[X]*r.q[X] + r.q[Y]*r.q[Y] + r.q[Z]*r.q[Z]);
+         for(int c = 0; c < 4; c++) r.q[c] /= mag;
+      }
+      return;
+   }
+   float theta = acos(cosTheta), inverseSin = 1/sin(theta);
+   for(int k = 0; k < count; k++){
+      float c1 = sin((1 - steps[k])*theta)*inverseSin, c2 = sign*sin(steps[k]*theta)*inverseSin;
+      for(int c = 0; c < 4; c++) results[k].q[c] = c1*q1.q[c] + c2*q2.q[c];
+   }
+}
+
+//::FRIEND FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
 /* calculates slerp (spherical linear interpolation) based off two versors
  */
-Quaternion slerp(Quaternion &q1, Quaternion &q2, float step)
+Quaternion slerp(const Quaternion &q1, const Quaternion &q2, float step)
 {
-   float theta = acos(q1.q[1]*q2.q[1] + q1.q[2]*q2.q[2] + q1.q[3]*q2.q[3]),
-         q1Coeff = sin((1-step)*theta)/sin(theta), q2Coeff = sin(step*theta)/sin(theta);
    Quaternion result;
    
-   result.q[1] = q1Coeff*q1.q[1] + q2Coeff*q2.q[1];
-   result.q[2] = q1Coeff*q1.q[2] + q2Coeff*q2.q[2];
-   result.q[3] = q1Coeff*q1.q[3] + q2Coeff*q2.q[3];
-   
+   Quaternion::slerp(q1, q2, &step, &result, 1);
    return result;
 }
@@ -29,6 +29,9 @@ public:
    
    //calculates and returns the inverse of this quaternion
    Quaternion inverse() const;
+   //writes the 3x3 rotation matrix of this versor to m, row by row: rotating a point p by m is
+   //the same as taking the vector part of (*this)*p*inverse(), at a fraction of the cost
+   void toMatrix(float m[9]) const;
    
 //::ACCESSORS:://
    float getS() const { return q[S]; }
@@ -45,9 +48,19 @@ public:
    Quaternion operator+(const Quaternion &Q) const;
    Quaternion operator*(const Quaternion &Q) const;
    
+//::STATIC FUNCTIONS:://
+   //rotates count points by the rotation matrix m (see toMatrix()). The points and the results are
+   //in structure-of-arrays form, and the results must not overlap the points
+   static void rotatePoints(const float m[9], const float *x, const float *y, const float *z,
+                            float *rotX, float *rotY, float *rotZ, int count);
+   //writes to results the slerps of versors q1 and q2 at each of the count steps (0 gives q1, 1
+   //gives q2), e.g. the orientations of a drive at each substep between two keyframes
+   static void slerp(const Quaternion &q1, const Quaternion &q2, const float *steps,
+                     Quaternion *results, int count);
+   
 //::FRIEND FUNCTIONS:://
    //calculates slerp (spherical linear interpolation) based off two versors
-   friend Quaternion slerp(Quaternion &q1, Quaternion &q2, float step);
+   friend Quaternion slerp(const Quaternion &q1, const Quaternion &q2, float step);
    
 private:
 //::PRIVATE CONSTANTS:://
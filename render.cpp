@@ -0,0 +1,348 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: render.cpp - Offscreen runner; renders the skirt to a sequence of images without a window
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "skirtrenderer.h"
+#include "scene.h"
+#include "framewriter.h"
+#include "trajectoryplayer.h"
+#include "timer.h"
+#include <cstdlib> //used for atoi(), atof(), EXIT_SUCCESS, EXIT_FAILURE
+#include <cstdio> //used for printf(), sscanf()
+#include <cstring> //used for strcmp(), memcpy()
+#include <EGL/egl.h> //used for the EGL context and pbuffer surface
+#include <EGL/eglext.h> //used for eglGetPlatformDisplayEXT() and EGL_PLATFORM_SURFACELESS_MESA
+#include <GL/gl.h> //used for various gl types and functions
+#include <GL/glext.h> //used for the pixel buffer object function types and constants
+
+//Global Constants
+const int DEFAULT_FRAMES = 1000, DEFAULT_SIZE = 720, DEFAULT_SUBSTEPS = 4, HORIZ_ANGLE = 90;
+//the frames that can wait to be written, and the pixel buffers frames are read back through
+const int IMAGE_BUFFERS = 8, PIXEL_BUFFERS = 2;
+//where the rest state of the skirt is cached, as the texture's mipmaps are
+const char *REST_DIRECTORY = "assets";
+
+//the pixel buffer object entry points, looked up once the context is current
+PFNGLGENBUFFERSPROC genBuffers;
+PFNGLDELETEBUFFERSPROC deleteBuffers;
+PFNGLBINDBUFFERPROC bindBuffer;
+PFNGLBUFFERDATAPROC bufferData;
+PFNGLMAPBUFFERPROC mapBuffer;
+PFNGLUNMAPBUFFERPROC unmapBuffer;
+
+//prints the command line usage
+void usage(const char *prog);
+//makes an OpenGL context current on an offscreen surface of the given size. Returns false if no
+//EGL display could give one
+bool createContext(EGLDisplay &display, int width, int height);
+//looks up the pixel buffer object entry points. Returns false if the context lacks them
+bool loadPixelBuffers();
+//starts reading the frame into the bound pixel buffer, or straight into image without one
+void readFrame(int width, int height, unsigned char *image);
+//copies the frame read into the bound pixel buffer into image. Returns false if it cannot be mapped
+bool copyFrame(int width, int height, unsigned char *image);
+
+//::MAIN:://////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+   Timer startup;
+   int frameCount = DEFAULT_FRAMES, width = DEFAULT_SIZE, height = DEFAULT_SIZE;
+   int substeps = DEFAULT_SUBSTEPS, threads = 1, xRes = Skirt::DEFAULT_X_RES;
+   int yRes = Skirt::DEFAULT_Y_RES;
+   float amplitude = -1, frequency = -1;
+   bool is3D = true, isBuffered = true, isTextureCached = true, isWarmStarted = true;
+   const char *prefix = "frame", *loadPath = 0, *playPath = 0;
+   
+   for(int a = 1; a < argc; a++){
+      if(!strcmp(argv[a], "-n") && a+1 < argc)      frameCount = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-o") && a+1 < argc) prefix = argv[++a];
+      else if(!strcmp(argv[a], "-r") && a+1 < argc){
+         if(sscanf(argv[++a], "%dx%d", &width, &height) != 2) width = 0;
+      }
+      else if(!strcmp(argv[a], "-s") && a+1 < argc) substeps = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-a") && a+1 < argc) amplitude = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-f") && a+1 < argc) frequency = atof(argv[++a]);
+      else if(!strcmp(argv[a], "-t") && a+1 < argc) threads = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-x") && a+1 < argc) xRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-y") && a+1 < argc) yRes = atoi(argv[++a]);
+      else if(!strcmp(argv[a], "-2"))               is3D = false;
+      else if(!strcmp(argv[a], "-3"))               is3D = true;
+      else if(!strcmp(argv[a], "-m"))               isBuffered = false;
+      else if(!strcmp(argv[a], "-u"))               isTextureCached = false;
+      else if(!strcmp(argv[a], "-c"))               isWarmStarted = false;
+      else if(!strcmp(argv[a], "-l") && a+1 < argc) loadPath = argv[++a];
+      else if(!strcmp(argv[a], "-p") && a+1 < argc) playPath = argv[++a];
+      else{
+         usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(frameCount <= 0 || width <= 0 || height <= 0 || substeps <= 0 || threads <= 0 || xRes < 3 ||
+      yRes < 3 || (playPath && loadPath)){
+      usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   //a trajectory played back sets the resolution, the frames run out with it, and nothing is
+   //simulated to start at rest
+   TrajectoryPlayer *player = 0;
+   if(playPath){
+      player = new TrajectoryPlayer(playPath);
+      if(!player->isOpen()){
+         printf("Unable to read a trajectory from %s\n", playPath);
+         return EXIT_FAILURE;
+      }
+      xRes = player->getXRes();
+      yRes = player->getYRes();
+      int covered = int(player->getSteps()/substeps) + 1;
+      if(frameCount > covered) frameCount = covered;
+      isWarmStarted = false;
+   }
+   
+   EGLDisplay display;
+   if(!createContext(display, width, height)){
+      printf("Unable to create an offscreen OpenGL context\n");
+      return EXIT_FAILURE;
+   }
+   bool hasPixelBuffers = loadPixelBuffers();
+   
+   Skirt skirt(xRes, yRes);
+   if(amplitude >= 0) skirt.setAmplitude(amplitude);
+   if(frequency >= 0) skirt.setFrequency(frequency);
+   skirt.setThreadCount(threads);
+   if(is3D) skirt.rotate3D();
+   else skirt.rotate2D();
+   //the skirt starts hanging at rest rather than as the cone it is built as, or where a checkpoint
+   //left it, motion and all
+   Timer restTimer;
+   int settled = 0;
+   bool isRestCached = true;
+   if(loadPath){
+      if(!skirt.restoreState(loadPath)){
+         printf("Unable to restore a %dx%d checkpoint from %s\n", xRes, yRes, loadPath);
+         return EXIT_FAILURE;
+      }
+   }
+   else if(isWarmStarted) settled = skirt.warmStart(REST_DIRECTORY, &isRestCached);
+   double restSeconds = restTimer.elapsed();
+   SkirtFrame frame;
+   skirt.allocFrame(frame);
+   
+   Timer textureTimer;
+   isTextureCached = skirt.loadTexture(isTextureCached);
+   double textureSeconds = textureTimer.elapsed();
+   SkirtRenderer renderer(skirt);
+   renderer.init();
+   renderer.setBuffered(isBuffered);
+   initScene();
+   projectScene(width, height);
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   GLuint pixelBuffers[PIXEL_BUFFERS];
+   if(hasPixelBuffers){
+      genBuffers(PIXEL_BUFFERS, pixelBuffers);
+      for(int b = 0; b < PIXEL_BUFFERS; b++){
+         bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[b]);
+         bufferData(GL_PIXEL_PACK_BUFFER, 3*width*height, 0, GL_STREAM_READ);
+      }
+      bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+   }
+   
+   if(player)
+      printf("clothSim render: %d frames of %dx%d pixels to %s####.ppm, %dx%d vertices, %d steps "
+             "per frame, played back from %s (%d frames %d steps apart%s)\n", frameCount, width,
+             height, prefix, skirt.getXRes(), skirt.getYRes(), substeps, playPath,
+             player->getFrameCount(), player->getStepsPerFrame(),
+             player->getHasNormals() ? ", with normals" : "");
+   else
+      printf("clothSim render: %d frames of %dx%d pixels to %s####.ppm, %dx%d vertices, %d steps "
+             "per frame, amplitude %g, frequency %g, %s rotation, %d threads\n", frameCount,
+             width, height, prefix, skirt.getXRes(), skirt.getYRes(), substeps,
+             skirt.getAmplitude(), skirt.getFrequency(), skirt.getIs3DRotation() ? "3D" : "2D",
+             skirt.getThreadCount());
+   if(loadPath) printf("checkpoint restored from %s in %.3f ms\n", loadPath, 1e3*restSeconds);
+   else if(settled && isRestCached)
+      printf("rest state: settled in %d steps, %.1f ms, and cached in %s\n", settled,
+             1e3*restSeconds, REST_DIRECTORY);
+   else if(settled)
+      printf("rest state: settled in %d steps, %.1f ms; unable to cache it in %s\n", settled,
+             1e3*restSeconds, REST_DIRECTORY);
+   else if(isWarmStarted) printf("rest state: restored in %.3f ms\n", 1e3*restSeconds);
+   printf("%s (%s), drawing %s, reading back %s\n", glGetString(GL_RENDERER),
+          glGetString(GL_VERSION), renderer.getIsBuffered() ? "from vertex buffers" :
+          "vertex by vertex", hasPixelBuffers ? "through pixel buffers" : "directly");
+   
+   /* Frame f is read into pixel buffer f%PIXEL_BUFFERS while frame f-1 is copied out of the other
+    * one and queued for the writing thread, which writes it while frame f+1 is simulated, or
+    * decoded from the trajectory and drawn between its recorded frames
+    */
+   FrameWriter writer(prefix, width, height, IMAGE_BUFFERS);
+   double simulateSeconds = 0, drawSeconds = 0;
+   Timer timer;
+   for(int f = 0; f <= frameCount; f++){
+      if(f < frameCount){
+         Timer phase;
+         GLfloat alpha = 1;
+         if(player) player->loadFrame(player->frameAt(double(f)*substeps, alpha), skirt, frame);
+         else{
+            skirt.updateSkirt(substeps);
+            skirt.saveFrame(frame);
+         }
+         simulateSeconds += phase.elapsed();
+         
+         phase.start();
+         placeSkirt(skirt, HORIZ_ANGLE);
+         renderer.draw(frame, alpha);
+         if(hasPixelBuffers){
+            bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[f%PIXEL_BUFFERS]);
+            readFrame(width, height, 0);
+         }
+         else{
+            readFrame(width, height, writer.nextImage());
+            writer.write(f);
+         }
+         drawSeconds += phase.elapsed();
+         if(f == 0){
+            glFinish();
+            printf("startup to first frame: %.1f ms, texture %s in %.1f ms\n",
+                   1e3*startup.elapsed(), isTextureCached ? "mapped from its cache" :
+                   "mipmapped from the image", 1e3*textureSeconds);
+         }
+      }
+      if(hasPixelBuffers && f > 0){
+         Timer phase;
+         bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[(f-1)%PIXEL_BUFFERS]);
+         if(copyFrame(width, height, writer.nextImage())) writer.write(f-1);
+         else writer.skip();
+         drawSeconds += phase.elapsed();
+      }
+   }
+   writer.finish();
+   double seconds = timer.elapsed();
+   
+   printf("elapsed: %.3f s\n", seconds);
+   printf("frames/second: %.1f\n", frameCount/seconds);
+   printf("ms/frame: %s %.3f, drawing and reading back %.3f, waiting for the writer %.3f\n",
+          player ? "decoding" : "simulating", 1e3*simulateSeconds/frameCount,
+          1e3*(drawSeconds - writer.getWaitSeconds())/frameCount,
+          1e3*writer.getWaitSeconds()/frameCount);
+   if(writer.getFailed()) printf("Unable to write %d frames\n", writer.getFailed());
+   
+   if(hasPixelBuffers){
+      bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      deleteBuffers(PIXEL_BUFFERS, pixelBuffers);
+   }
+   skirt.freeFrame(frame);
+   delete player;
+   eglTerminate(display);
+   
+   return writer.getFailed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* prints the command line usage
+ */
+void usage(const char *prog)
+{
+   printf("usage: %s [-n frames] [-o prefix] [-r widthxheight] [-s steps] [-a amplitude]\n"
+          "       [-f frequency] [-2 | -3] [-t threads] [-x columns] [-y rows] [-m] [-u] [-c]\n"
+          "       [-l checkpoint | -p trajectory]\n", prog);
+   printf("   -n  number of frames to render (default %d)\n", DEFAULT_FRAMES);
+   printf("   -o  frame n is written to <prefix>n.ppm, n padded to four digits (default frame)\n");
+   printf("   -r  size of the frames in pixels (default %dx%d)\n", DEFAULT_SIZE, DEFAULT_SIZE);
+   printf("   -s  explicit steps simulated per frame (default %d)\n", DEFAULT_SUBSTEPS);
+   printf("   -a  amplitude of the oscillatory motion in degrees (0 to 30)\n");
+   printf("   -f  frequency of the oscillatory motion in radians per step (0 to 0.1)\n");
+   printf("   -2  2D rotation about the z-axis\n");
+   printf("   -3  3D rotation about both the x-axis and z-axis (default)\n");
+   printf("   -t  number of solver threads (default 1)\n");
+   printf("   -x  vertices around the waist (default %d)\n", Skirt::DEFAULT_X_RES);
+   printf("   -y  rows of vertices from waist to hem (default %d)\n", Skirt::DEFAULT_Y_RES);
+   printf("   -m  draw vertex by vertex in immediate mode rather than from vertex buffers\n");
+   printf("   -u  build the texture mipmaps from the image rather than its cache\n");
+   printf("   -c  start from the skirt as built rather than at rest (cold start)\n");
+   printf("   -l  start from a checkpoint written by clothSimHeadless -o, motion and all\n");
+   printf("   -p  play back a trajectory recorded by clothSimHeadless -r instead of simulating\n");
+}
+
+/* makes an OpenGL context current on an offscreen pbuffer surface of the given size. Mesa's
+ * surfaceless platform needs no display server at all; other EGL implementations are asked for
+ * their default display. Returns false if no EGL display could give one
+ */
+bool createContext(EGLDisplay &display, int width, int height)
+{
+   EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE,
+                              EGL_OPENGL_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+                              EGL_DEPTH_SIZE, 24, EGL_NONE };
+   EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+   EGLConfig config;
+   EGLint configCount;
+   
+   display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+   PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+   if(getPlatformDisplay)
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+#endif
+   if(display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0)){
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+      if(display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0)) return false;
+   }
+   if(!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(display, configAttribs, &config, 1, &configCount) || !configCount)
+      return false;
+   EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+   EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, 0);
+   
+   return surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT &&
+          eglMakeCurrent(display, surface, surface, context);
+}
+
+/* looks up the pixel buffer object entry points. Pixel buffer objects are core in OpenGL 2.1.
+ * Returns false if the context lacks them
+ */
+bool loadPixelBuffers()
+{
+   int major = 1, minor = 0;
+   const char *version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+   if(version) sscanf(version, "%d.%d", &major, &minor);
+   
+   genBuffers = (PFNGLGENBUFFERSPROC)eglGetProcAddress("glGenBuffers");
+   deleteBuffers = (PFNGLDELETEBUFFERSPROC)eglGetProcAddress("glDeleteBuffers");
+   bindBuffer = (PFNGLBINDBUFFERPROC)eglGetProcAddress("glBindBuffer");
+   bufferData = (PFNGLBUFFERDATAPROC)eglGetProcAddress("glBufferData");
+   mapBuffer = (PFNGLMAPBUFFERPROC)eglGetProcAddress("glMapBuffer");
+   unmapBuffer = (PFNGLUNMAPBUFFERPROC)eglGetProcAddress("glUnmapBuffer");
+   return (major > 2 || (major == 2 && minor >= 1)) && genBuffers && deleteBuffers &&
+          bindBuffer && bufferData && mapBuffer && unmapBuffer;
+}
+
+/* starts reading the frame into the bound pixel buffer, or straight into image without one. With
+ * a pixel buffer bound glReadPixels() may return before the pixels are there
+ */
+void readFrame(int width, int height, unsigned char *image)
+{
+   glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, image);
+}
+
+/* copies the frame read into the bound pixel buffer into image. Mapping the buffer waits for the
+ * read to finish. Returns false, leaving the image as it was, if the buffer cannot be mapped
+ */
+bool copyFrame(int width, int height, unsigned char *image)
+{
+   const void *pixels = mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+   
+   if(!pixels) return false;
+   memcpy(image, pixels, 3*width*height);
+   unmapBuffer(GL_PIXEL_PACK_BUFFER);
+   return true;
+}
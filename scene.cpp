@@ -0,0 +1,66 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: scene.cpp - The scene the skirt is drawn in; shared by clothSim and its offscreen renderer
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "scene.h"
+#include <GL/glu.h> //used for gluPerspective()
+
+/* sets up shading, depth testing and lighting in the current GL context
+ */
+void initScene()
+{
+   glEnable(GL_TEXTURE_2D);
+   
+   glShadeModel(GL_SMOOTH);
+   glClearColor(0.4f, 0.4f, 0.7f, 0.0f);
+   glClearDepth(1.0f);
+   glEnable(GL_DEPTH_TEST);
+   glDepthFunc(GL_LEQUAL);
+   
+   //lighting init
+   GLfloat lightPos[] = {1, 0.25, 0.5, 0};
+   glEnable(GL_LIGHTING);
+   glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
+   glEnable(GL_LIGHT0);
+   glEnable(GL_COLOR_MATERIAL);
+   
+   glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+}
+
+/* sets the viewport and the projection for a drawing area of the given size
+ */
+void projectScene(int width, int height)
+{
+   height = height?height:1;
+   glViewport(0, 0, width, height);
+   
+   //update projection matrix
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   gluPerspective(FOV, (GLdouble)width/height, CLIP_NEAR, CLIP_FAR);
+   
+   //init model-view matrix
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+}
+
+/* clears the frame and places the skirt in front of the camera, turned by horizAngle degrees
+ */
+void placeSkirt(const Skirt &skirt, int horizAngle)
+{
+   glLoadIdentity();
+   
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   
+   glTranslatef(0, 1.5*skirt.getHeight(), -7); //centers the skirt in front of the camera
+   glRotatef(horizAngle, 0,1,0); //rotates the skirt so the texture is centered
+}
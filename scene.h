@@ -0,0 +1,30 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: scene.h - The scene the skirt is drawn in; shared by clothSim and its offscreen renderer
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "skirt.h"
+#include <GL/gl.h> //used for various gl types and functions
+
+//Global Constants
+const GLdouble FOV = 45, CLIP_NEAR = 0.1, CLIP_FAR = 100;
+
+//sets up shading, depth testing and lighting in the current GL context
+void initScene();
+//sets the viewport and the projection for a drawing area of the given size
+void projectScene(int width, int height);
+//clears the frame and places the skirt in front of the camera, turned by horizAngle degrees
+void placeSkirt(const Skirt &skirt, int horizAngle);
+
+#endif // SCENE_H
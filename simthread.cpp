@@ -0,0 +1,196 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: simthread.cpp - Implementation for the SimThread class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L //exposes nanosleep() under -ansi
+#endif
+
+#include "simthread.h"
+#ifdef _WIN32
+#include <windows.h> //used for Sleep()
+#else
+#include <time.h> //used for nanosleep()
+#endif
+
+//sleeps the calling thread for the given number of seconds
+static void sleepFor(double seconds);
+
+/* SimThread - CONSTRUCTOR
+ */
+SimThread::SimThread(Skirt &skirt, double stepSeconds, int maxSteps) :
+                     skirt(skirt), stepper(stepSeconds, maxSteps), explicitSeconds(stepSeconds),
+                     maxExplicitSteps(maxSteps), isRunning(false), isQuitting(0)
+{
+   for(int i = 0; i < 3; i++){
+      Snapshot &snapshot = snapshots.getBuffer(i);
+      skirt.allocFrame(snapshot.frame);
+      skirt.saveFrame(snapshot.frame);
+      snapshot.time = 0;
+      snapshot.stepSeconds = stepSeconds;
+   }
+   updateStepLength();
+}
+
+/* SimThread - DESTRUCTOR
+ */
+SimThread::~SimThread()
+{
+   stop();
+   for(int i = 0; i < 3; i++)
+      skirt.freeFrame(snapshots.getBuffer(i).frame);
+}
+
+/* starts the thread
+ */
+void SimThread::start()
+{
+   if(isRunning) return;
+   isQuitting = 0;
+   stepper.reset();
+   isRunning = !pthread_create(&thread, 0, threadMain, this);
+}
+
+/* stops and joins the thread. The Skirt may then be used directly again
+ */
+void SimThread::stop()
+{
+   if(!isRunning) return;
+   __sync_fetch_and_or(&isQuitting, 1);
+   pthread_join(thread, 0);
+   isRunning = false;
+}
+
+/* returns the latest frame published by the simulation thread, and in alpha how far between its
+ * two states real time has reached. Drawing a frame when its newer state was due shows its older
+ * state, so what is drawn runs one step behind real time but moves smoothly
+ */
+const SkirtFrame &SimThread::latestFrame(GLfloat &alpha)
+{
+   snapshots.acquire();
+   const Snapshot &snapshot = snapshots.getFront();
+   double fraction = (Timer::now() - snapshot.time)/snapshot.stepSeconds;
+   
+   alpha = (fraction < 0) ? 0 : (fraction > 1) ? 1 : fraction;
+   return snapshot.frame;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* entry point of the simulation thread. arg is the SimThread
+ */
+void *SimThread::threadMain(void *arg)
+{
+   static_cast<SimThread*>(arg)->run();
+   return 0;
+}
+
+/* steps the skirt in real time and publishes its frames until stopped. Whenever no step is due yet
+ * the thread sleeps until one is
+ */
+void SimThread::run()
+{
+   Command command;
+   
+   while(!__sync_fetch_and_add(&isQuitting, 0)){
+      while(commands.pop(command)) apply(command);
+      int steps = stepper.advance();
+      if(!steps){
+         sleepFor((1 - stepper.getAlpha())*stepper.getStepSeconds());
+         continue;
+      }
+      //the newest step was due as long ago as the time left in the bank
+      double due = Timer::now() - stepper.getAlpha()*stepper.getStepSeconds();
+      skirt.updateSkirt(steps);
+      publish(due);
+   }
+}
+
+/* applies a command to the skirt
+ */
+void SimThread::apply(Command command)
+{
+   switch(command){
+      case ROTATE_2D: skirt.rotate2D();
+         break;
+      case ROTATE_3D: skirt.rotate3D();
+         break;
+      case INC_AMPLITUDE: skirt.incAmplitude();
+         break;
+      case DEC_AMPLITUDE: skirt.decAmplitude();
+         break;
+      case INC_FREQUENCY: skirt.incFrequency();
+         break;
+      case DEC_FREQUENCY: skirt.decFrequency();
+         break;
+      case TOGGLE_IMPLICIT:
+         skirt.setIntegrator((skirt.getIntegrator() == Skirt::IMPLICIT) ? Skirt::EXPLICIT :
+                                                                          Skirt::IMPLICIT);
+         updateStepLength();
+         break;
+      case TOGGLE_XPBD:
+         skirt.setIntegrator((skirt.getIntegrator() == Skirt::XPBD) ? Skirt::EXPLICIT :
+                                                                      Skirt::XPBD);
+         updateStepLength();
+         break;
+      case DOUBLE_ITERATIONS: skirt.setConstraintIterations(2*skirt.getConstraintIterations());
+         break;
+      case HALVE_ITERATIONS: skirt.setConstraintIterations(skirt.getConstraintIterations()/2);
+         break;
+      case TOGGLE_BODY_COLLISIONS:
+         skirt.setCollisions(skirt.getCollisions() ^ Skirt::BODY_COLLISIONS);
+         break;
+      case TOGGLE_SELF_COLLISIONS:
+         skirt.setCollisions(skirt.getCollisions() ^ Skirt::SELF_COLLISIONS);
+         break;
+      case TOGGLE_AIR: skirt.setAerodynamic(!skirt.getIsAerodynamic());
+         break;
+   }
+}
+
+/* matches the fixed step to the explicit steps an update of the current integrator covers, so the
+ * skirt moves at the same speed under every integrator
+ */
+void SimThread::updateStepLength()
+{
+   stepper.setStepSeconds(skirt.getStepsPerUpdate()*explicitSeconds);
+   stepper.setMaxSteps(maxExplicitSteps/skirt.getStepsPerUpdate());
+}
+
+/* saves the skirt into the back snapshot and publishes it. Its newer state was due at the given
+ * time
+ */
+void SimThread::publish(double time)
+{
+   Snapshot &snapshot = snapshots.getBack();
+   
+   skirt.saveFrame(snapshot.frame);
+   snapshot.time = time;
+   snapshot.stepSeconds = stepper.getStepSeconds();
+   snapshots.publish();
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* sleeps the calling thread for the given number of seconds
+ */
+void sleepFor(double seconds)
+{
+#ifdef _WIN32
+   Sleep(DWORD(seconds*1000));
+#else
+   timespec ts;
+   ts.tv_sec = time_t(seconds);
+   ts.tv_nsec = long((seconds - ts.tv_sec)*1e9);
+   nanosleep(&ts, 0);
+#endif
+}
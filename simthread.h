@@ -0,0 +1,94 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: simthread.h - Interface for the SimThread class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SIMTHREAD_H
+#define SIMTHREAD_H
+
+#include "skirt.h"
+#include "fixedstep.h"
+#include "triplebuffer.h"
+#include "spscqueue.h"
+#include <pthread.h> //used for pthread_t
+
+/* Runs the simulation of a Skirt on a thread of its own, paced in real time by a FixedStep, so that
+ * a slow step does not hold up drawing and a slow frame does not hold up the simulation. After each
+ * batch of steps the thread publishes a SkirtFrame through a TripleBuffer, from which the drawing
+ * thread takes the latest. Changes to the motion come the other way as Commands through an
+ * SpscQueue. Once started, the Skirt belongs to the thread: the drawing thread may only call
+ * Skirt::draw() on frames from latestFrame(), and the accessors of constants such as getHeight()
+ */
+class SimThread
+{
+public:
+   //the changes to the simulation the drawing thread can ask for
+   enum Command { ROTATE_2D, ROTATE_3D, INC_AMPLITUDE, DEC_AMPLITUDE, INC_FREQUENCY, DEC_FREQUENCY,
+                  TOGGLE_IMPLICIT, TOGGLE_XPBD, DOUBLE_ITERATIONS, HALVE_ITERATIONS,
+                  TOGGLE_BODY_COLLISIONS, TOGGLE_SELF_COLLISIONS, TOGGLE_AIR };
+   
+   //constructor. Paces the skirt at stepSeconds per explicit step, running at most maxSteps
+   //explicit steps between two frames. The thread does not start until start()
+   SimThread(Skirt &skirt, double stepSeconds, int maxSteps);
+   //destructor. Stops and joins the thread
+   ~SimThread();
+   //starts the thread
+   void start();
+   //stops and joins the thread. The Skirt may then be used directly again
+   void stop();
+   
+//::DRAWING THREAD:://
+   //queues a command for the simulation thread. Returns false if the queue is full
+   bool post(Command command) { return commands.push(command); }
+   //returns the latest frame published by the simulation thread, and in alpha how far between its
+   //two states real time has reached
+   const SkirtFrame &latestFrame(GLfloat &alpha);
+   
+private:
+//::STRUCTS:://
+   //a published frame, the time its newer state was due and the length of the step it ends
+   struct Snapshot { SkirtFrame frame; double time, stepSeconds; };
+   
+//::CONSTANTS:://
+   //the most commands that can wait for the simulation thread
+   enum { QUEUE_SIZE = 64 };
+   
+//::VARIABLES:://
+   Skirt &skirt;
+   FixedStep stepper;
+   double explicitSeconds;
+   int maxExplicitSteps;
+   TripleBuffer<Snapshot> snapshots;
+   SpscQueue<Command, QUEUE_SIZE> commands;
+   pthread_t thread;
+   bool isRunning;
+   //set by stop() and read by the simulation thread, atomically
+   volatile int isQuitting;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //entry point of the simulation thread. arg is the SimThread
+   static void *threadMain(void *arg);
+   //steps the skirt in real time and publishes its frames until stopped
+   void run();
+   //applies a command to the skirt
+   void apply(Command command);
+   //matches the fixed step to the explicit steps an update of the current integrator covers
+   void updateStepLength();
+   //saves the skirt into the back snapshot and publishes it. Its newer state was due at the given
+   //time
+   void publish(double time);
+   
+   //not copyable
+   SimThread(const SimThread &);
+   SimThread& operator=(const SimThread &);
+};
+
+#endif // SIMTHREAD_H
@@ -13,179 +13,428 @@
 
 #include "skirt.h"
 #include "quaternion.h"
-#include <cstdlib> //used for exit() and EXIT_FAILURE
-#include <cstdio> //used for fclose(), fopen(), printf(), fscanf(), sscanf(), fgetc(), fread(), FILE
+#include "aligned.h"
+#include "blockmatrix.h"
+#include "spatialhash.h"
+#include "profiler.h"
 #include <cmath> //used for pow(), sqrt(), sin(), cos()
 #include <limits> //used for numeric_limits<float>::infinity()
-#include <cstring> //used for strncmp()
-#include <GL/glu.h> //used for gluBuild2DMipmaps()
+#include <cstring> //used for memset(), memcpy()
+#include <algorithm> //used for min()
 
 using namespace std;
 
+//returns the stiffness along one axis of a pretensioned diagonal, per unit of its stiffness
+static double diagonalStiffness(double along, double across);
+//returns the pull along one axis of a pretensioned diagonal at rest, per unit of its stiffness
+static double diagonalPull(double along, double across);
+
 //::CONSTANTS:://
-const int   Skirt::X_RES = 120, Skirt::Y_RES = 18;
+const int   Skirt::DEFAULT_X_RES = 120, Skirt::DEFAULT_Y_RES = 18,
+            Skirt::DEFAULT_IMPLICIT_STEP = 10, Skirt::DEFAULT_CONSTRAINT_ITERATIONS = 3,
+            Skirt::CG_MAX_ITERATIONS = 100, Skirt::MAX_SETTLE_STEPS = 100000,
+            Skirt::SETTLE_CHECK_STEPS = 100;
 const float Skirt::GRAVITY = 0.015*(-9.8), Skirt::Ks = 1.5, Skirt::KsDiag = 0.7, Skirt::Kd = 0.01,
             Skirt::Hp = 0.15, Skirt::Hv = 0.1,
             Skirt::AMP_MIN = 0, Skirt::AMP_MAX = 30, Skirt::AMP_INC = 2,
-            Skirt::FREQ_MIN = 0, Skirt::FREQ_MAX = 0.1, Skirt::FREQ_INC = 0.02;
+            Skirt::FREQ_MIN = 0, Skirt::FREQ_MAX = 0.1, Skirt::FREQ_INC = 0.02,
+            Skirt::CG_TOLERANCE = 1e-4, Skirt::SETTLE_TOLERANCE = 1e-3,
+            Skirt::AIR_DRAG = 20, Skirt::AIR_LIFT = 10;
+const Skirt::Vector Skirt::DEFAULT_WIND = { 0.3, 0, 0 };
 
 /* Skirt - CONSTRUCTOR
  */
-Skirt::Skirt() 
-{
-   initialPos = new Vertex[X_RES];
-   position = new Vertex*[X_RES];
-   velocity = new Vector*[X_RES];
-   vertexNormals = new Vector*[X_RES];
-   for(int i = 0; i < X_RES; i++){
-      position[i] = new Vertex[Y_RES];
-      velocity[i] = new Vector[Y_RES];
-      vertexNormals[i] = new Vector[Y_RES];
-      for(int j = 0; j < Y_RES; j++){
-         velocity[i][j].x = velocity[i][j].y = velocity[i][j].z = 0;
-         vertexNormals[i][j].x = vertexNormals[i][j].y = vertexNormals[i][j].z = 0;
-      }
-   }
+Skirt::Skirt(int xRes, int yRes) : xRes(xRes), yRes(yRes), stride(alignedCount(xRes)),
+                                   springJob(*this, &Skirt::calcSpringForces),
+                                   velocityJob(*this, &Skirt::updateVelocityRows),
+                                   positionJob(*this, &Skirt::updatePositionRows),
+                                   normJob(*this, &Skirt::calcNormRows),
+                                   normAirJob(*this, &Skirt::calcNormAirRows),
+                                   predictJob(*this, &Skirt::predictPositionRows),
+                                   constraintJob(*this, &Skirt::projectConstraintRows),
+                                   deriveJob(*this, &Skirt::deriveVelocityRows),
+                                   bodyJob(*this, &Skirt::collideBodyRows),
+                                   contactJob(*this, &Skirt::findContactRows),
+                                   separationJob(*this, &Skirt::separateRows)
+{
+   pool = new ThreadPool(1);
+   //generateVertices() calculates the first normals
+   kernels = &bestKernels();
+   initialPos.x = new GLfloat[xRes];
+   initialPos.y = new GLfloat[xRes];
+   initialPos.z = new GLfloat[xRes];
+   allocArray(position);
+   allocArray(velocity);
+   allocArray(vertexNormals);
+   allocArray(force);
+   allocArray(forceBelow);
+   allocArray(lastPosition);
+   allocArray(lastNormals);
    generateVertices();
+   generateSprings();
+   copyArray(lastPosition, position);
+   copyArray(lastNormals, vertexNormals);
    
    amplitude = AMP_MIN;
    frequency = FREQ_MIN;
    theta = 0;
    is3DRotation = true;
+   integrator = EXPLICIT;
+   implicitStep = DEFAULT_IMPLICIT_STEP;
+   solverIterations = 0;
+   system = 0;
+   residual.x = residual.y = residual.z = 0;
+   direction.x = direction.y = direction.z = 0;
+   preconditioned.x = preconditioned.y = preconditioned.z = 0;
+   product.x = product.y = product.z = 0;
+   sweepParity = 0;
+   constraintIterations = DEFAULT_CONSTRAINT_ITERATIONS;
+   previous.x = previous.y = previous.z = 0;
+   lambda = 0;
+   collisions = NO_COLLISIONS;
+   for(int c = 0; c < BODY_CAPSULES; c++) body[c] = lastBody[c] = REST_BODY[c];
+   isBodyPlaced = false;
+   selfHash = 0;
+   freeVertices = rowOf = 0;
+   isAerodynamic = false;
+   wind = DEFAULT_WIND;
 }
 
 /* Skirt - DESTRUCTOR
  */
 Skirt::~Skirt()
 {
-   for(int i = 0; i < X_RES; i++){
-      delete position[i];
-      delete velocity[i];
-      delete vertexNormals[i];
-   }
-   delete initialPos;
-   delete position;
-   delete velocity;
-   delete vertexNormals;
-}
-
-/* draws the skirt mesh using triangle strips after calling subroutines to update the skirt state.
- */
-void Skirt::draw()
-{
-   updateSkirt();
-   for(int j = 0; j < Y_RES-1; j++){
-      glBegin(GL_TRIANGLE_STRIP);
-      glTexCoord2f(0, GLfloat(j)/Y_RES);
-      glVertex3f(position[0][j].x, position[0][j].y, position[0][j].z);
-      glTexCoord2f(0, GLfloat(j+1)/Y_RES);
-      glVertex3f(position[0][j+1].x, position[0][j+1].y, position[0][j+1].z);
-      for(int i = 1; i < X_RES; i++){
-         glNormal3f(vertexNormals[i][j].x, vertexNormals[i][j].y, vertexNormals[i][j].z);
-         glTexCoord2f(GLfloat(i)/(X_RES+10), GLfloat(j)/Y_RES);
-         glVertex3f(position[i][j].x, position[i][j].y, position[i][j].z);
-         glNormal3f(vertexNormals[i][j+1].x, vertexNormals[i][j+1].y, vertexNormals[i][j+1].z);
-         glTexCoord2f(GLfloat(i)/(X_RES+10), GLfloat(j+1)/Y_RES);
-         glVertex3f(position[i][j+1].x, position[i][j+1].y, position[i][j+1].z);
+   delete [] initialPos.x;
+   delete [] initialPos.y;
+   delete [] initialPos.z;
+   freeArray(position);
+   freeArray(velocity);
+   freeArray(vertexNormals);
+   freeArray(force);
+   freeArray(forceBelow);
+   freeArray(lastPosition);
+   freeArray(lastNormals);
+   delete [] springs.a;
+   delete [] springs.b;
+   delete [] springs.rowStart;
+   delete [] springs.crossStart;
+   alignedFree(springs.rest);
+   alignedFree(springs.ksA);
+   alignedFree(springs.ksB);
+   delete pool;
+   delete system;
+   freeArray(residual);
+   freeArray(direction);
+   freeArray(preconditioned);
+   freeArray(product);
+   freeArray(previous);
+   alignedFree(lambda);
+   delete selfHash;
+   delete [] freeVertices;
+   delete [] rowOf;
+}
+
+/* calls subroutines for recalculating the vertex positions, velocities, and normals. This advances
+ * the simulation by one step without rendering. The step and its phases are timed as laps
+ */
+void Skirt::updateSkirt()
+{
+   PROFILE_LAPS(STEP);
+   
+   if(integrator == XPBD) updateXPBD();
+   else{
+      if(integrator == IMPLICIT) updateVelocityImplicit();
+      else updateVelocity();
+      updatePosition();
+      PROFILE_LAP(POSITION);
+      if(collisions){
+         collide();
+         PROFILE_LAP(COLLISIONS);
       }
-      glNormal3f(vertexNormals[0][j].x, vertexNormals[0][j].y, vertexNormals[0][j].z);
-      glVertex3f(position[0][j].x, position[0][j].y, position[0][j].z);
-      glNormal3f(vertexNormals[0][j+1].x, vertexNormals[0][j+1].y, vertexNormals[0][j+1].z);
-      glVertex3f(position[0][j+1].x, position[0][j+1].y, position[0][j+1].z);
-      glEnd();
    }
+   if(isAerodynamic) calcNormsAir();
+   else calcNorms();
+   PROFILE_LAP(NORMALS);
 }
 
-/* loads a texture for the skirt. The texture image must be a P6 RAW ppm.
+/* calls updateSkirt() the given number of times, keeping the state before the last call for
+ * saveFrame(). Only the last call needs it, so the state is copied at most once
  */
-void Skirt::loadTexture() const
+void Skirt::updateSkirt(int updates)
 {
-   GLuint texture;
-   int i = 0, texWidth, texHeight, junk;
-   char header[70];
-   unsigned char *image;
-   FILE *in = fopen("assets/skirt_texture.ppm", "rb");
-   if(!in){
-      printf("Unable to open texture for reading\n");
-      exit(EXIT_FAILURE);
+   for(int u = 0; u < updates; u++){
+      if(u == updates-1){
+         copyArray(lastPosition, position);
+         copyArray(lastNormals, vertexNormals);
+      }
+      updateSkirt();
    }
-   //read in header data
-   fscanf(in, "%s", header);
-   if(strncmp(header, "P6", 2)){
-      printf("Incompatible image format. Please load a P6 (RAW) PPM.");
-      exit(EXIT_FAILURE);
+}
+
+/* allocates the buffers of a frame of this skirt's resolution
+ */
+void Skirt::allocFrame(SkirtFrame &frame) const
+{
+   allocArray(frame.position);
+   allocArray(frame.normals);
+   allocArray(frame.lastPosition);
+   allocArray(frame.lastNormals);
+}
+
+/* frees the buffers of a frame allocated by allocFrame()
+ */
+void Skirt::freeFrame(SkirtFrame &frame) const
+{
+   freeArray(frame.position);
+   freeArray(frame.normals);
+   freeArray(frame.lastPosition);
+   freeArray(frame.lastNormals);
+}
+
+/* copies the state after and before the last updateSkirt(int) into a frame for draw()
+ */
+void Skirt::saveFrame(SkirtFrame &frame) const
+{
+   copyArray(frame.position, position);
+   copyArray(frame.normals, vertexNormals);
+   copyArray(frame.lastPosition, lastPosition);
+   copyArray(frame.lastNormals, lastNormals);
+}
+
+/* calculates the unit normals of positions laid out as this skirt's, as the simulation does. Runs
+ * on the calling thread rather than the solver's, which may be busy with the simulation
+ */
+void Skirt::calcNormals(const VectorArray &positions, VectorArray &normals) const
+{
+   calcNormRows(positions, normals, 0, yRes);
+}
+
+/* sets the number of threads the solver splits its rows across. Every force and normal buffer entry
+ * is written by exactly one row, in the same order however the rows are split, so the results are
+ * bit-identical for any thread count
+ */
+void Skirt::setThreadCount(int threads)
+{
+   delete pool;
+   pool = new ThreadPool(threads);
+}
+
+/* selects the time integration scheme. The buffers of the implicit and XPBD steps are allocated
+ * the first time their scheme is selected and kept from then on. The amplitude is clamped again,
+ * as the body only raises its limit under IMPLICIT and XPBD
+ */
+void Skirt::setIntegrator(Integrator mode)
+{
+   integrator = mode;
+   if(integrator == IMPLICIT && !system){
+      //only springs between two free vertices have off-diagonal blocks; those of row 1 are pinned
+      //at one end
+      int firstFree = springs.rowStart[2];
+      system = new BlockMatrix(at(0,2), at(0,yRes), springs.count - firstFree,
+                               springs.a + firstFree, springs.b + firstFree);
+      allocArray(residual);
+      allocArray(direction);
+      allocArray(preconditioned);
+      allocArray(product);
    }
-   while(i < 3){
-      fscanf(in, "%s", header);
-      if(header[0] != '#'){
-         if(i == 0)       i += sscanf(header, "%i %i %i", &texWidth, &texHeight, &junk);
-         else if (i == 1) i += sscanf(header, "%i %i", &texHeight, &junk);
-         else if (i == 2) i += sscanf(header, "%i", &junk);
-      }
+   if(integrator == XPBD && !lambda){
+      allocArray(previous);
+      lambda = alignedAllocFloats(springs.count);
    }
+   setAmplitude(amplitude);
+}
+
+/* sets the amplitude of the motion, clamped to the range allowed by the arrow keys
+ */
+void Skirt::setAmplitude(GLfloat amp)
+{
+   GLfloat max = getMaxAmplitude();
    
-   fgetc(in);
-   //read in pixel data
-   image = new unsigned char[texWidth*texHeight*3];
-   fread(image, sizeof(unsigned char), texWidth*texHeight*3, in);
-   fclose(in);
-   
-   //initialize texturing using image pixel data
-   glGenTextures(1, &texture);
-   glBindTexture(GL_TEXTURE_2D, texture);
-   //using modulate to mix texture with color for shading
-   glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-   gluBuild2DMipmaps(GL_TEXTURE_2D, 3, texWidth,  texHeight, GL_RGB, GL_UNSIGNED_BYTE, image);
-   
-   delete image;
+   amplitude = (amp < AMP_MIN) ? AMP_MIN : (amp > max) ? max : amp;
+}
+
+/* sets the velocity of the wind the air moves at, in the units of the vertex velocities
+ */
+void Skirt::setWind(GLfloat x, GLfloat y, GLfloat z)
+{
+   wind.x = x;
+   wind.y = y;
+   wind.z = z;
+}
+
+/* sets the frequency of the motion, clamped to the range allowed by the arrow keys
+ */
+void Skirt::setFrequency(GLfloat freq)
+{
+   frequency = (freq < FREQ_MIN) ? FREQ_MIN : (freq > FREQ_MAX) ? FREQ_MAX : freq;
 }
 
 //::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
 
+/* allocates the zeroed component buffers of a VectorArray
+ */
+void Skirt::allocArray(VectorArray &array) const
+{
+   array.x = alignedAllocFloats(yRes*stride);
+   array.y = alignedAllocFloats(yRes*stride);
+   array.z = alignedAllocFloats(yRes*stride);
+}
+
+/* frees the component buffers of a VectorArray
+ */
+void Skirt::freeArray(VectorArray &array) const
+{
+   alignedFree(array.x);
+   alignedFree(array.y);
+   alignedFree(array.z);
+}
+
+/* copies the component buffers of one VectorArray into another
+ */
+void Skirt::copyArray(VectorArray &to, const VectorArray &from) const
+{
+   memcpy(to.x, from.x, yRes*stride*sizeof(GLfloat));
+   memcpy(to.y, from.y, yRes*stride*sizeof(GLfloat));
+   memcpy(to.z, from.z, yRes*stride*sizeof(GLfloat));
+}
+
 /* generates the initial state/position of the skirt vertices 
  */
 void Skirt::generateVertices()
 {
    const GLfloat girth = 0.6;
+   //the stock skirt is DEFAULT_Y_RES rows of chords of the stock waist tall, and its cloth spans
+   //the DEFAULT_Y_RES-2 rows between the pinned row 1 and the hem. Other resolutions keep that
+   //size, so a row spans rowScale stock rows, and row 1 hangs waistDrop below the waist
+   const GLfloat stockLength = 2*sin(Quaternion::TO_RADIANS*(360.0/DEFAULT_X_RES)/2);
+   const double rowScale = double(DEFAULT_Y_RES-2)/(yRes-2);
    
-   restLength = 2*sin(Quaternion::TO_RADIANS*(360.0/X_RES)/2); //secant or chord length
-   height = Y_RES*restLength;
-   for(int j = 0; j < Y_RES; j++){
-      for(int i = 0; i < X_RES; i++){
-         position[i][j].x = (0.1*j+1)*cos(i*Quaternion::TO_RADIANS*(360.0/X_RES))*girth;
-         position[i][j].z = (0.1*j+1)*sin(i*Quaternion::TO_RADIANS*(360.0/X_RES));
-         position[i][j].y = -1*(j+10)*restLength;
+   restLength = 2*sin(Quaternion::TO_RADIANS*(360.0/xRes)/2); //secant or chord length
+   rowSpacing = stockLength*rowScale;
+   height = DEFAULT_Y_RES*stockLength;
+   waistDrop = 5*stockLength;
+   weighSprings();
+   //each vertex carries its share of the weight of a column; this keeps the stretch of the skirt
+   //under gravity the same at any number of rows
+   gravity = GRAVITY*rowScale*rowScale*forceScale;
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         position.x[at(i,j)] = (0.1*j*rowScale+1)*cos(i*Quaternion::TO_RADIANS*(360.0/xRes))*girth;
+         position.z[at(i,j)] = (0.1*j*rowScale+1)*sin(i*Quaternion::TO_RADIANS*(360.0/xRes));
+         position.y[at(i,j)] = -1*(j*rowScale+10)*stockLength;
       }
    }
-   for(int i = 0; i < X_RES; i++){
-      initialPos[i].x = position[i][0].x;
-      initialPos[i].y = position[i][0].y;
-      initialPos[i].z = position[i][0].z;
+   for(int i = 0; i < xRes; i++){
+      initialPos.x[i] = position.x[at(i,0)];
+      initialPos.y[i] = position.y[at(i,0)];
+      initialPos.z[i] = position.z[at(i,0)];
    }
    calcNorms();
 }
 
-/* calls subroutines for recalculating the vertex positions, velocities, and normals 
+/* sets the rest lengths and stiffness weights of the springs across, down and along the diagonals
+ * of a cell, and the scale of all forces, for the aspect a = rowSpacing/restLength of the cells.
+ * The stock cells are square and every weight there is 1. Like a membrane, a mesh of other cells
+ * keeps the stock stiffness per vertex down the skirt and a^2 times it around it. The diagonals
+ * carry as much of that as they can without the down or across springs going below their stock
+ * weight, and those springs are pretensioned for the share of the pull of the stock diagonals
+ * that the diagonals no longer make. Past a = 1 every force is scaled by 1/a^2, which keeps the
+ * explicit step stable and leaves the rest shape as it is
  */
-void Skirt::updateSkirt()
+void Skirt::weighSprings()
 {
-   updateVelocity();
-   updatePosition();
-   calcNorms();
+   const double a = double(rowSpacing)/restLength;
+   const double stock = diagonalStiffness(1, 1), stockPull = diagonalPull(1, 1);
+   
+   diagWeight = min(a*a*stock/diagonalStiffness(1, a), stock/diagonalStiffness(a, 1));
+   downWeight = 1 + (stock - diagWeight*diagonalStiffness(a, 1));
+   acrossWeight = a*a + (a*a*stock - diagWeight*diagonalStiffness(1, a));
+   downLength = rowSpacing*(1 - (stockPull - diagWeight*diagonalPull(a, 1)/a)/downWeight);
+   acrossLength = restLength*(1 - (a*a*stockPull - diagWeight*diagonalPull(1, a))/acrossWeight);
+   //the diagonals span one chord across and one row down
+   diagLength = sqrt(0.5f*(restLength*restLength + rowSpacing*rowSpacing));
+   forceScale = (a > 1) ? 1/(a*a) : 1;
+}
+
+/* builds the spring topology: the horizontal, vertical and diagonal edges of the mesh. Springs are
+ * grouped by the row of their first endpoint and, within a row, by direction, so each group walks
+ * the buffers linearly
+ */
+void Skirt::generateSprings()
+{
+   int maxSprings = 3*xRes*yRes;
+   
+   springs.count = 0;
+   springs.a = new int[maxSprings];
+   springs.b = new int[maxSprings];
+   springs.rest = alignedAllocFloats(maxSprings);
+   springs.ksA = alignedAllocFloats(maxSprings);
+   springs.ksB = alignedAllocFloats(maxSprings);
+   springs.rowStart = new int[yRes+1];
+   springs.crossStart = new int[yRes];
+   springs.rowStart[0] = springs.crossStart[0] = 0;
+   for(int j = 1; j < yRes; j++){
+      springs.rowStart[j] = springs.count;
+      //left-right neighbours; both endpoints of a row 1 spring are pinned, so row 1 has none
+      if(j >= 2)
+         for(int i = 0; i < xRes; i++) addSpring(i,j, rightOf(i),j, acrossLength, acrossWeight);
+      springs.crossStart[j] = springs.count;
+      if(j < yRes-1){
+         //above-below neighbours
+         for(int i = 0; i < xRes; i++) addSpring(i,j, i,j+1, downLength, downWeight);
+         //top-left to bottom-right diagonals
+         for(int i = 0; i < xRes; i++) addSpring(i,j, rightOf(i),j+1, diagLength, diagWeight);
+      }
+   }
+   springs.rowStart[yRes] = springs.count;
+}
+
+/* adds one spring of the given rest length between vertex (col1,row1) and vertex (col2,row2) to the
+ * spring topology. Each endpoint feels the stiffness of its own row, times the weight of the
+ * spring's direction
+ */
+void Skirt::addSpring(int col1, int row1, int col2, int row2, GLfloat rest, GLfloat weight)
+{
+   int s = springs.count++;
+   springs.a[s] = at(col1,row1);
+   springs.b[s] = at(col2,row2);
+   springs.rest[s] = rest;
+   springs.ksA[s] = weight*rowStiffness(row1);
+   springs.ksB[s] = weight*rowStiffness(row2);
+}
+
+/* returns the stiffness of the springs at a vertex in the given row, before the weight of their
+ * direction. The springs are stiffer toward the top of the skirt; the profile is stretched over
+ * the rows so it spans the same height at any resolution. The top two rows are moved by
+ * calcOscillatoryAcc(), not by springs
+ */
+GLfloat Skirt::rowStiffness(int row) const
+{
+   return (row < 2) ? 0 : forceScale*(Ks + 2*(DEFAULT_Y_RES - stockRow(row)));
+}
+
+/* returns the spring damping of the vertices in the given row. Like the stiffness, the damping is
+ * higher toward the top of the skirt
+ */
+GLfloat Skirt::rowDamping(int row) const
+{
+   return Kd + 0.005*(DEFAULT_Y_RES - stockRow(row));
+}
+
+/* returns the row of the stock skirt at the same point of the cloth as the given row, counting
+ * from the pinned row 1
+ */
+double Skirt::stockRow(int row) const
+{
+   return 1 + (row - 1)*(double(DEFAULT_Y_RES-2)/(yRes-2));
 }
 
 /* updates the vertex positions via Euler integration of the vertex velocities
  */
 void Skirt::updatePosition()
 {
-   for(int j = 1; j < Y_RES; j++)
-      for(int i = 0; i < X_RES; i++){
-         position[i][j].x += Hp*velocity[i][j].x;
-         position[i][j].y += Hp*velocity[i][j].y;
-         position[i][j].z += Hp*velocity[i][j].z;
-      }
+   //rows 0 and 1 are placed by calcOscillatoryAcc() and never have a velocity
+   pool->parallelFor(positionJob, 2, yRes);
 }
 
 /* updates the vertex velocities via Euler integration using the spring forces, gravity, and
@@ -193,295 +442,216 @@ void Skirt::updatePosition()
  */
 void Skirt::updateVelocity()
 {
-   float FsBelow, FsAbove, FsLeft, FsRight, FsDiagAbove, FsDiagBelow, ks, kd;
-   
    //Velocity Update: Oscillation
-   calcOscillatoryAcc();
-   for(int j = 2; j < Y_RES; j++){
-      ks = Ks + 2*(Y_RES - j);
-      kd = Kd + 0.005*(Y_RES - j);
-      for(int i = 0; i < X_RES; i++){
-         FsBelow = (j == Y_RES-1) ? 0 : ks*(currentLength(i,j, i,j+1) - restLength);
-         FsAbove = ks*(currentLength(i,j, i,j-1) - restLength);
-         FsLeft = (i == 0) ? ks*(currentLength(i,j, X_RES-1,j) - restLength) :
-                                  ks*(currentLength(i,j, i-1,j) - restLength);
-         FsRight = (i == X_RES-1) ? ks*(currentLength(i,j, 0,j) - restLength) :
-                                  ks*(currentLength(i,j, i+1,j) - restLength);
-         FsDiagBelow = (j == Y_RES-1) ? 0 :
-                       (i == X_RES-1) ? ks*(currentLength(i,j, 0,j+1) - restLength) :
-                                  ks*(currentLength(i,j, i+1,j+1) - restLength);
-         FsDiagAbove = (i == 0) ? ks*(currentLength(i,j, X_RES-1,j-1) - restLength) :
-                                  ks*(currentLength(i,j, i-1,j-1) - restLength);
-         //Velocity Update: Spring Forces
-         velocity[i][j].x += 
-            Hv*springX(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
-         velocity[i][j].y += 
-            Hv*springY(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
-         velocity[i][j].z += 
-            Hv*springZ(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
-         //Velocity Update: Gravity
-         velocity[i][j].y += Hv*GRAVITY;
-         //Velocity Update: Spring Damping
-         velocity[i][j].x -= kd*velocity[i][j].x;
-         velocity[i][j].y -= kd*velocity[i][j].y;
-         velocity[i][j].z -= kd*velocity[i][j].z;
-      }
-   }
+   calcOscillatoryAcc(1);
+   PROFILE_LAP(DRIVE);
+   pool->parallelFor(springJob, 1, yRes);
+   PROFILE_LAP(SPRINGS);
+   //Velocity Update: Spring Forces, Gravity and Spring Damping
+   pool->parallelFor(velocityJob, 2, yRes);
+   PROFILE_LAP(VELOCITY);
 }
 
-/* calculates the oscillatory acceleration applied to the top row of free-motion vertices
+/* calculates the oscillatory acceleration applied to the top row of free-motion vertices over the
+ * given number of explicit steps. The pinned rows are placed by rotating the rest waist by the
+ * matrix of the drive, built once per step
  */
-void Skirt::calcOscillatoryAcc()
+void Skirt::calcOscillatoryAcc(int steps)
 {
-   int minVertex, maxVertex;
+   const GLfloat hv = Hv*steps;
+   int minVertex = 0, maxVertex = 0;
    float yMin = numeric_limits<float>::infinity(), yMax = -yMin;
    bool isOscillating = false;
    
-   theta += frequency;
+   theta += steps*frequency;
    Quaternion xrot(amplitude*cos(-theta), 1, 0, 0);
    Quaternion zrot(amplitude*sin(-theta), 0, 0, 1);
-   for(int i = 0; i < X_RES; i++){
-      Quaternion p(initialPos[i].x, initialPos[i].y, initialPos[i].z), rot(xrot*p*xrot.inverse());
-      if(is3DRotation) rot = zrot*rot*zrot.inverse();
-      if(!isOscillating && ((position[i][0].x - rot.getX() != 0) ||
-         (position[i][0].y - rot.getY() != 0) || (position[i][0].z - rot.getZ() != 0)))
+   float drive[9];
+   //the rotation about x, then in 3D the one about z, as a single matrix
+   (is3DRotation ? zrot*xrot : xrot).toMatrix(drive);
+   if(collisions & BODY_COLLISIONS) placeBody(drive);
+   //the waist is rotated into row 1 and compared with row 0 before replacing it
+   Quaternion::rotatePoints(drive, initialPos.x, initialPos.y, initialPos.z, position.x + at(0,1),
+                            position.y + at(0,1), position.z + at(0,1), xRes);
+   for(int i = 0; i < xRes; i++){
+      if(!isOscillating && ((position.x[at(i,0)] - position.x[at(i,1)] != 0) ||
+         (position.y[at(i,0)] - position.y[at(i,1)] != 0) ||
+         (position.z[at(i,0)] - position.z[at(i,1)] != 0)))
          isOscillating = true;
          
-      position[i][0].x = position[i][1].x = rot.getX();
-      position[i][0].y = position[i][1].y = rot.getY();
-      position[i][0].z = position[i][1].z = rot.getZ();
-      position[i][1].y -= 5*restLength;
+      position.x[at(i,0)] = position.x[at(i,1)];
+      position.y[at(i,0)] = position.y[at(i,1)];
+      position.z[at(i,0)] = position.z[at(i,1)];
+      position.y[at(i,1)] -= waistDrop;
       
-      if(yMin > position[i][0].y){
-         yMin = position[i][0].y;
+      if(yMin > position.y[at(i,0)]){
+         yMin = position.y[at(i,0)];
          minVertex = i;
       }
-      if(yMax < position[i][0].y){
-         yMax = position[i][0].y;
+      if(yMax < position.y[at(i,0)]){
+         yMax = position.y[at(i,0)];
          maxVertex = i;
       }
    }
    
    if(isOscillating){
-      float mag = sqrt(pow(position[maxVertex][0].x - position[minVertex][0].x,2) +
-                       pow(position[maxVertex][0].y - position[minVertex][0].y,2) +
-                       pow(position[maxVertex][0].z - position[minVertex][0].z,2));
+      int maxV = at(maxVertex,0), minV = at(minVertex,0);
+      float mag = sqrt(pow(position.x[maxV] - position.x[minV],2) +
+                       pow(position.y[maxV] - position.y[minV],2) +
+                       pow(position.z[maxV] - position.z[minV],2));
       if(mag != 0){
          Vector angularForce;
-         angularForce.x = (position[maxVertex][0].x - position[minVertex][0].x)/(10*mag);
-         angularForce.y = (position[maxVertex][0].y - position[minVertex][0].y)/(10*mag);
-         angularForce.z = (position[maxVertex][0].z - position[minVertex][0].z)/(10*mag);
+         angularForce.x = (position.x[maxV] - position.x[minV])/(10*mag);
+         angularForce.y = (position.y[maxV] - position.y[minV])/(10*mag);
+         angularForce.z = (position.z[maxV] - position.z[minV])/(10*mag);
          //applies the oscillatory acceleration to the top row of free-motion vertices
-         for(int i = 0; i < X_RES; i++){
-            velocity[i][2].x += Hv*angularForce.x;
-            velocity[i][2].y += Hv*angularForce.y;
-            velocity[i][2].z += Hv*angularForce.z;
+         for(int i = 0; i < xRes; i++){
+            velocity.x[at(i,2)] += hv*angularForce.x;
+            velocity.y[at(i,2)] += hv*angularForce.y;
+            velocity.z[at(i,2)] += hv*angularForce.z;
          }
       }
    }
 }
 
-/* determines the x components of the spring forces
- */
-GLfloat Skirt::springX(int c, int r,
-                       float Fs1, float Fs2, float Fs3, float Fs4, float Fs5, float Fs6) const
-{
-   int forceDir = (r == Y_RES-1) ? 0 : (position[c][r].x - position[c][r+1].x < 0) ? 1 : -1;
-   float Fs1_x, Fs2_x, Fs3_x, Fs4_x, Fs5_x, Fs6_x; //the % of the force in x
-                     
-   Fs1_x = (r == Y_RES-1) ? 0 : forceDir*Fx(c,r, c,r+1);
-   forceDir = (position[c][r].x - position[c][r-1].x < 0) ? 1 : -1;
-   Fs2_x = forceDir*Fx(c,r, c,r-1);
-   forceDir = (c == 0) ? ((position[c][r].x - position[X_RES-1][r].x < 0) ? 1 : -1) :
-                         ((position[c][r].x - position[c-1][r].x < 0) ? 1 : -1);
-   Fs3_x = (c == 0) ? forceDir*Fx(c,r, X_RES-1,r) : forceDir*Fx(c,r, c-1,r);
-   forceDir = (c == X_RES-1) ? ((position[c][r].x - position[0][r].x < 0) ? 1 : -1) :
-                         ((position[c][r].x - position[c+1][r].x < 0) ? 1 : -1);
-   Fs4_x = (c == X_RES-1) ? forceDir*Fx(c,r, 0,r) : forceDir*Fx(c,r, c+1,r);
-   forceDir = (r == Y_RES-1) ? 0 : (c == X_RES-1) ? 
-                         ((position[c][r].x - position[0][r+1].x < 0) ? 1 : -1) :
-                         ((position[c][r].x - position[c+1][r+1].x < 0) ? 1 : -1);
-   Fs5_x = (r == Y_RES-1) ? 0 : (c == X_RES-1) ?
-                         forceDir*Fx(c,r, 0,r+1) : forceDir*Fx(c,r, c+1,r+1);
-   forceDir = (c == 0) ? ((position[c][r].x - position[X_RES-1][r-1].x < 0) ? 1 : -1) :
-                         ((position[c][r].x - position[c-1][r-1].x < 0) ? 1 : -1);
-   Fs6_x = (c == 0) ? forceDir*Fx(c,r, X_RES-1,r-1) : forceDir*Fx(c,r, c-1,r-1);
-   
-   return Fs1_x*Fs1 + Fs2_x*Fs2 + Fs3_x*Fs3 + Fs4_x*Fs4 + Fs5_x*Fs5 + Fs6_x*Fs6;
-}
-
-/* determines the y components of the spring forces
- */
-GLfloat Skirt::springY(int c, int r,
-                       float Fs1, float Fs2, float Fs3, float Fs4, float Fs5, float Fs6) const
-{
-   int forceDir = (r == Y_RES-1) ? 0 : (position[c][r].y - position[c][r+1].y < 0) ? 1 : -1;
-   float Fs1_y, Fs2_y, Fs3_y, Fs4_y, Fs5_y, Fs6_y; //the % of the force in y
-                     
-   Fs1_y = (r == Y_RES-1) ? 0 : forceDir*Fy(c,r, c,r+1);
-   forceDir = (position[c][r].y - position[c][r-1].y < 0) ? 1 : -1;
-   Fs2_y = forceDir*Fy(c,r, c,r-1);
-   forceDir = (c == 0) ? ((position[c][r].y - position[X_RES-1][r].y < 0) ? 1 : -1) :
-                         ((position[c][r].y - position[c-1][r].y < 0) ? 1 : -1);
-   Fs3_y = (c == 0) ? forceDir*Fy(c,r, X_RES-1,r) : forceDir*Fy(c,r, c-1,r);
-   forceDir = (c == X_RES-1) ? ((position[c][r].y - position[0][r].y < 0) ? 1 : -1) :
-                         ((position[c][r].y - position[c+1][r].y < 0) ? 1 : -1);
-   Fs4_y = (c == X_RES-1) ? forceDir*Fy(c,r, 0,r) : forceDir*Fy(c,r, c+1,r);
-   forceDir = (r == Y_RES-1) ? 0 : (c == X_RES-1) ? 
-                         ((position[c][r].y - position[0][r+1].y < 0) ? 1 : -1) :
-                         ((position[c][r].y - position[c+1][r+1].y < 0) ? 1 : -1);
-   Fs5_y = (r == Y_RES-1) ? 0 : (c == X_RES-1) ?
-                         forceDir*Fy(c,r, 0,r+1) : forceDir*Fy(c,r, c+1,r+1);
-   forceDir = (c == 0) ? ((position[c][r].y - position[X_RES-1][r-1].y < 0) ? 1 : -1) :
-                         ((position[c][r].y - position[c-1][r-1].y < 0) ? 1 : -1);
-   Fs6_y = (c == 0) ? forceDir*Fy(c,r, X_RES-1,r-1) : forceDir*Fy(c,r, c-1,r-1);
-   
-   return Fs1_y*Fs1 + Fs2_y*Fs2 + Fs3_y*Fs3 + Fs4_y*Fs4 + Fs5_y*Fs5 + Fs6_y*Fs6;
-}
-
-/* determines the z components of the spring forces
- */
-GLfloat Skirt::springZ(int c, int r,
-                       float Fs1, float Fs2, float Fs3, float Fs4, float Fs5, float Fs6) const
-{
-   int forceDir = (r == Y_RES-1) ? 0 : (position[c][r].z - position[c][r+1].z < 0) ? 1 : -1;
-   float Fs1_z, Fs2_z, Fs3_z, Fs4_z, Fs5_z, Fs6_z; //the % of the force in z
-                     
-   Fs1_z = (r == Y_RES-1) ? 0 : forceDir*Fz(c,r, c,r+1);
-   forceDir = (position[c][r].z - position[c][r-1].z < 0) ? 1 : -1;
-   Fs2_z = forceDir*Fz(c,r, c,r-1);
-   forceDir = (c == 0) ? ((position[c][r].z - position[X_RES-1][r].z < 0) ? 1 : -1) :
-                         ((position[c][r].z - position[c-1][r].z < 0) ? 1 : -1);
-   Fs3_z = (c == 0) ? forceDir*Fz(c,r, X_RES-1,r) : forceDir*Fz(c,r, c-1,r);
-   forceDir = (c == X_RES-1) ? ((position[c][r].z - position[0][r].z < 0) ? 1 : -1) :
-                         ((position[c][r].z - position[c+1][r].z < 0) ? 1 : -1);
-   Fs4_z = (c == X_RES-1) ? forceDir*Fz(c,r, 0,r) : forceDir*Fz(c,r, c+1,r);
-   forceDir = (r == Y_RES-1) ? 0 : (c == X_RES-1) ? 
-                         ((position[c][r].z - position[0][r+1].z < 0) ? 1 : -1) :
-                         ((position[c][r].z - position[c+1][r+1].z < 0) ? 1 : -1);
-   Fs5_z = (r == Y_RES-1) ? 0 : (c == X_RES-1) ?
-                         forceDir*Fz(c,r, 0,r+1) : forceDir*Fz(c,r, c+1,r+1);
-   forceDir = (c == 0) ? ((position[c][r].z - position[X_RES-1][r-1].z < 0) ? 1 : -1) :
-                         ((position[c][r].z - position[c-1][r-1].z < 0) ? 1 : -1);
-   Fs6_z = (c == 0) ? forceDir*Fz(c,r, X_RES-1,r-1) : forceDir*Fz(c,r, c-1,r-1);
+/* accumulates the Hooke's law force of the springs of rows [firstRow, endRow) into their endpoints.
+ * Forces on vertices of the next row go to forceBelow rather than force, so no two rows ever write
+ * the same entry and bands of rows can run in parallel. See scalarSpringForces() for the force
+ * model
+ */
+void Skirt::calcSpringForces(int firstRow, int endRow)
+{
+   resetForces(firstRow, endRow);
+   for(int j = firstRow; j < endRow; j++){
+      kernels->springForces(springs, springs.rowStart[j], springs.crossStart[j], position,
+                            force, force);
+      kernels->springForces(springs, springs.crossStart[j], springs.rowStart[j+1], position,
+                            force, forceBelow);
+   }
+}
+
+/* zeroes the entries of force and forceBelow written by the springs of rows [firstRow, endRow):
+ * force over those rows and forceBelow over the rows below each of them
+ */
+void Skirt::resetForces(int firstRow, int endRow)
+{
+   int belowEnd = (endRow < yRes) ? endRow+1 : yRes;
    
-   return Fs1_z*Fs1 + Fs2_z*Fs2 + Fs3_z*Fs3 + Fs4_z*Fs4 + Fs5_z*Fs5 + Fs6_z*Fs6;
+   memset(force.x + at(0,firstRow), 0, (endRow - firstRow)*stride*sizeof(GLfloat));
+   memset(force.y + at(0,firstRow), 0, (endRow - firstRow)*stride*sizeof(GLfloat));
+   memset(force.z + at(0,firstRow), 0, (endRow - firstRow)*stride*sizeof(GLfloat));
+   memset(forceBelow.x + at(0,firstRow+1), 0, (belowEnd - firstRow-1)*stride*sizeof(GLfloat));
+   memset(forceBelow.y + at(0,firstRow+1), 0, (belowEnd - firstRow-1)*stride*sizeof(GLfloat));
+   memset(forceBelow.z + at(0,firstRow+1), 0, (belowEnd - firstRow-1)*stride*sizeof(GLfloat));
 }
 
-/* helper for springX. Used to determine the percent of a force to give to x
+/* integrates the velocities of rows [firstRow, endRow)
  */
-GLfloat Skirt::Fx(int col1, int row1, int col2, int row2) const
+void Skirt::updateVelocityRows(int firstRow, int endRow)
 {
-   float mag = sqrt(pow(position[col1][row1].x - position[col2][row2].x,2) +
-                    pow(position[col1][row1].y - position[col2][row2].y,2) +
-                    pow(position[col1][row1].z - position[col2][row2].z,2));
-   return pow((position[col1][row1].x - position[col2][row2].x)/mag, 2);
+   for(int j = firstRow; j < endRow; j++)
+      kernels->integrateVelocity(velocity, force, forceBelow, at(0,j), xRes, Hv, gravity,
+                                 rowDamping(j));
 }
 
-/* helper for springY. Used to determine the percent of a force to give to y
+/* integrates the positions of rows [firstRow, endRow). They are one contiguous run in each buffer,
+ * so this is a single linear sweep
  */
-GLfloat Skirt::Fy(int col1, int row1, int col2, int row2) const
+void Skirt::updatePositionRows(int firstRow, int endRow)
 {
-   float mag = sqrt(pow(position[col1][row1].x - position[col2][row2].x,2) +
-                    pow(position[col1][row1].y - position[col2][row2].y,2) +
-                    pow(position[col1][row1].z - position[col2][row2].z,2));
-   return pow((position[col1][row1].y - position[col2][row2].y)/mag, 2);
+   //an implicit step covers implicitStep explicit steps
+   GLfloat hp = (integrator == IMPLICIT) ? Hp*implicitStep : Hp;
+   
+   kernels->integratePosition(position, velocity, at(0,firstRow), (endRow - firstRow)*stride, hp);
 }
 
-/* helper for springZ. Used to determine the percent of a force to give to z
+/* calculates the unit vertex normals. Every row gathers its normals from the positions alone, so
+ * the rows can be split across the threads in any way
  */
-GLfloat Skirt::Fz(int col1, int row1, int col2, int row2) const
+void Skirt::calcNorms()
 {
-   float mag = sqrt(pow(position[col1][row1].x - position[col2][row2].x,2) +
-                    pow(position[col1][row1].y - position[col2][row2].y,2) +
-                    pow(position[col1][row1].z - position[col2][row2].z,2));
-   return pow((position[col1][row1].z - position[col2][row2].z)/mag, 2);
+   pool->parallelFor(normJob, 0, yRes);
 }
 
-/* returns the current length of a spring defined by the parameters
+/* calculates the unit normals of rows [firstRow, endRow) from the positions around them. The
+ * kernels take the columns with both neighbours in the row; the two columns at the seam find one
+ * of theirs across it. The waist and hem rows have triangles on one side only
  */
-GLfloat Skirt::currentLength(int col1, int row1, int col2, int row2) const
+void Skirt::calcNormRows(int firstRow, int endRow)
 {
-   return sqrt(pow(position[col1][row1].x - position[col2][row2].x,2) +
-               pow(position[col1][row1].y - position[col2][row2].y,2) +
-               pow(position[col1][row1].z - position[col2][row2].z,2));
+   calcNormRows(position, vertexNormals, firstRow, endRow);
 }
 
-/* calculates the vertex normals
+/* calculates the unit normals of rows [firstRow, endRow) of the given positions into normals
  */
-void Skirt::calcNorms()
+void Skirt::calcNormRows(const VectorArray &positions, VectorArray &normals, int firstRow,
+                         int endRow) const
 {
-   Vector v1, v2;
-   resetNorms();
-   for(int j = 0; j < Y_RES-1; j++){
-      for(int i = 1; i < X_RES; i++){
-         v1.x =   position[i][j].x - position[i-1][j].x;
-         v1.y =   position[i][j].y - position[i-1][j].y;
-         v1.z =   position[i][j].z - position[i-1][j].z;
-         v2.x =   position[i][j+1].x - position[i-1][j].x;
-         v2.y =   position[i][j+1].y - position[i-1][j].y;
-         v2.z =   position[i][j+1].z - position[i-1][j].z;
-         updateVertNorms(calcFaceNorm(v1, v2),
-                          vertexNormals[i][j], vertexNormals[i-1][j], vertexNormals[i][j+1]);
-         v1.x =   position[i-1][j+1].x - position[i-1][j].x;
-         v1.y =   position[i-1][j+1].y - position[i-1][j].y;
-         v1.z =   position[i-1][j+1].z - position[i-1][j].z;
-         updateVertNorms(calcFaceNorm(v2, v1),
-                          vertexNormals[i-1][j+1], vertexNormals[i-1][j], vertexNormals[i][j+1]);
-      }
-      v1.x =   position[0][j].x - position[X_RES-1][j].x;
-      v1.y =   position[0][j].y - position[X_RES-1][j].y;
-      v1.z =   position[0][j].z - position[X_RES-1][j].z;
-      v2.x =   position[0][j+1].x - position[X_RES-1][j].x;
-      v2.y =   position[0][j+1].y - position[X_RES-1][j].y;
-      v2.z =   position[0][j+1].z - position[X_RES-1][j].z;
-      updateVertNorms(calcFaceNorm(v1, v2),
-                       vertexNormals[0][j], vertexNormals[X_RES-1][j], vertexNormals[0][j+1]);
-      v1.x =   position[X_RES-1][j+1].x - position[X_RES-1][j].x;
-      v1.y =   position[X_RES-1][j+1].y - position[X_RES-1][j].y;
-      v1.z =   position[X_RES-1][j+1].z - position[X_RES-1][j].z;
-      updateVertNorms(calcFaceNorm(v2, v1), vertexNormals[X_RES-1][j+1], 
-                       vertexNormals[X_RES-1][j], vertexNormals[0][j+1]);
+   for(int j = firstRow; j < endRow; j++){
+      bool hasAbove = (j > 0), hasBelow = (j < yRes-1);
+      scalarVertexNormal(positions, normals, at(0,j), xRes-1, 1, stride, hasAbove, hasBelow);
+      kernels->vertexNormals(positions, normals, at(1,j), xRes-2, stride, hasAbove, hasBelow);
+      scalarVertexNormal(positions, normals, at(xRes-1,j), -1, 1-xRes, stride, hasAbove,
+                         hasBelow);
    }
 }
 
-/* resets the vertex normals to zero so they can be recalculated
+/* calculates the unit vertex normals and adds the drag and lift of the air over the step to the
+ * velocities, which the next step integrates. The normals pass already sums the area-weighted face
+ * normals around every vertex, so the air costs one more read and write of the velocities instead
+ * of a pass of its own. The force on a vertex grows with its share of the area, so like gravity
+ * the coefficients are scaled to keep its ratio to the weight the same at any resolution
+ */
+void Skirt::calcNormsAir()
+{
+   const GLfloat scale = rowSpacing/restLength*forceScale;
+   const GLfloat hv = Hv*getStepsPerUpdate()*scale/6;
+   
+   air.windX = wind.x;
+   air.windY = wind.y;
+   air.windZ = wind.z;
+   air.drag = AIR_DRAG*hv;
+   air.lift = AIR_LIFT*hv;
+   pool->parallelFor(normAirJob, 0, yRes);
+}
+
+/* calculates the unit normals of rows [firstRow, endRow) as calcNormRows() and applies the air to
+ * their vertices. The pinned rows only get their normals
  */
-void Skirt::resetNorms()
+void Skirt::calcNormAirRows(int firstRow, int endRow)
 {
-   for(int j = 0; j < Y_RES-1; j++)
-      for(int i = 1; i < X_RES; i++){
-         vertexNormals[i][j].x = 0;
-         vertexNormals[i][j].y = 0;
-         vertexNormals[i][j].z = 0;
+   for(int j = firstRow; j < endRow; j++){
+      bool hasAbove = (j > 0), hasBelow = (j < yRes-1);
+      if(j < 2){
+         calcNormRows(position, vertexNormals, j, j+1);
+         continue;
       }
+      scalarVertexNormalAir(position, velocity, vertexNormals, at(0,j), xRes-1, 1, stride,
+                            hasAbove, hasBelow, air);
+      kernels->vertexNormalsAir(position, velocity, vertexNormals, at(1,j), xRes-2, stride,
+                                hasAbove, hasBelow, air);
+      scalarVertexNormalAir(position, velocity, vertexNormals, at(xRes-1,j), -1, 1-xRes, stride,
+                            hasAbove, hasBelow, air);
+   }
 }
 
-/* calculates the face normals for the triangles used to generate the skirt mesh
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the stiffness along one axis of a cell of a diagonal spanning along that axis and
+ * across the other, per unit of its stiffness: the derivative of the pull of scalarSpringForces()
+ * along the axis at rest, the rest length of a diagonal being 1/sqrt(2) of its length
  */
-Skirt::Vector Skirt::calcFaceNorm(Vector v1, Vector v2) const
+double diagonalStiffness(double along, double across)
 {
-   Vector normal;
-   
-   normal.x = v1.y*v2.z - v1.z*v2.y;
-   normal.y = v1.z*v2.x - v1.x*v2.z;
-   normal.z = v1.x*v2.y - v1.y*v2.x;
-   
-   return normal;
+   double length = sqrt(along*along + across*across);
+   return (along*along*along + (2 - sqrt(2.0))*along*across*across)/(length*length*length);
 }
 
-/* updates the normals of the vertices which share the same polygon to include its face normal
+/* returns the pull along one axis of a cell of a diagonal spanning along that axis and across the
+ * other, at rest and per unit of its stiffness, as in scalarSpringForces()
  */
-void Skirt::updateVertNorms(Vector faceNorm, Vector &vert1Norm, Vector &vert2Norm,
-                            Vector &vert3Norm)
+double diagonalPull(double along, double across)
 {
-   vert1Norm.x += faceNorm.x;
-   vert1Norm.y += faceNorm.y;
-   vert1Norm.z += faceNorm.z;
-   vert2Norm.x += faceNorm.x;
-   vert2Norm.y += faceNorm.y;
-   vert2Norm.z += faceNorm.z;
-   vert3Norm.x += faceNorm.x;
-   vert3Norm.y += faceNorm.y;
-   vert3Norm.z += faceNorm.z;
+   double length = sqrt(along*along + across*across);
+   return (1 - sqrt(0.5))*along*along/length;
 }
@@ -14,8 +14,20 @@
 #ifndef SKIRT_H
 #define SKIRT_H
 
+#include "kernels.h"
+#include "threadpool.h"
 #include <GL/gl.h> //used for various gl types and functions
 
+class BlockMatrix;
+class SpatialHash;
+
+/* A copy of what it takes to draw a Skirt: the vertex positions and normals after its last update
+ * and before it, so it can be drawn anywhere in between. Filled by Skirt::saveFrame() and drawn by
+ * Skirt::draw() without touching the simulation, so a frame can be drawn on one thread while the
+ * next is simulated on another
+ */
+struct SkirtFrame { VectorArray position, normals, lastPosition, lastNormals; };
+
 /* The primary class for the program. Performs the physically based animation of a cloth/spring
  * system used to render a skirt.
  * This class is responsible for the following:
@@ -27,17 +39,107 @@
 class Skirt
 {
 public:
-   //constructor
-   Skirt();
+//::PUBLIC CONSTANTS:://
+   //the resolution of the stock skirt: vertices around the waist and rows from waist to hem
+   static const int DEFAULT_X_RES, DEFAULT_Y_RES;
+   //the number of explicit steps an implicit or XPBD step covers unless set otherwise
+   static const int DEFAULT_IMPLICIT_STEP;
+   //the number of constraint iterations of an XPBD step unless set otherwise
+   static const int DEFAULT_CONSTRAINT_ITERATIONS;
+   //the most explicit steps settle() takes unless told otherwise
+   static const int MAX_SETTLE_STEPS;
+   //the time integration schemes: explicit Euler, backward Euler solved by conjugate gradient, or
+   //extended position based dynamics with the springs as distance constraints
+   enum Integrator { EXPLICIT, IMPLICIT, XPBD };
+   //the collisions a step resolves, as flags: of the skirt with the body (a capsule for the hips
+   //and one for each leg, turned by the drive with the waist) and of the skirt with itself
+   enum Collisions { NO_COLLISIONS = 0, BODY_COLLISIONS = 1, SELF_COLLISIONS = 2 };
+   
+   //constructor. Builds a skirt of xRes vertices around by yRes rows. The garment keeps the same
+   //size and behaviour at any resolution
+   Skirt(int xRes = DEFAULT_X_RES, int yRes = DEFAULT_Y_RES);
    //destructor
    ~Skirt();
-   //draws the skirt mesh using triangle strips after calling subroutines to update the skirt state.
-   void draw();
-   //loads a texture for the skirt. The texture image must be a P6 RAW ppm.
-   void loadTexture() const;
+   //draws a frame of the skirt mesh using triangle strips, interpolated by alpha from the state
+   //before the last update to the state after it. Reads nothing but the frame and the resolution
+   void draw(const SkirtFrame &frame, GLfloat alpha = 1) const;
+   //loads a texture for the skirt. The texture image must be a P6 RAW ppm. With isCached its mip
+   //chain is taken from a cache next to it where possible. Returns true if it was
+   bool loadTexture(bool isCached = true) const;
+   //calls subroutines for recalculating the vertex positions, velocities, and normals. This
+   //advances the simulation by one step without rendering
+   void updateSkirt();
+   //calls updateSkirt() the given number of times, keeping the state before the last call for
+   //saveFrame()
+   void updateSkirt(int updates);
+   //allocates the buffers of a frame of this skirt's resolution
+   void allocFrame(SkirtFrame &frame) const;
+   //frees the buffers of a frame allocated by allocFrame()
+   void freeFrame(SkirtFrame &frame) const;
+   //copies the state after and before the last updateSkirt(int) into a frame for draw()
+   void saveFrame(SkirtFrame &frame) const;
+   //writes a checkpoint of the skirt to path: the positions and velocities, the motion and its
+   //phase, the integrator, the air and its wind, and the collisions with the body as they last
+   //placed it. Returns false if it could not be written
+   bool saveState(const char *path) const;
+   //restores a checkpoint written by saveState() from a skirt of this resolution, which then steps
+   //on exactly as that one would have, in the same air and wind. Returns false and leaves the skirt
+   //as it was if there is none
+   bool restoreState(const char *path);
+   //copies the positions, velocities, normals and phase of a skirt of the same resolution, which
+   //this one then steps on from as that one would
+   void setState(const Skirt &skirt);
+   //steps the skirt with its motion stopped until it hangs at rest in still air, or for at most
+   //maxSteps explicit steps. Returns the number of explicit steps taken
+   int settle(int maxSteps = MAX_SETTLE_STEPS);
+   //brings the skirt to rest before its motion starts: restores the rest state cached in directory
+   //for its resolution, integrator and collisions, or settles it and caches that state there.
+   //Returns the number of explicit steps settled, 0 if the cache was restored. If isCached is
+   //given, it is set to whether the rest state is in the cache afterwards
+   int warmStart(const char *directory, bool *isCached = 0);
+   //calculates the unit normals of positions laid out as this skirt's, as the simulation does, on
+   //the calling thread. For frames that were not simulated, such as those played back
+   void calcNormals(const VectorArray &positions, VectorArray &normals) const;
    
 //::ACCESSORS:://
    GLfloat getHeight() const { return height; }
+   GLfloat getAmplitude() const { return amplitude; }
+   GLfloat getFrequency() const { return frequency; }
+   GLfloat getTheta() const { return theta; }
+   bool getIs3DRotation() const { return is3DRotation; }
+   const Kernels &getKernels() const { return *kernels; }
+   int getThreadCount() const { return pool->getThreadCount(); }
+   int getXRes() const { return xRes; }
+   int getYRes() const { return yRes; }
+   int getVertexCount() const { return xRes*yRes; }
+   //returns the distance between rows in the VectorArray buffers of the skirt and its frames
+   int getStride() const { return stride; }
+   Integrator getIntegrator() const { return integrator; }
+   int getImplicitStep() const { return implicitStep; }
+   //returns the number of explicit steps one updateSkirt() covers under the current integrator
+   int getStepsPerUpdate() const { return (integrator == EXPLICIT) ? 1 : implicitStep; }
+   int getConstraintIterations() const { return constraintIterations; }
+   //returns the Collisions flags of the collisions resolved
+   int getCollisions() const { return collisions; }
+   //returns whether steps apply the drag and lift of the air
+   bool getIsAerodynamic() const { return isAerodynamic; }
+   //returns whether steps move the skirt out of the body. The explicit step is too close to its
+   //stability limit at the waist to take the contacts, so only IMPLICIT and XPBD resolve them
+   bool isBodyResolved() const { return (collisions & BODY_COLLISIONS) && integrator != EXPLICIT; }
+   //returns the largest amplitude allowed; larger with the body to hold the skirt out of it
+   GLfloat getMaxAmplitude() const;
+   //returns the number of conjugate gradient or constraint iterations taken by the last implicit or
+   //XPBD step
+   int getSolverIterations() const { return solverIterations; }
+   GLfloat getX(int col, int row) const { return position.x[at(col,row)]; }
+   GLfloat getY(int col, int row) const { return position.y[at(col,row)]; }
+   GLfloat getZ(int col, int row) const { return position.z[at(col,row)]; }
+   GLfloat getNormalX(int col, int row) const { return vertexNormals.x[at(col,row)]; }
+   GLfloat getNormalY(int col, int row) const { return vertexNormals.y[at(col,row)]; }
+   GLfloat getNormalZ(int col, int row) const { return vertexNormals.z[at(col,row)]; }
+   //returns the positions and unit normals of the vertices, getStride() floats a row
+   const VectorArray &getPositions() const { return position; }
+   const VectorArray &getNormals() const { return vertexNormals; }
    
 //::MUTATORS:://
    //changes the animation to a 2D rotation about the z-axis
@@ -47,65 +149,221 @@ public:
    //decreases the amplitude of the motion
    void decAmplitude() { if(amplitude > AMP_MIN) amplitude -= AMP_INC; }
    //increases the amplitude of the motion
-   void incAmplitude() { if(amplitude < AMP_MAX) amplitude += AMP_INC; }
+   void incAmplitude() { if(amplitude < getMaxAmplitude()) amplitude += AMP_INC; }
    //decreases the frequency of the motion
    void decFrequency() { if(frequency > FREQ_MIN) frequency -= FREQ_INC; }
    //increases the frequency of the motion
    void incFrequency() { if(frequency < FREQ_MAX) frequency += FREQ_INC; }
+   //selects the implementation of the solver's inner loops. Defaults to bestKernels()
+   void setKernels(const Kernels &k) { kernels = &k; }
+   //sets the number of threads the solver splits its rows across. Results do not depend on it
+   void setThreadCount(int threads);
+   //sets the amplitude of the motion, clamped to the range allowed by the arrow keys
+   void setAmplitude(GLfloat amp);
+   //selects the collisions resolved after each step by their Collisions flags, the body only under
+   //IMPLICIT and XPBD (see isBodyResolved()). Defaults to NO_COLLISIONS. Only this class resolves
+   //them; SkirtT and SkirtBatch pass through everything
+   void setCollisions(int flags);
+   //turns the drag and lift of the air on the skirt on or off. Defaults to off. Only this class
+   //applies them; SkirtT and SkirtBatch move in a vacuum
+   void setAerodynamic(bool isOn) { isAerodynamic = isOn; }
+   //sets the velocity of the wind the air moves at. Defaults to DEFAULT_WIND
+   void setWind(GLfloat x, GLfloat y, GLfloat z);
+   //sets the frequency of the motion, clamped to the range allowed by the arrow keys
+   void setFrequency(GLfloat freq);
+   //sets the phase of the motion, in radians
+   void setTheta(GLfloat phase) { theta = phase; }
+   //selects the time integration scheme. Defaults to EXPLICIT. Clamps the amplitude to
+   //getMaxAmplitude()
+   void setIntegrator(Integrator mode);
+   //sets how many explicit steps one implicit or XPBD step covers, i.e. how far updateSkirt()
+   //advances the simulation in IMPLICIT and XPBD mode
+   void setImplicitStep(int explicitSteps);
+   //sets the number of constraint iterations of each substep of an XPBD step; more iterations hold
+   //the springs closer to their stiffness
+   void setConstraintIterations(int iterations);
    
 private:
+   //the compile-time specialized solver shares the constants and initial state of this class
+   template <int XRes, int YRes> friend class SkirtT;
+   friend class SkirtBatch;
+   //the benchmark suite times the phases of a step one by one
+   friend class SkirtBench;
+   //the frozen reference solver copies the state and springs of a skirt
+   friend class SkirtReference;
+   
 //::STRUCTS:://
-   struct Vertex { GLfloat x, y, z; };
    struct Vector { GLfloat x, y, z; };
-
+   //the points within radius of the segment from a to b
+   struct Capsule { Vector a, b; GLfloat radius; };
+   
 //::CONSTANTS:://
-   static const int   X_RES, Y_RES;
    static const float GRAVITY, Ks, KsDiag, Kd, Hp, Hv, AMP_MIN, AMP_MAX, AMP_INC,\
-                      FREQ_MIN, FREQ_MAX, FREQ_INC;
+                      FREQ_MIN, FREQ_MAX, FREQ_INC, CG_TOLERANCE;
+   static const int CG_MAX_ITERATIONS;
+   //settle() checks how far the skirt moved every SETTLE_CHECK_STEPS explicit steps, and stops
+   //once no vertex moved SETTLE_TOLERANCE along any axis
+   static const int SETTLE_CHECK_STEPS;
+   static const float SETTLE_TOLERANCE;
+   //the body at rest, how far the skirt is kept off it and the fraction of the skirt's sliding
+   //speed it takes away. With it, the amplitude may reach AMP_MAX_BODY
+   static const int BODY_CAPSULES = 3;
+   static const Capsule REST_BODY[BODY_CAPSULES];
+   static const float BODY_SKIN, BODY_FRICTION, AMP_MAX_BODY;
+   //two vertices are kept apart by SELF_THICKNESS times the rest length of the springs around the
+   //waist, unless they are within SELF_EXCLUDED_RING columns and rows of each other in the mesh
+   static const float SELF_THICKNESS;
+   static const int SELF_EXCLUDED_RING;
+   //the drag and lift coefficients of the air on the skirt, per unit area at the stock resolution,
+   //and the wind it blows at unless setWind() is called
+   static const float AIR_DRAG, AIR_LIFT;
+   static const Vector DEFAULT_WIND;
    
 //::VARIABLES:://
-   Vertex *initialPos, **position;
-   Vector **velocity, **vertexNormals;
-   GLfloat height, restLength, amplitude, frequency, theta;
+   const int xRes, yRes, stride;
+   //the rest positions of the waist, which calcOscillatoryAcc() rotates
+   VectorArray initialPos;
+   VectorArray position, velocity, vertexNormals, force, forceBelow;
+   //the state before the last updateSkirt(int), for saveFrame()
+   VectorArray lastPosition, lastNormals;
+   SpringArray springs;
+   const Kernels *kernels;
+   ThreadPool *pool;
+   MemberJob<Skirt> springJob, velocityJob, positionJob, normJob, normAirJob;
+   MemberJob<Skirt> predictJob, constraintJob, deriveJob;
+   MemberJob<Skirt> bodyJob, contactJob, separationJob;
+   GLfloat height, restLength, rowSpacing, gravity, amplitude, frequency, theta;
+   //the rest lengths and stiffness weights of the springs across, down and along the diagonals of
+   //a cell, the scale of all forces and the drop of row 1 below the waist, set by weighSprings()
+   GLfloat acrossLength, downLength, diagLength, acrossWeight, downWeight, diagWeight;
+   GLfloat forceScale, waistDrop;
    bool is3DRotation;
+   Integrator integrator;
+   int implicitStep, solverIterations;
+   //the implicit system and the conjugate gradient vectors; allocated when IMPLICIT is first set
+   BlockMatrix *system;
+   VectorArray residual, direction, preconditioned, product;
+   //the constraint iterations of an XPBD substep, and the parity of the rows being swept
+   int constraintIterations, sweepParity;
+   //the positions at the start of an XPBD substep and the accumulated multiplier of each
+   //constraint; allocated when XPBD is first set
+   VectorArray previous;
+   GLfloat *lambda;
+   //the collisions resolved, the body as the drive last placed it and as it was the step before,
+   //and for self collisions the hash of the free vertices, their indices and the row of every
+   //entry of the buffers, built when SELF_COLLISIONS is first set
+   int collisions;
+   Capsule body[BODY_CAPSULES], lastBody[BODY_CAPSULES];
+   bool isBodyPlaced;
+   SpatialHash *selfHash;
+   int *freeVertices, *rowOf;
+   //whether steps apply the air, its wind and, while calcNormsAir() runs, its coefficients
+   bool isAerodynamic;
+   Vector wind;
+   AirFlow air;
    
 //::PRIVATE MEMBER FUNCTIONS:://
+   //returns the index of the vertex at column col and row row into the VectorArray buffers
+   int at(int col, int row) const { return row*stride + col; }
+   //returns the column to the left of col, wrapping around the seam of the cylinder
+   int leftOf(int col) const { return (col == 0) ? xRes-1 : col-1; }
+   //returns the column to the right of col, wrapping around the seam of the cylinder
+   int rightOf(int col) const { return (col == xRes-1) ? 0 : col+1; }
+   //allocates the zeroed component buffers of a VectorArray
+   void allocArray(VectorArray &array) const;
+   //copies the component buffers of one VectorArray into another
+   void copyArray(VectorArray &to, const VectorArray &from) const;
+   //frees the component buffers of a VectorArray
+   void freeArray(VectorArray &array) const;
    //generates the initial state/position of the skirt vertices 
    void generateVertices();
-   //calls subroutines for recalculating the vertex positions, velocities, and normals 
-   void updateSkirt();
+   //sets the rest lengths and weights of the springs and the scale of the forces for the shape of
+   //the cells, so the skirt hangs the same at any resolution
+   void weighSprings();
+   //builds the spring topology: the horizontal, vertical and diagonal edges of the mesh
+   void generateSprings();
+   //adds one spring of the given rest length and stiffness weight between vertex (col1,row1) and
+   //vertex (col2,row2) to the spring topology
+   void addSpring(int col1, int row1, int col2, int row2, GLfloat rest, GLfloat weight);
+   //returns the stiffness of the springs at a vertex in the given row
+   GLfloat rowStiffness(int row) const;
+   //returns the spring damping of the vertices in the given row
+   GLfloat rowDamping(int row) const;
+   //returns the row of the stock skirt at the same point of the cloth as the given row
+   double stockRow(int row) const;
    //updates the vertex positions via Euler integration of the vertex velocities
    void updatePosition();
    //updates the vertex velocities via Euler integration using the spring forces, gravity, and
    //oscillatory forces as accelerations
    void updateVelocity();
-   //calculates the oscillatory acceleration applied to the top row of free-motion vertices
-   void calcOscillatoryAcc();
-   //determines the x components of the spring forces
-   GLfloat springX(int c, int r, float Fs1, float Fs2, float Fs3,
-                                 float Fs4, float Fs5, float Fs6) const;
-   //determines the y components of the spring forces
-   GLfloat springY(int c, int r, float Fs1, float Fs2, float Fs3,
-                                 float Fs4, float Fs5, float Fs6) const;
-   //determines the z components of the spring forces
-   GLfloat springZ(int c, int r, float Fs1, float Fs2, float Fs3,
-                                 float Fs4, float Fs5, float Fs6) const;
-   //helper for springX. Used to determine the percent of a force to give to x
-   GLfloat Fx(int col1, int row1, int col2, int row2) const;
-   //helper for springY. Used to determine the percent of a force to give to y
-   GLfloat Fy(int col1, int row1, int col2, int row2) const;
-   //helper for springZ. Used to determine the percent of a force to give to z
-   GLfloat Fz(int col1, int row1, int col2, int row2) const;
-   //returns the current length of a spring defined by the parameters
-   GLfloat currentLength(int col1, int row1, int col2, int row2) const;
-   //calculates the vertex normals
+   //calculates the oscillatory acceleration applied to the top row of free-motion vertices over
+   //the given number of explicit steps
+   void calcOscillatoryAcc(int steps);
+   //accumulates the Hooke's law force of the springs of rows [firstRow, endRow) into their
+   //endpoints
+   void calcSpringForces(int firstRow, int endRow);
+   //zeroes the entries of force and forceBelow written by the springs of rows [firstRow, endRow)
+   void resetForces(int firstRow, int endRow);
+   //integrates the velocities of rows [firstRow, endRow)
+   void updateVelocityRows(int firstRow, int endRow);
+   //integrates the positions of rows [firstRow, endRow)
+   void updatePositionRows(int firstRow, int endRow);
+   //updates the vertex velocities by one backward Euler step of implicitStep explicit steps
+   void updateVelocityImplicit();
+   //assembles the linear system of an implicit step of velocity step hv and position step hp, and
+   //its right-hand side into residual
+   void assembleSystem(GLfloat hv, GLfloat hp);
+   //solves the assembled system for the new velocities by preconditioned conjugate gradient
+   void solveSystem();
+   //updates the vertex positions and velocities by one XPBD step of implicitStep explicit steps,
+   //taken as substeps of one explicit step
+   void updateXPBD();
+   //integrates the velocities of rows [firstRow, endRow) under gravity and moves their positions
+   //to where those velocities take them, keeping the old positions in previous
+   void predictPositionRows(int firstRow, int endRow);
+   //sweeps the distance constraints of the springs of rows 1 + sweepParity + 2k, k in
+   //[first, end), by Gauss-Seidel
+   void projectConstraintRows(int first, int end);
+   //sets the velocities of rows [firstRow, endRow) to the damped distance their vertices moved
+   void deriveVelocityRows(int firstRow, int endRow);
+   //projects the distance constraints of springs [begin, end) of an XPBD substep of squared step
+   //h2 once each, in order
+   void projectConstraints(int begin, int end, GLfloat h2);
+   //resolves the collisions selected by setCollisions() once the positions of a step are updated
+   void collide();
+   //places the body by the rotation matrix of the drive, keeping where it was in lastBody
+   void placeBody(const float drive[9]);
+   //moves the vertices of rows [firstRow, endRow) out of the body
+   void collideBodyRows(int firstRow, int endRow);
+   //finds the vertices of rows [firstRow, endRow) closer to another than allowed, accumulating the
+   //corrections that separate them into force and forceBelow
+   void findContactRows(int firstRow, int endRow);
+   //applies the corrections of findContactRows() to the vertices of rows [firstRow, endRow)
+   void separateRows(int firstRow, int endRow);
+   //restores the positions and velocities of a checkpoint at path and the body as it was placed,
+   //and with isMotionRestored its motion, integrator and collisions too; without, its integrator
+   //and collisions must match this skirt's
+   bool readState(const char *path, bool isMotionRestored);
+   //returns, in a new[] string, the path of the rest state cached in directory for the resolution,
+   //integrator and collisions of the skirt
+   char *restStatePath(const char *directory) const;
+   //calculates the unit vertex normals
    void calcNorms();
-   //resets the vertex normals to zero so they can be recalculated
-   void resetNorms();
-   //calculates the face normals for the triangles used to generate the skirt mesh
-   Vector calcFaceNorm(Vector v1, Vector v2) const;
-   //updates the normals of the vertices which share the same polygon to include its face normal
-   void updateVertNorms(Vector faceNorm, Vector &vert1Norm, Vector &vert2Norm, Vector &vert3Norm);
+   //calculates the unit normals of rows [firstRow, endRow) from the positions around them
+   void calcNormRows(int firstRow, int endRow);
+   //calculates the unit normals of rows [firstRow, endRow) of the given positions into normals
+   void calcNormRows(const VectorArray &positions, VectorArray &normals, int firstRow,
+                     int endRow) const;
+   //calculates the unit vertex normals and adds the drag and lift of the air over the step to the
+   //velocities in the same pass
+   void calcNormsAir();
+   //calculates the unit normals of rows [firstRow, endRow) and applies the air to their vertices
+   void calcNormAirRows(int firstRow, int endRow);
+   //issues the normal of vertex v of a frame, interpolated by alpha from its last state to its
+   //current one
+   void drawNormal(const SkirtFrame &frame, int v, GLfloat alpha) const;
+   //issues vertex v of a frame, interpolated by alpha from its last position to its current one
+   void drawVertex(const SkirtFrame &frame, int v, GLfloat alpha) const;
 };
 
 #endif //SKIRT_H
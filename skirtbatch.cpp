@@ -0,0 +1,287 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtbatch.cpp - Implementation for the SkirtBatch class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirtbatch.h"
+#include "batchlanes.h"
+#include "quaternion.h"
+#include <cmath> //used for pow(), sqrt(), sin(), cos()
+#include <limits> //used for numeric_limits<float>::infinity()
+
+using namespace std;
+
+/* SkirtBatch - CONSTRUCTOR. The initial vertices, springs and stiffness and damping profiles are
+ * taken from a stock Skirt of the same resolution, so every instance starts from its state
+ */
+SkirtBatch::SkirtBatch(int count, int xRes, int yRes) :
+                       count(count), packCount((count + LANES-1)/LANES), xRes(xRes), yRes(yRes),
+                       stepJob(*this, &SkirtBatch::stepPacks)
+{
+   Skirt stock(xRes, yRes);
+   const int size = packCount*3*getVertexCount()*LANES;
+   
+   position = alignedAllocFloats(size);
+   velocity = alignedAllocFloats(size);
+   force = alignedAllocFloats(size);
+   forceBelow = alignedAllocFloats(size);
+   normals = alignedAllocFloats(size);
+   for(int p = 0; p < packCount; p++){
+      for(int j = 0; j < yRes; j++){
+         for(int i = 0; i < xRes; i++){
+            for(int l = 0; l < LANES; l++){
+               position[at(p,0,j*xRes + i) + l] = stock.position.x[stock.at(i,j)];
+               position[at(p,1,j*xRes + i) + l] = stock.position.y[stock.at(i,j)];
+               position[at(p,2,j*xRes + i) + l] = stock.position.z[stock.at(i,j)];
+               normals[at(p,0,j*xRes + i) + l] = stock.vertexNormals.x[stock.at(i,j)];
+               normals[at(p,1,j*xRes + i) + l] = stock.vertexNormals.y[stock.at(i,j)];
+               normals[at(p,2,j*xRes + i) + l] = stock.vertexNormals.z[stock.at(i,j)];
+            }
+         }
+      }
+   }
+   
+   const SpringArray &stockSprings = stock.springs;
+   springs.count = stockSprings.count;
+   springs.a = new int[springs.count];
+   springs.b = new int[springs.count];
+   springs.rest = alignedAllocFloats(springs.count);
+   springs.ksA = alignedAllocFloats(springs.count);
+   springs.ksB = alignedAllocFloats(springs.count);
+   springs.rowStart = new int[yRes+1];
+   springs.crossStart = new int[yRes];
+   for(int s = 0; s < springs.count; s++){
+      springs.a[s] = stockSprings.a[s]/stock.stride*xRes + stockSprings.a[s]%stock.stride;
+      springs.b[s] = stockSprings.b[s]/stock.stride*xRes + stockSprings.b[s]%stock.stride;
+      springs.rest[s] = stockSprings.rest[s];
+      springs.ksA[s] = stockSprings.ksA[s];
+      springs.ksB[s] = stockSprings.ksB[s];
+   }
+   for(int j = 0; j <= yRes; j++) springs.rowStart[j] = stockSprings.rowStart[j];
+   for(int j = 0; j < yRes; j++) springs.crossStart[j] = stockSprings.crossStart[j];
+   
+   initialX = new GLfloat[xRes];
+   initialY = new GLfloat[xRes];
+   initialZ = new GLfloat[xRes];
+   for(int i = 0; i < xRes; i++){
+      initialX[i] = stock.initialPos.x[i];
+      initialY[i] = stock.initialPos.y[i];
+      initialZ[i] = stock.initialPos.z[i];
+   }
+   rowKd = new GLfloat[yRes];
+   for(int j = 0; j < yRes; j++) rowKd[j] = stock.rowDamping(j);
+   waistDrop = stock.waistDrop;
+   gravity = stock.gravity;
+   
+   amplitude = new GLfloat[packCount*LANES];
+   frequency = new GLfloat[packCount*LANES];
+   theta = new GLfloat[packCount*LANES];
+   is3DRotation = new bool[packCount*LANES];
+   for(int k = 0; k < packCount*LANES; k++){
+      amplitude[k] = Skirt::AMP_MIN;
+      frequency[k] = Skirt::FREQ_MIN;
+      theta[k] = 0;
+      is3DRotation[k] = true;
+   }
+   kernels = &bestBatchKernels();
+   pool = new ThreadPool(1);
+   stepCount = 0;
+}
+
+/* SkirtBatch - DESTRUCTOR
+ */
+SkirtBatch::~SkirtBatch()
+{
+   delete pool;
+   alignedFree(position);
+   alignedFree(velocity);
+   alignedFree(force);
+   alignedFree(forceBelow);
+   alignedFree(normals);
+   delete [] springs.a;
+   delete [] springs.b;
+   alignedFree(springs.rest);
+   alignedFree(springs.ksA);
+   alignedFree(springs.ksB);
+   delete [] springs.rowStart;
+   delete [] springs.crossStart;
+   delete [] initialX;
+   delete [] initialY;
+   delete [] initialZ;
+   delete [] rowKd;
+   delete [] amplitude;
+   delete [] frequency;
+   delete [] theta;
+   delete [] is3DRotation;
+}
+
+/* advances every instance by the given number of explicit steps, then recalculates the normals.
+ * Each thread runs all the steps of its band of packs in turn, so a pack stays in cache for all
+ * of them
+ */
+void SkirtBatch::step(int steps)
+{
+   stepCount = steps;
+   pool->parallelFor(stepJob, 0, packCount);
+}
+
+/* sets the amplitude of the motion of instance k, clamped as by Skirt::setAmplitude()
+ */
+void SkirtBatch::setAmplitude(int k, GLfloat amp)
+{
+   amplitude[k] = (amp < Skirt::AMP_MIN) ? Skirt::AMP_MIN :
+                  (amp > Skirt::AMP_MAX) ? Skirt::AMP_MAX : amp;
+}
+
+/* sets the frequency of the motion of instance k, clamped as by Skirt::setFrequency()
+ */
+void SkirtBatch::setFrequency(int k, GLfloat freq)
+{
+   frequency[k] = (freq < Skirt::FREQ_MIN) ? Skirt::FREQ_MIN :
+                  (freq > Skirt::FREQ_MAX) ? Skirt::FREQ_MAX : freq;
+}
+
+/* copies the positions, velocities and normals of a skirt of the batch's resolution into instance
+ * k, e.g. to start it from a rest state restored by Skirt::warmStart(). Its motion is left as set
+ */
+void SkirtBatch::setState(int k, const Skirt &skirt)
+{
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         int v = skirt.at(i,j);
+         position[at(k,0,i,j)] = skirt.position.x[v];
+         position[at(k,1,i,j)] = skirt.position.y[v];
+         position[at(k,2,i,j)] = skirt.position.z[v];
+         velocity[at(k,0,i,j)] = skirt.velocity.x[v];
+         velocity[at(k,1,i,j)] = skirt.velocity.y[v];
+         velocity[at(k,2,i,j)] = skirt.velocity.z[v];
+         normals[at(k,0,i,j)] = skirt.vertexNormals.x[v];
+         normals[at(k,1,i,j)] = skirt.vertexNormals.y[v];
+         normals[at(k,2,i,j)] = skirt.vertexNormals.z[v];
+      }
+   }
+}
+
+/* sets the number of threads the packs are split across. Each pack is stepped by one thread, so
+ * the results are bit-identical for any thread count
+ */
+void SkirtBatch::setThreadCount(int threads)
+{
+   delete pool;
+   pool = new ThreadPool(threads);
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* steps the packs [firstPack, endPack) by stepCount explicit steps and recalculates their normals
+ */
+void SkirtBatch::stepPacks(int firstPack, int endPack)
+{
+   for(int p = firstPack; p < endPack; p++){
+      GLfloat *pos = position + at(p,0,0), *vel = velocity + at(p,0,0);
+      GLfloat *f = force + at(p,0,0), *fb = forceBelow + at(p,0,0);
+      for(int s = 0; s < stepCount; s++){
+         calcOscillatoryAcc(p);
+         kernels->springForces(springs, xRes, yRes, pos, f, fb);
+         kernels->integrate(pos, vel, f, fb, rowKd, xRes, yRes, Skirt::Hv, Skirt::Hp, gravity);
+      }
+      kernels->vertexNormals(pos, normals + at(p,0,0), xRes, yRes);
+   }
+}
+
+/* calculates the oscillatory acceleration of each instance of pack p, as
+ * Skirt::calcOscillatoryAcc(). The drive matrix of each instance is built on its own, then the
+ * waists of all of them are rotated and compared across the lanes at once
+ */
+void SkirtBatch::calcOscillatoryAcc(int p)
+{
+   GLfloat *px = position + at(p,0,0), *py = position + at(p,1,0), *pz = position + at(p,2,0);
+   GLfloat *vx = velocity + at(p,0,0), *vy = velocity + at(p,1,0), *vz = velocity + at(p,2,0);
+   float drive[9][LANES], yMin[LANES], yMax[LANES];
+   int minVertex[LANES], maxVertex[LANES], isOscillating[LANES];
+   
+   for(int l = 0; l < LANES; l++){
+      const int k = p*LANES + l;
+      float m[9];
+      theta[k] += frequency[k];
+      Quaternion xrot(amplitude[k]*cos(-theta[k]), 1, 0, 0);
+      Quaternion zrot(amplitude[k]*sin(-theta[k]), 0, 0, 1);
+      (is3DRotation[k] ? zrot*xrot : xrot).toMatrix(m);
+      for(int e = 0; e < 9; e++) drive[e][l] = m[e];
+      minVertex[l] = maxVertex[l] = isOscillating[l] = 0;
+      yMin[l] = numeric_limits<float>::infinity();
+      yMax[l] = -yMin[l];
+   }
+   for(int i = 0; i < xRes; i++){
+      const GLfloat x = initialX[i], y = initialY[i], z = initialZ[i];
+      const int top = i*LANES, below = (xRes + i)*LANES;
+      //rotated as by Quaternion::rotatePoints()
+      for(int l = 0; l < LANES; l++){
+         px[below+l] = drive[0][l]*x + drive[1][l]*y + drive[2][l]*z;
+         py[below+l] = drive[3][l]*x + drive[4][l]*y + drive[5][l]*z;
+         pz[below+l] = drive[6][l]*x + drive[7][l]*y + drive[8][l]*z;
+      }
+      for(int l = 0; l < LANES; l++){
+         if((px[top+l] - px[below+l] != 0) || (py[top+l] - py[below+l] != 0) ||
+            (pz[top+l] - pz[below+l] != 0))
+            isOscillating[l] = 1;
+         px[top+l] = px[below+l];
+         py[top+l] = py[below+l];
+         pz[top+l] = pz[below+l];
+         py[below+l] -= waistDrop;
+         
+         if(yMin[l] > py[top+l]){
+            yMin[l] = py[top+l];
+            minVertex[l] = i;
+         }
+         if(yMax[l] < py[top+l]){
+            yMax[l] = py[top+l];
+            maxVertex[l] = i;
+         }
+      }
+   }
+   
+   for(int l = 0; l < LANES; l++){
+      if(!isOscillating[l]) continue;
+      int maxV = maxVertex[l]*LANES + l, minV = minVertex[l]*LANES + l;
+      float mag = sqrt(pow(px[maxV] - px[minV],2) + pow(py[maxV] - py[minV],2) +
+                       pow(pz[maxV] - pz[minV],2));
+      if(mag != 0){
+         float ax = (px[maxV] - px[minV])/(10*mag);
+         float ay = (py[maxV] - py[minV])/(10*mag);
+         float az = (pz[maxV] - pz[minV])/(10*mag);
+         //applies the oscillatory acceleration to the top row of free-motion vertices
+         for(int i = 0; i < xRes; i++){
+            const int free = (2*xRes + i)*LANES + l;
+            vx[free] += Skirt::Hv*ax;
+            vy[free] += Skirt::Hv*ay;
+            vz[free] += Skirt::Hv*az;
+         }
+      }
+   }
+}
+
+//::KERNEL SELECTION:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the batch kernels compiled for the baseline instruction set (SSE2 on x86-64)
+ */
+const BatchKernels &baselineBatchKernels()
+{
+   static const BatchKernels kernels = { "baseline", laneSpringForces, laneIntegrate, laneNormals };
+   return kernels;
+}
+
+/* returns the fastest batch kernels supported by this CPU
+ */
+const BatchKernels &bestBatchKernels()
+{
+   return cpuHasAVX2() ? avx2BatchKernels() : baselineBatchKernels();
+}
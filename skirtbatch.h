@@ -0,0 +1,141 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtbatch.h - Interface for the SkirtBatch class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SKIRTBATCH_H
+#define SKIRTBATCH_H
+
+#include "skirt.h"
+#include "aligned.h"
+
+/* The loops that step one pack of a SkirtBatch, compiled for one instruction set (see
+ * batchlanes.h). All sets give the same results
+ */
+struct BatchKernels
+{
+   //name of the instruction set compiled for ("baseline" or "avx2")
+   const char *name;
+   //accumulates the force of the springs into force, those on the row below into forceBelow
+   void (*springForces)(const SpringArray &springs, int xRes, int yRes, const GLfloat *position,
+                        GLfloat *force, GLfloat *forceBelow);
+   //integrates the velocities and then the positions of the free rows by steps hv and hp
+   void (*integrate)(GLfloat *position, GLfloat *velocity, const GLfloat *force,
+                     const GLfloat *forceBelow, const GLfloat *rowKd, int xRes, int yRes,
+                     float hv, float hp, float gravity);
+   //calculates the unit vertex normals
+   void (*vertexNormals)(const GLfloat *position, GLfloat *normals, int xRes, int yRes);
+};
+
+/* Simulates many independent skirts of the same resolution at once, e.g. a crowd of dancers. Each
+ * instance steps the same explicit model as a Skirt and starts from the same state, with its own
+ * amplitude, frequency, phase theta and 2D/3D rotation, but the instances are stored interleaved:
+ * they are grouped into packs of LANES, and every buffer of a pack holds, for each vertex and axis,
+ * the values of all LANES instances side by side. Every loop of a step then runs across the lanes
+ * of one vertex or spring, with the same trip count and no gathers, so the compiler vectorizes it
+ * and each instance costs the same however many there are. The packs are independent, so they are
+ * split across the threads. The instances of an incomplete last pack are padded with still ones
+ */
+class SkirtBatch
+{
+public:
+   //the instances in a pack: as many floats as fill the widest vector registers
+   enum { LANES = ALIGNED_FLOATS };
+   
+   //constructor. count still instances in the same initial state as Skirt(xRes, yRes)
+   SkirtBatch(int count, int xRes = Skirt::DEFAULT_X_RES, int yRes = Skirt::DEFAULT_Y_RES);
+   //destructor
+   ~SkirtBatch();
+   //advances every instance by the given number of explicit steps, then recalculates the normals
+   void step(int steps = 1);
+   
+//::ACCESSORS:://
+   int getCount() const { return count; }
+   int getXRes() const { return xRes; }
+   int getYRes() const { return yRes; }
+   int getVertexCount() const { return xRes*yRes; }
+   int getThreadCount() const { return pool->getThreadCount(); }
+   const BatchKernels &getKernels() const { return *kernels; }
+   GLfloat getAmplitude(int k) const { return amplitude[k]; }
+   GLfloat getFrequency(int k) const { return frequency[k]; }
+   GLfloat getTheta(int k) const { return theta[k]; }
+   bool getIs3DRotation(int k) const { return is3DRotation[k]; }
+   //returns a coordinate of the vertex at column col and row row of instance k
+   GLfloat getX(int k, int col, int row) const { return position[at(k, 0, col, row)]; }
+   GLfloat getY(int k, int col, int row) const { return position[at(k, 1, col, row)]; }
+   GLfloat getZ(int k, int col, int row) const { return position[at(k, 2, col, row)]; }
+   //returns a component of the unit normal at column col and row row of instance k
+   GLfloat getNormalX(int k, int col, int row) const { return normals[at(k, 0, col, row)]; }
+   GLfloat getNormalY(int k, int col, int row) const { return normals[at(k, 1, col, row)]; }
+   GLfloat getNormalZ(int k, int col, int row) const { return normals[at(k, 2, col, row)]; }
+   
+//::MUTATORS:://
+   //changes the animation of instance k to a 2D rotation about the z-axis
+   void rotate2D(int k) { is3DRotation[k] = false; }
+   //changes the animation of instance k to a 3D rotation about the x-axis and the z-axis
+   void rotate3D(int k) { is3DRotation[k] = true; }
+   //sets the amplitude of the motion of instance k, clamped as by Skirt::setAmplitude()
+   void setAmplitude(int k, GLfloat amp);
+   //sets the frequency of the motion of instance k, clamped as by Skirt::setFrequency()
+   void setFrequency(int k, GLfloat freq);
+   //sets the phase of the motion of instance k, in radians
+   void setTheta(int k, GLfloat phase) { theta[k] = phase; }
+   //copies the positions, velocities and normals of a skirt of the batch's resolution into
+   //instance k. Its motion is left as set
+   void setState(int k, const Skirt &skirt);
+   //selects the instruction set the packs are stepped with. Defaults to bestBatchKernels()
+   void setKernels(const BatchKernels &k) { kernels = &k; }
+   //sets the number of threads the packs are split across
+   void setThreadCount(int threads);
+   
+private:
+//::VARIABLES:://
+   const int count, packCount, xRes, yRes;
+   //the buffers of every pack one after another: pack p holds its x, y and z planes, each with the
+   //LANES values of vertex 0, then those of vertex 1 and so on
+   GLfloat *position, *velocity, *force, *forceBelow, *normals;
+   //the springs of a stock Skirt in the order it evaluates them, with their endpoints as vertex
+   //numbers j*xRes + i. Those of row j from crossStart[j] on add their force on b to forceBelow
+   SpringArray springs;
+   GLfloat *initialX, *initialY, *initialZ, *rowKd;
+   GLfloat waistDrop, gravity;
+   //the motion of each instance, and of the padding
+   GLfloat *amplitude, *frequency, *theta;
+   bool *is3DRotation;
+   const BatchKernels *kernels;
+   ThreadPool *pool;
+   MemberJob<SkirtBatch> stepJob;
+   int stepCount;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //returns the index of lane 0 of vertex v along axis c of pack p into the buffers
+   int at(int p, int c, int v) const { return ((p*3 + c)*getVertexCount() + v)*LANES; }
+   //returns the index of column col and row row along axis c of instance k into the buffers
+   int at(int k, int c, int col, int row) const { return at(k/LANES, c, row*xRes + col) + k%LANES; }
+   //steps the packs [firstPack, endPack) by stepCount explicit steps and recalculates their normals
+   void stepPacks(int firstPack, int endPack);
+   //calculates the oscillatory acceleration of each instance of pack p, as
+   //Skirt::calcOscillatoryAcc()
+   void calcOscillatoryAcc(int p);
+   
+   //not copyable
+   SkirtBatch(const SkirtBatch &);
+   SkirtBatch& operator=(const SkirtBatch &);
+};
+
+//the loops compiled for the baseline instruction set, and for AVX2 (the baseline set when not
+//built for it). Only use the AVX2 set when cpuHasAVX2()
+const BatchKernels &baselineBatchKernels();
+const BatchKernels &avx2BatchKernels();
+//returns the fastest batch kernels supported by this CPU
+const BatchKernels &bestBatchKernels();
+
+#endif // SKIRTBATCH_H
@@ -0,0 +1,35 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtbatch_avx2.cpp - The SkirtBatch lane loops compiled for AVX2
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirtbatch.h"
+#if defined(__AVX2__)
+#include "batchlanes.h"
+
+/* returns the batch kernels compiled for AVX2, one pack of 8 lanes per instruction
+ */
+const BatchKernels &avx2BatchKernels()
+{
+   static const BatchKernels kernels = { "avx2", laneSpringForces, laneIntegrate, laneNormals };
+   return kernels;
+}
+
+#else
+
+/* returns the baseline batch kernels; this compiler cannot target AVX2
+ */
+const BatchKernels &avx2BatchKernels()
+{
+   return baselineBatchKernels();
+}
+
+#endif // __AVX2__
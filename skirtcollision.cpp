@@ -0,0 +1,218 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtcollision.cpp - Implementation for the Skirt class (collisions)
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "spatialhash.h"
+#include <cmath> //used for sqrt()
+#include <cstdlib> //used for abs()
+
+using namespace std;
+
+//::CONSTANTS:://
+//the body stands in the skirt as it hangs, the hips across the long axis of the waist and the legs
+//reaching below the hem
+const Skirt::Capsule Skirt::REST_BODY[Skirt::BODY_CAPSULES] = {
+   { { 0, -0.95, -0.3 }, { 0, -0.95, 0.3 }, 0.3 },
+   { { 0, -0.95, -0.25 }, { 0, -3.6, -0.25 }, 0.18 },
+   { { 0, -0.95, 0.25 }, { 0, -3.6, 0.25 }, 0.18 } };
+const float Skirt::BODY_SKIN = 0.02, Skirt::BODY_FRICTION = 0.5, Skirt::AMP_MAX_BODY = 60,
+            Skirt::SELF_THICKNESS = 0.5;
+const int   Skirt::SELF_EXCLUDED_RING = 2;
+
+/* returns the largest amplitude allowed. Without the body the skirt swings through where the legs
+ * would be beyond AMP_MAX; with it, it is held out and may swing to AMP_MAX_BODY. The body is not
+ * resolved by the explicit integrator, so it keeps AMP_MAX
+ */
+GLfloat Skirt::getMaxAmplitude() const
+{
+   return isBodyResolved() ? AMP_MAX_BODY : AMP_MAX;
+}
+
+/* selects the collisions resolved after each step by their Collisions flags. The hash of the self
+ * collisions is built the first time they are selected and kept from then on. The body is placed
+ * by the drive of the next step, as if it had been there all along, and the amplitude is clamped
+ * to what is allowed without it
+ */
+void Skirt::setCollisions(int flags)
+{
+   if(!(collisions & BODY_COLLISIONS)) isBodyPlaced = false;
+   collisions = flags & (BODY_COLLISIONS | SELF_COLLISIONS);
+   if((collisions & SELF_COLLISIONS) && !selfHash){
+      int count = (yRes-2)*xRes;
+      freeVertices = new int[count];
+      rowOf = new int[stride*yRes];
+      for(int j = 0; j < yRes; j++){
+         for(int i = 0; i < stride; i++) rowOf[at(i,j)] = j;
+         if(j >= 2)
+            for(int i = 0; i < xRes; i++) freeVertices[(j-2)*xRes + i] = at(i,j);
+      }
+      selfHash = new SpatialHash(count, SELF_THICKNESS*restLength);
+   }
+   setAmplitude(amplitude);
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* resolves the collisions selected by setCollisions() once the positions of a step are updated:
+ * the free rows are moved out of the body if isBodyResolved(), then the hash of their vertices is
+ * rebuilt and the vertices found too close to one another are moved apart. Every pass writes only
+ * the rows it is given, so the rows split across the threads as in the rest of the step
+ */
+void Skirt::collide()
+{
+   if(isBodyResolved()) pool->parallelFor(bodyJob, 2, yRes);
+   if(collisions & SELF_COLLISIONS){
+      selfHash->build(position, freeVertices, (yRes-2)*xRes);
+      pool->parallelFor(contactJob, 2, yRes);
+      pool->parallelFor(separationJob, 2, yRes);
+   }
+}
+
+/* places the body by the rotation matrix of the drive, so it turns with the waist, keeping where
+ * it was in lastBody for the speed it hits the skirt at
+ */
+void Skirt::placeBody(const float drive[9])
+{
+   for(int c = 0; c < BODY_CAPSULES; c++){
+      lastBody[c] = body[c];
+      const Vector &a = REST_BODY[c].a, &b = REST_BODY[c].b;
+      body[c].a.x = drive[0]*a.x + drive[1]*a.y + drive[2]*a.z;
+      body[c].a.y = drive[3]*a.x + drive[4]*a.y + drive[5]*a.z;
+      body[c].a.z = drive[6]*a.x + drive[7]*a.y + drive[8]*a.z;
+      body[c].b.x = drive[0]*b.x + drive[1]*b.y + drive[2]*b.z;
+      body[c].b.y = drive[3]*b.x + drive[4]*b.y + drive[5]*b.z;
+      body[c].b.z = drive[6]*b.x + drive[7]*b.y + drive[8]*b.z;
+      body[c].radius = REST_BODY[c].radius;
+      if(!isBodyPlaced) lastBody[c] = body[c];
+   }
+   isBodyPlaced = true;
+}
+
+/* moves the vertices of rows [firstRow, endRow) out of the body: a vertex closer than BODY_SKIN to
+ * a capsule is put back at that distance from its surface, and of its velocity relative to the body
+ * there loses the part heading in and BODY_FRICTION of the rest. Under XPBD the velocities are
+ * derived from the moves afterwards
+ */
+void Skirt::collideBodyRows(int firstRow, int endRow)
+{
+   const bool isVelocityDerived = (integrator == XPBD);
+   const GLfloat inverseHp = 1/(Hp*getStepsPerUpdate());
+   
+   for(int c = 0; c < BODY_CAPSULES; c++){
+      const Capsule &capsule = body[c], &last = lastBody[c];
+      GLfloat ex = capsule.b.x - capsule.a.x, ey = capsule.b.y - capsule.a.y,
+              ez = capsule.b.z - capsule.a.z;
+      GLfloat inverseLengthSq = 1/(ex*ex + ey*ey + ez*ez), reach = capsule.radius + BODY_SKIN;
+      //the velocities of the ends of the segment over the step
+      GLfloat ax = inverseHp*(capsule.a.x - last.a.x), ay = inverseHp*(capsule.a.y - last.a.y),
+              az = inverseHp*(capsule.a.z - last.a.z);
+      GLfloat bx = inverseHp*(capsule.b.x - last.b.x), by = inverseHp*(capsule.b.y - last.b.y),
+              bz = inverseHp*(capsule.b.z - last.b.z);
+      for(int j = firstRow; j < endRow; j++){
+         for(int v = at(0,j); v < at(xRes,j); v++){
+            GLfloat px = position.x[v], py = position.y[v], pz = position.z[v];
+            GLfloat t = ((px - capsule.a.x)*ex + (py - capsule.a.y)*ey +
+                         (pz - capsule.a.z)*ez)*inverseLengthSq;
+            t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+            GLfloat dx = px - (capsule.a.x + t*ex), dy = py - (capsule.a.y + t*ey),
+                    dz = pz - (capsule.a.z + t*ez);
+            GLfloat distSq = dx*dx + dy*dy + dz*dz;
+            if(distSq >= reach*reach || distSq == 0) continue;
+            GLfloat dist = sqrt(distSq), push = reach/dist - 1;
+            position.x[v] += push*dx;
+            position.y[v] += push*dy;
+            position.z[v] += push*dz;
+            if(isVelocityDerived) continue;
+            //the velocity relative to the body there loses its inward part and some of the rest
+            GLfloat wx = ax + t*(bx - ax), wy = ay + t*(by - ay), wz = az + t*(bz - az);
+            GLfloat rx = velocity.x[v] - wx, ry = velocity.y[v] - wy, rz = velocity.z[v] - wz;
+            GLfloat inward = (rx*dx + ry*dy + rz*dz)/dist;
+            inward = (inward < 0) ? inward/dist : 0;
+            rx -= inward*dx; ry -= inward*dy; rz -= inward*dz;
+            velocity.x[v] = wx + (1 - BODY_FRICTION)*rx;
+            velocity.y[v] = wy + (1 - BODY_FRICTION)*ry;
+            velocity.z[v] = wz + (1 - BODY_FRICTION)*rz;
+         }
+      }
+   }
+}
+
+/* finds the vertices of rows [firstRow, endRow) closer to another than the thickness, the radius of
+ * the hash, and accumulates the corrections that separate them into force (the positions) and
+ * forceBelow (the velocities), zero for the rest. Each vertex of a pair moves half the overlap
+ * away from the other and loses half their velocity toward each other, averaged over its contacts
+ * so a vertex in a crowd is not pushed once for every neighbour. Vertices within
+ * SELF_EXCLUDED_RING of each other in the mesh are held apart by their springs and never collide.
+ * Each vertex reads the others and writes only itself, in the order of the hash, so the
+ * corrections do not depend on how the rows are split
+ */
+void Skirt::findContactRows(int firstRow, int endRow)
+{
+   const GLfloat thickness = selfHash->getRadius();
+   int buckets[SpatialHash::NEIGHBOUR_CELLS];
+   
+   for(int j = firstRow; j < endRow; j++){
+      for(int i = 0; i < stride; i++){
+         int v = at(i,j), contacts = 0;
+         GLfloat px = 0, py = 0, pz = 0, vx = 0, vy = 0, vz = 0;
+         //the padding at the end of a row is never moved
+         int found = (i < xRes) ? selfHash->findBuckets(position.x[v], position.y[v],
+                                                        position.z[v], buckets) : 0;
+         for(int b = 0; b < found; b++){
+            const int *end = selfHash->bucketEnd(buckets[b]);
+            for(const int *other = selfHash->bucketBegin(buckets[b]); other != end; other++){
+               int u = *other;
+               GLfloat dx = position.x[v] - position.x[u], dy = position.y[v] - position.y[u],
+                       dz = position.z[v] - position.z[u];
+               GLfloat distSq = dx*dx + dy*dy + dz*dz;
+               if(distSq >= thickness*thickness || distSq == 0) continue;
+               int row = rowOf[u], columns = abs(u - at(0,row) - i);
+               if(columns > xRes - columns) columns = xRes - columns;
+               if(columns <= SELF_EXCLUDED_RING && abs(row - j) <= SELF_EXCLUDED_RING) continue;
+               GLfloat dist = sqrt(distSq);
+               GLfloat nx = dx/dist, ny = dy/dist, nz = dz/dist, push = (thickness - dist)/2;
+               px += push*nx;
+               py += push*ny;
+               pz += push*nz;
+               GLfloat closing = (velocity.x[v] - velocity.x[u])*nx +
+                                 (velocity.y[v] - velocity.y[u])*ny +
+                                 (velocity.z[v] - velocity.z[u])*nz;
+               if(closing < 0){
+                  vx -= closing/2*nx;
+                  vy -= closing/2*ny;
+                  vz -= closing/2*nz;
+               }
+               contacts++;
+            }
+         }
+         GLfloat share = contacts ? 1.0f/contacts : 0;
+         force.x[v] = share*px;
+         force.y[v] = share*py;
+         force.z[v] = share*pz;
+         forceBelow.x[v] = share*vx;
+         forceBelow.y[v] = share*vy;
+         forceBelow.z[v] = share*vz;
+      }
+   }
+}
+
+/* applies the corrections of findContactRows() to the vertices of rows [firstRow, endRow), and to
+ * their velocities unless XPBD derives those from the moves
+ */
+void Skirt::separateRows(int firstRow, int endRow)
+{
+   kernels->integratePosition(position, force, at(0,firstRow), (endRow - firstRow)*stride, 1);
+   if(integrator != XPBD)
+      kernels->integratePosition(velocity, forceBelow, at(0,firstRow), (endRow - firstRow)*stride,
+                                 1);
+}
@@ -0,0 +1,136 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtdraw.cpp - Rendering half of the Skirt class implementation. Kept apart from skirt.cpp
+         so the simulation can be linked without OpenGL (see headless.cpp).
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "texturecache.h"
+#include <cstdlib> //used for exit() and EXIT_FAILURE
+#include <cmath> //used for sqrt()
+#include <GL/glu.h> //used for gluBuild2DMipmaps()
+
+//the texture image, and the cache of its mip chain
+static const char *TEXTURE_PATH = "assets/skirt_texture.ppm";
+static const char *TEXTURE_CACHE_PATH = "assets/skirt_texture.mip";
+
+//returns true if n is a power of two
+static bool isPowerOfTwo(int n);
+
+/* draws a frame of the skirt mesh using triangle strips, interpolated by alpha from the state
+ * before the last update to the state after it. Reads nothing but the frame and the resolution
+ */
+void Skirt::draw(const SkirtFrame &frame, GLfloat alpha) const
+{
+   for(int j = 0; j < yRes-1; j++){
+      int top = at(0,j), bottom = at(0,j+1);
+      glBegin(GL_TRIANGLE_STRIP);
+      glTexCoord2f(0, GLfloat(j)/yRes);
+      drawVertex(frame, top, alpha);
+      glTexCoord2f(0, GLfloat(j+1)/yRes);
+      drawVertex(frame, bottom, alpha);
+      for(int i = 1; i < xRes; i++){
+         int v = at(i,j), w = at(i,j+1);
+         drawNormal(frame, v, alpha);
+         glTexCoord2f(GLfloat(i)/(xRes+10), GLfloat(j)/yRes);
+         drawVertex(frame, v, alpha);
+         drawNormal(frame, w, alpha);
+         glTexCoord2f(GLfloat(i)/(xRes+10), GLfloat(j+1)/yRes);
+         drawVertex(frame, w, alpha);
+      }
+      drawNormal(frame, top, alpha);
+      drawVertex(frame, top, alpha);
+      drawNormal(frame, bottom, alpha);
+      drawVertex(frame, bottom, alpha);
+      glEnd();
+   }
+}
+
+/* loads a texture for the skirt. The texture image must be a P6 RAW ppm. With isCached, a power of
+ * two image is uploaded level by level from the mip chain of its TextureCache, built at the first
+ * run after the image changes; otherwise gluBuild2DMipmaps() builds the chain at every startup.
+ * Returns true if the texture came from the cache
+ */
+bool Skirt::loadTexture(bool isCached) const
+{
+   GLuint texture;
+   
+   glGenTextures(1, &texture);
+   glBindTexture(GL_TEXTURE_2D, texture);
+   //using modulate to mix texture with color for shading
+   glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   
+   if(isCached){
+      TextureCache cache(TEXTURE_PATH, TEXTURE_CACHE_PATH);
+      //gluBuild2DMipmaps() rescales any other size to a power of two first, which the cache skips
+      if(cache.isLoaded() && isPowerOfTwo(cache.getWidth(0)) && isPowerOfTwo(cache.getHeight(0))){
+         //the levels are tightly packed rows of 3 bytes per pixel
+         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+         for(int l = 0; l < cache.getLevelCount(); l++)
+            glTexImage2D(GL_TEXTURE_2D, l, 3, cache.getWidth(l), cache.getHeight(l), 0, GL_RGB,
+                         GL_UNSIGNED_BYTE, cache.getPixels(l));
+         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+         return true;
+      }
+   }
+   
+   int texWidth, texHeight;
+   unsigned char *image = TextureCache::readPPM(TEXTURE_PATH, texWidth, texHeight);
+   if(!image) exit(EXIT_FAILURE);
+   //initialize texturing using image pixel data
+   gluBuild2DMipmaps(GL_TEXTURE_2D, 3, texWidth,  texHeight, GL_RGB, GL_UNSIGNED_BYTE, image);
+   delete [] image;
+   return false;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* issues the unit normal of vertex v of a frame, interpolated by alpha from its last state to its
+ * current one. A blend of two unit normals is shorter than unit, and GL does not rescale normals,
+ * so it is normalized again
+ */
+void Skirt::drawNormal(const SkirtFrame &frame, int v, GLfloat alpha) const
+{
+   const VectorArray &last = frame.lastNormals, &next = frame.normals;
+   GLfloat x = last.x[v] + alpha*(next.x[v] - last.x[v]);
+   GLfloat y = last.y[v] + alpha*(next.y[v] - last.y[v]);
+   GLfloat z = last.z[v] + alpha*(next.z[v] - last.z[v]);
+   GLfloat lengthSq = x*x + y*y + z*z;
+   
+   if(lengthSq > 0){
+      GLfloat inverse = 1/sqrt(lengthSq);
+      x *= inverse;
+      y *= inverse;
+      z *= inverse;
+   }
+   glNormal3f(x, y, z);
+}
+
+/* issues vertex v of a frame, interpolated by alpha from its last position to its current one
+ */
+void Skirt::drawVertex(const SkirtFrame &frame, int v, GLfloat alpha) const
+{
+   const VectorArray &last = frame.lastPosition, &next = frame.position;
+   
+   glVertex3f(last.x[v] + alpha*(next.x[v] - last.x[v]), last.y[v] + alpha*(next.y[v] - last.y[v]),
+              last.z[v] + alpha*(next.z[v] - last.z[v]));
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns true if n is a power of two
+ */
+bool isPowerOfTwo(int n)
+{
+   return n > 0 && !(n & (n-1));
+}
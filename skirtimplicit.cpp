@@ -0,0 +1,176 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtimplicit.cpp - Implementation for the Skirt class (implicit integration)
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "blockmatrix.h"
+#include "profiler.h"
+#include <cmath> //used for sqrt()
+
+using namespace std;
+
+//returns the stiffness matrix of the spring from vertex a to vertex b, up to its stiffness
+static SymBlock springJacobian(const VectorArray &position, int a, int b, GLfloat rest);
+//returns the dot product of x and y over the entries [first, end)
+static double dot(const VectorArray &x, const VectorArray &y, int first, int end);
+//computes y += s*x over the entries [first, end)
+static void addScaled(VectorArray &y, const VectorArray &x, double s, int first, int end);
+
+/* sets how many explicit steps one implicit or XPBD step covers, i.e. how far updateSkirt()
+ * advances the simulation in IMPLICIT and XPBD mode
+ */
+void Skirt::setImplicitStep(int explicitSteps)
+{
+   implicitStep = (explicitSteps < 1) ? 1 : explicitSteps;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* updates the vertex velocities by one backward Euler step of implicitStep explicit steps. The
+ * spring forces are taken at the end of the step by linearizing them about the current positions,
+ * which keeps the step stable however stiff the springs or long the step
+ */
+void Skirt::updateVelocityImplicit()
+{
+   //Velocity Update: Oscillation
+   calcOscillatoryAcc(implicitStep);
+   PROFILE_LAP(DRIVE);
+   pool->parallelFor(springJob, 1, yRes);
+   PROFILE_LAP(SPRINGS);
+   //Velocity Update: Spring Forces, Gravity and Spring Damping
+   assembleSystem(Hv*implicitStep, Hp*implicitStep);
+   PROFILE_LAP(ASSEMBLE);
+   solveSystem();
+   PROFILE_LAP(SOLVE);
+}
+
+/* assembles the linear system of an implicit step of velocity step hv and position step hp, and
+ * its right-hand side into residual. With F the spring forces at the current positions, K their
+ * Jacobian and n = implicitStep, the new velocity v' of a free vertex satisfies
+ *    (1 + n*kd)v' = v + hv*(F + gravity + hp*Kv')
+ * The force on a vertex is its row's stiffness ks times a sum over its springs, each weighted for
+ * its direction, so K = -ks*L with L symmetric; dividing each vertex's equation by its ks gives
+ * the symmetric positive definite
+ *    ((1 + n*kd)/ks)v' + hv*hp*Lv' = (v + hv*(F + gravity))/ks
+ * solved by solveSystem(). The pinned rows are placed before the step, so they add only to the
+ * diagonal blocks of their neighbours
+ */
+void Skirt::assembleSystem(GLfloat hv, GLfloat hp)
+{
+   const GLfloat h2 = hv*hp;
+   const int firstFree = springs.rowStart[2];
+   
+   for(int j = 2; j < yRes; j++){
+      GLfloat ks = rowStiffness(j), scale = (1 + implicitStep*rowDamping(j))/ks;
+      for(int i = 0; i < stride; i++){
+         int v = at(i,j);
+         //the padding at the end of a row solves to zero
+         if(i >= xRes){
+            system->diagonal(v) = BlockMatrix::scaledIdentity(1);
+            residual.x[v] = residual.y[v] = residual.z[v] = 0;
+            continue;
+         }
+         system->diagonal(v) = BlockMatrix::scaledIdentity(scale);
+         residual.x[v] = (velocity.x[v] + hv*(force.x[v] + forceBelow.x[v]))/ks;
+         residual.y[v] = (velocity.y[v] + hv*(force.y[v] + forceBelow.y[v] + gravity))/ks;
+         residual.z[v] = (velocity.z[v] + hv*(force.z[v] + forceBelow.z[v]))/ks;
+      }
+   }
+   for(int s = springs.rowStart[1]; s < springs.count; s++){
+      int a = springs.a[s], b = springs.b[s];
+      SymBlock k = springJacobian(position, a, b, springs.rest[s]);
+      GLfloat weighted = h2*(springs.ksB[s]/rowStiffness(b/stride));
+      BlockMatrix::addScaled(system->diagonal(b), k, weighted);
+      if(s >= firstFree){
+         BlockMatrix::addScaled(system->diagonal(a), k, weighted);
+         SymBlock &off = system->offDiagonal(s - firstFree);
+         off = BlockMatrix::scaledIdentity(0);
+         BlockMatrix::addScaled(off, k, -weighted);
+      }
+   }
+   system->factorDiagonal();
+}
+
+/* solves the assembled system for the new velocities by conjugate gradient with a block Jacobi
+ * preconditioner, starting from the current velocities. Stops once the residual has shrunk to
+ * CG_TOLERANCE of the right-hand side or after CG_MAX_ITERATIONS
+ */
+void Skirt::solveSystem()
+{
+   const int first = system->getFirst(), end = system->getEnd();
+   double target = CG_TOLERANCE*CG_TOLERANCE*dot(residual, residual, first, end);
+   
+   system->multiply(velocity, product);
+   addScaled(residual, product, -1, first, end);
+   system->precondition(residual, direction);
+   double rz = dot(residual, direction, first, end);
+   for(solverIterations = 0; solverIterations < CG_MAX_ITERATIONS; solverIterations++){
+      if(dot(residual, residual, first, end) <= target) break;
+      system->multiply(direction, product);
+      double alpha = rz/dot(direction, product, first, end);
+      addScaled(velocity, direction, alpha, first, end);
+      addScaled(residual, product, -alpha, first, end);
+      system->precondition(residual, preconditioned);
+      double rzNext = dot(residual, preconditioned, first, end);
+      //direction = preconditioned + (rzNext/rz)*direction
+      for(int v = first; v < end; v++){
+         direction.x[v] = preconditioned.x[v] + (rzNext/rz)*direction.x[v];
+         direction.y[v] = preconditioned.y[v] + (rzNext/rz)*direction.y[v];
+         direction.z[v] = preconditioned.z[v] + (rzNext/rz)*direction.z[v];
+      }
+      rz = rzNext;
+   }
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the stiffness matrix of the spring from vertex a to vertex b, up to its stiffness: unit
+ * stiffness along the spring and, while it is stretched, 1 - rest/length across it. The pull of
+ * scalarSpringForces() has a non-symmetric Jacobian, so the implicit step linearizes it as a
+ * Hooke's law spring; the two agree along the axes. Compressed springs get no stiffness across,
+ * which keeps the matrix positive semi-definite
+ */
+SymBlock springJacobian(const VectorArray &position, int a, int b, GLfloat rest)
+{
+   float dx = position.x[a] - position.x[b];
+   float dy = position.y[a] - position.y[b];
+   float dz = position.z[a] - position.z[b];
+   float length = sqrt(dx*dx + dy*dy + dz*dz);
+   float across = (length > rest) ? 1 - rest/length : 0;
+   float along = (1 - across)/(length*length);
+   SymBlock k = { across + along*dx*dx, along*dx*dy, along*dx*dz,
+                  across + along*dy*dy, along*dy*dz, across + along*dz*dz };
+   
+   return k;
+}
+
+/* returns the dot product of x and y over the entries [first, end)
+ */
+double dot(const VectorArray &x, const VectorArray &y, int first, int end)
+{
+   double sum = 0;
+   
+   for(int v = first; v < end; v++)
+      sum += x.x[v]*y.x[v] + x.y[v]*y.y[v] + x.z[v]*y.z[v];
+   return sum;
+}
+
+/* computes y += s*x over the entries [first, end)
+ */
+void addScaled(VectorArray &y, const VectorArray &x, double s, int first, int end)
+{
+   for(int v = first; v < end; v++){
+      y.x[v] += s*x.x[v];
+      y.y[v] += s*x.y[v];
+      y.z[v] += s*x.z[v];
+   }
+}
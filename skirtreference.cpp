@@ -0,0 +1,434 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtreference.cpp - Implementation for the SkirtReference class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirtreference.h"
+#include "quaternion.h"
+#include <cmath> //used for pow(), sqrt(), fabs(), sin(), cos()
+#include <cfloat> //used for FLT_MIN, FLT_EPSILON
+#include <limits> //used for numeric_limits<float>::infinity()
+
+using namespace std;
+
+/* SkirtReference - CONSTRUCTOR
+ */
+SkirtReference::SkirtReference(const Skirt &skirt) : xRes(skirt.xRes), yRes(skirt.yRes)
+{
+   initialPos = new Vector[xRes];
+   position = new Vector*[xRes];
+   velocity = new Vector*[xRes];
+   vertexNormals = new Vector*[xRes];
+   for(int i = 0; i < xRes; i++){
+      position[i] = new Vector[yRes];
+      velocity[i] = new Vector[yRes];
+      vertexNormals[i] = new Vector[yRes];
+      initialPos[i].x = skirt.initialPos.x[i];
+      initialPos[i].y = skirt.initialPos.y[i];
+      initialPos[i].z = skirt.initialPos.z[i];
+   }
+   rowKs = new GLfloat[yRes];
+   rowKd = new GLfloat[yRes];
+   for(int j = 0; j < yRes; j++){
+      rowKs[j] = skirt.rowStiffness(j);
+      rowKd[j] = skirt.rowDamping(j);
+   }
+   acrossLength = skirt.acrossLength;
+   downLength = skirt.downLength;
+   diagLength = skirt.diagLength;
+   acrossWeight = skirt.acrossWeight;
+   downWeight = skirt.downWeight;
+   diagWeight = skirt.diagWeight;
+   gravity = skirt.gravity;
+   waistDrop = skirt.waistDrop;
+   amplitude = skirt.amplitude;
+   frequency = skirt.frequency;
+   is3DRotation = skirt.is3DRotation;
+   isTied = false;
+   setState(skirt);
+}
+
+/* SkirtReference - DESTRUCTOR
+ */
+SkirtReference::~SkirtReference()
+{
+   for(int i = 0; i < xRes; i++){
+      delete [] position[i];
+      delete [] velocity[i];
+      delete [] vertexNormals[i];
+   }
+   delete [] initialPos;
+   delete [] position;
+   delete [] velocity;
+   delete [] vertexNormals;
+   delete [] rowKs;
+   delete [] rowKd;
+}
+
+/* advances the simulation by one explicit step, as Skirt::updateSkirt() does with the EXPLICIT
+ * integrator
+ */
+void SkirtReference::updateSkirt()
+{
+   updateVelocity();
+   updatePosition();
+   calcNorms();
+}
+
+/* takes the positions, velocities, normals and phase of a skirt of the same resolution
+ */
+void SkirtReference::setState(const Skirt &skirt)
+{
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         int v = skirt.at(i,j);
+         position[i][j].x = skirt.position.x[v];
+         position[i][j].y = skirt.position.y[v];
+         position[i][j].z = skirt.position.z[v];
+         velocity[i][j].x = skirt.velocity.x[v];
+         velocity[i][j].y = skirt.velocity.y[v];
+         velocity[i][j].z = skirt.velocity.z[v];
+         vertexNormals[i][j].x = skirt.vertexNormals.x[v];
+         vertexNormals[i][j].y = skirt.vertexNormals.y[v];
+         vertexNormals[i][j].z = skirt.vertexNormals.z[v];
+      }
+   }
+   theta = skirt.theta;
+}
+
+/* gives a skirt of the same resolution its positions, velocities, normals and phase
+ */
+void SkirtReference::getState(Skirt &skirt) const
+{
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i < xRes; i++){
+         int v = skirt.at(i,j);
+         skirt.position.x[v] = position[i][j].x;
+         skirt.position.y[v] = position[i][j].y;
+         skirt.position.z[v] = position[i][j].z;
+         skirt.velocity.x[v] = velocity[i][j].x;
+         skirt.velocity.y[v] = velocity[i][j].y;
+         skirt.velocity.z[v] = velocity[i][j].z;
+         skirt.vertexNormals.x[v] = vertexNormals[i][j].x;
+         skirt.vertexNormals.y[v] = vertexNormals[i][j].y;
+         skirt.vertexNormals.z[v] = vertexNormals[i][j].z;
+      }
+   }
+   skirt.theta = theta;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* places the pinned rows by rotating each rest waist vertex by the quaternions of the drive, and
+ * accelerates the top free row toward the waist's steepest direction while it moves, as
+ * Skirt::calcOscillatoryAcc() over one step. The direction runs between the lowest and highest
+ * waist vertices, so it jumps when another vertex takes their place; the step is marked tied when
+ * one is within TIE_ULPS of doing so
+ */
+void SkirtReference::calcOscillatoryAcc()
+{
+   int minVertex = 0, maxVertex = 0;
+   float yMin = numeric_limits<float>::infinity(), yMax = -yMin;
+   bool isOscillating = false;
+   
+   theta += frequency;
+   Quaternion xrot(amplitude*cos(-theta), 1, 0, 0);
+   Quaternion zrot(amplitude*sin(-theta), 0, 0, 1);
+   for(int i = 0; i < xRes; i++){
+      Quaternion p(initialPos[i].x, initialPos[i].y, initialPos[i].z), rot(xrot*p*xrot.inverse());
+      if(is3DRotation) rot = zrot*rot*zrot.inverse();
+      if(!isOscillating && ((position[i][0].x - rot.getX() != 0) ||
+         (position[i][0].y - rot.getY() != 0) || (position[i][0].z - rot.getZ() != 0)))
+         isOscillating = true;
+      
+      position[i][0].x = position[i][1].x = rot.getX();
+      position[i][0].y = position[i][1].y = rot.getY();
+      position[i][0].z = position[i][1].z = rot.getZ();
+      position[i][1].y -= waistDrop;
+      
+      if(yMin > position[i][0].y){
+         yMin = position[i][0].y;
+         minVertex = i;
+      }
+      if(yMax < position[i][0].y){
+         yMax = position[i][0].y;
+         maxVertex = i;
+      }
+   }
+   isTied = false;
+   if(!isOscillating) return;
+   const float minGap = TIE_ULPS*FLT_EPSILON*fabs(yMin), maxGap = TIE_ULPS*FLT_EPSILON*fabs(yMax);
+   for(int i = 0; i < xRes; i++){
+      float y = position[i][0].y;
+      if((i != minVertex && y - yMin <= minGap) || (i != maxVertex && yMax - y <= maxGap))
+         isTied = true;
+   }
+   float mag = sqrt(pow(position[maxVertex][0].x - position[minVertex][0].x,2) +
+                    pow(position[maxVertex][0].y - position[minVertex][0].y,2) +
+                    pow(position[maxVertex][0].z - position[minVertex][0].z,2));
+   if(mag == 0) return;
+   Vector angularForce;
+   angularForce.x = (position[maxVertex][0].x - position[minVertex][0].x)/(10*mag);
+   angularForce.y = (position[maxVertex][0].y - position[minVertex][0].y)/(10*mag);
+   angularForce.z = (position[maxVertex][0].z - position[minVertex][0].z)/(10*mag);
+   //applies the oscillatory acceleration to the top row of free-motion vertices
+   for(int i = 0; i < xRes; i++){
+      velocity[i][2].x += Skirt::Hv*angularForce.x;
+      velocity[i][2].y += Skirt::Hv*angularForce.y;
+      velocity[i][2].z += Skirt::Hv*angularForce.z;
+   }
+}
+
+/* updates the vertex velocities via Euler integration using the spring forces, gravity, and
+ * oscillatory forces as accelerations. Every vertex evaluates its own six springs with the
+ * stiffness of its own row: down and up, left and right across the seam, and the diagonals to the
+ * right below and to the left above. The hem has no springs below
+ */
+void SkirtReference::updateVelocity()
+{
+   float FsBelow, FsAbove, FsLeft, FsRight, FsDiagAbove, FsDiagBelow, ks, kd;
+   
+   //Velocity Update: Oscillation
+   calcOscillatoryAcc();
+   for(int j = 2; j < yRes; j++){
+      ks = rowKs[j];
+      kd = rowKd[j];
+      for(int i = 0; i < xRes; i++){
+         int left = (i == 0) ? xRes-1 : i-1, right = (i == xRes-1) ? 0 : i+1;
+         FsBelow = (j == yRes-1) ? 0 : downWeight*ks*(currentLength(i,j, i,j+1) - downLength);
+         FsAbove = downWeight*ks*(currentLength(i,j, i,j-1) - downLength);
+         FsLeft = acrossWeight*ks*(currentLength(i,j, left,j) - acrossLength);
+         FsRight = acrossWeight*ks*(currentLength(i,j, right,j) - acrossLength);
+         FsDiagBelow = (j == yRes-1) ? 0 :
+                       diagWeight*ks*(currentLength(i,j, right,j+1) - diagLength);
+         FsDiagAbove = diagWeight*ks*(currentLength(i,j, left,j-1) - diagLength);
+         //Velocity Update: Spring Forces
+         velocity[i][j].x +=
+            Skirt::Hv*springX(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
+         velocity[i][j].y +=
+            Skirt::Hv*springY(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
+         velocity[i][j].z +=
+            Skirt::Hv*springZ(i, j, FsBelow, FsAbove, FsLeft, FsRight, FsDiagBelow, FsDiagAbove);
+         //Velocity Update: Gravity
+         velocity[i][j].y += Skirt::Hv*gravity;
+         //Velocity Update: Spring Damping
+         velocity[i][j].x -= kd*velocity[i][j].x;
+         velocity[i][j].y -= kd*velocity[i][j].y;
+         velocity[i][j].z -= kd*velocity[i][j].z;
+      }
+   }
+}
+
+/* updates the vertex positions via Euler integration of the vertex velocities
+ */
+void SkirtReference::updatePosition()
+{
+   for(int j = 1; j < yRes; j++)
+      for(int i = 0; i < xRes; i++){
+         position[i][j].x += Skirt::Hp*velocity[i][j].x;
+         position[i][j].y += Skirt::Hp*velocity[i][j].y;
+         position[i][j].z += Skirt::Hp*velocity[i][j].z;
+      }
+}
+
+/* determines the x components of the spring forces: each spring pulls the vertex toward its
+ * neighbour along x by the share of its force the square of the x part of its direction gives
+ */
+GLfloat SkirtReference::springX(int c, int r, float Fs1, float Fs2, float Fs3, float Fs4,
+                                float Fs5, float Fs6) const
+{
+   int left = (c == 0) ? xRes-1 : c-1, right = (c == xRes-1) ? 0 : c+1;
+   int forceDir = (r == yRes-1) ? 0 : (position[c][r].x - position[c][r+1].x < 0) ? 1 : -1;
+   float Fs1_x, Fs2_x, Fs3_x, Fs4_x, Fs5_x, Fs6_x; //the % of the force in x
+   
+   Fs1_x = (r == yRes-1) ? 0 : forceDir*Fx(c,r, c,r+1);
+   forceDir = (position[c][r].x - position[c][r-1].x < 0) ? 1 : -1;
+   Fs2_x = forceDir*Fx(c,r, c,r-1);
+   forceDir = (position[c][r].x - position[left][r].x < 0) ? 1 : -1;
+   Fs3_x = forceDir*Fx(c,r, left,r);
+   forceDir = (position[c][r].x - position[right][r].x < 0) ? 1 : -1;
+   Fs4_x = forceDir*Fx(c,r, right,r);
+   forceDir = (r == yRes-1) ? 0 : (position[c][r].x - position[right][r+1].x < 0) ? 1 : -1;
+   Fs5_x = (r == yRes-1) ? 0 : forceDir*Fx(c,r, right,r+1);
+   forceDir = (position[c][r].x - position[left][r-1].x < 0) ? 1 : -1;
+   Fs6_x = forceDir*Fx(c,r, left,r-1);
+   
+   return Fs1_x*Fs1 + Fs2_x*Fs2 + Fs3_x*Fs3 + Fs4_x*Fs4 + Fs5_x*Fs5 + Fs6_x*Fs6;
+}
+
+/* determines the y components of the spring forces, as springX() does the x components
+ */
+GLfloat SkirtReference::springY(int c, int r, float Fs1, float Fs2, float Fs3, float Fs4,
+                                float Fs5, float Fs6) const
+{
+   int left = (c == 0) ? xRes-1 : c-1, right = (c == xRes-1) ? 0 : c+1;
+   int forceDir = (r == yRes-1) ? 0 : (position[c][r].y - position[c][r+1].y < 0) ? 1 : -1;
+   float Fs1_y, Fs2_y, Fs3_y, Fs4_y, Fs5_y, Fs6_y; //the % of the force in y
+   
+   Fs1_y = (r == yRes-1) ? 0 : forceDir*Fy(c,r, c,r+1);
+   forceDir = (position[c][r].y - position[c][r-1].y < 0) ? 1 : -1;
+   Fs2_y = forceDir*Fy(c,r, c,r-1);
+   forceDir = (position[c][r].y - position[left][r].y < 0) ? 1 : -1;
+   Fs3_y = forceDir*Fy(c,r, left,r);
+   forceDir = (position[c][r].y - position[right][r].y < 0) ? 1 : -1;
+   Fs4_y = forceDir*Fy(c,r, right,r);
+   forceDir = (r == yRes-1) ? 0 : (position[c][r].y - position[right][r+1].y < 0) ? 1 : -1;
+   Fs5_y = (r == yRes-1) ? 0 : forceDir*Fy(c,r, right,r+1);
+   forceDir = (position[c][r].y - position[left][r-1].y < 0) ? 1 : -1;
+   Fs6_y = forceDir*Fy(c,r, left,r-1);
+   
+   return Fs1_y*Fs1 + Fs2_y*Fs2 + Fs3_y*Fs3 + Fs4_y*Fs4 + Fs5_y*Fs5 + Fs6_y*Fs6;
+}
+
+/* determines the z components of the spring forces, as springX() does the x components
+ */
+GLfloat SkirtReference::springZ(int c, int r, float Fs1, float Fs2, float Fs3, float Fs4,
+                                float Fs5, float Fs6) const
+{
+   int left = (c == 0) ? xRes-1 : c-1, right = (c == xRes-1) ? 0 : c+1;
+   int forceDir = (r == yRes-1) ? 0 : (position[c][r].z - position[c][r+1].z < 0) ? 1 : -1;
+   float Fs1_z, Fs2_z, Fs3_z, Fs4_z, Fs5_z, Fs6_z; //the % of the force in z
+   
+   Fs1_z = (r == yRes-1) ? 0 : forceDir*Fz(c,r, c,r+1);
+   forceDir = (position[c][r].z - position[c][r-1].z < 0) ? 1 : -1;
+   Fs2_z = forceDir*Fz(c,r, c,r-1);
+   forceDir = (position[c][r].z - position[left][r].z < 0) ? 1 : -1;
+   Fs3_z = forceDir*Fz(c,r, left,r);
+   forceDir = (position[c][r].z - position[right][r].z < 0) ? 1 : -1;
+   Fs4_z = forceDir*Fz(c,r, right,r);
+   forceDir = (r == yRes-1) ? 0 : (position[c][r].z - position[right][r+1].z < 0) ? 1 : -1;
+   Fs5_z = (r == yRes-1) ? 0 : forceDir*Fz(c,r, right,r+1);
+   forceDir = (position[c][r].z - position[left][r-1].z < 0) ? 1 : -1;
+   Fs6_z = forceDir*Fz(c,r, left,r-1);
+   
+   return Fs1_z*Fs1 + Fs2_z*Fs2 + Fs3_z*Fs3 + Fs4_z*Fs4 + Fs5_z*Fs5 + Fs6_z*Fs6;
+}
+
+/* helper for springX. Used to determine the percent of a force to give to x
+ */
+GLfloat SkirtReference::Fx(int col1, int row1, int col2, int row2) const
+{
+   float mag = currentLength(col1, row1, col2, row2);
+   return pow((position[col1][row1].x - position[col2][row2].x)/mag, 2);
+}
+
+/* helper for springY. Used to determine the percent of a force to give to y
+ */
+GLfloat SkirtReference::Fy(int col1, int row1, int col2, int row2) const
+{
+   float mag = currentLength(col1, row1, col2, row2);
+   return pow((position[col1][row1].y - position[col2][row2].y)/mag, 2);
+}
+
+/* helper for springZ. Used to determine the percent of a force to give to z
+ */
+GLfloat SkirtReference::Fz(int col1, int row1, int col2, int row2) const
+{
+   float mag = currentLength(col1, row1, col2, row2);
+   return pow((position[col1][row1].z - position[col2][row2].z)/mag, 2);
+}
+
+/* returns the current length of a spring defined by the parameters
+ */
+GLfloat SkirtReference::currentLength(int col1, int row1, int col2, int row2) const
+{
+   return sqrt(pow(position[col1][row1].x - position[col2][row2].x,2) +
+               pow(position[col1][row1].y - position[col2][row2].y,2) +
+               pow(position[col1][row1].z - position[col2][row2].z,2));
+}
+
+/* calculates the unit vertex normals: every quad between two rows is split into two triangles,
+ * whose face normals are added to the normals of their three corners, which are then normalized
+ */
+void SkirtReference::calcNorms()
+{
+   Vector v1, v2;
+   
+   resetNorms();
+   for(int j = 0; j < yRes-1; j++){
+      for(int i = 0; i < xRes; i++){
+         //the quad left of column 0 is the one across the seam
+         int p = (i == 0) ? xRes-1 : i-1;
+         v1.x = position[i][j].x - position[p][j].x;
+         v1.y = position[i][j].y - position[p][j].y;
+         v1.z = position[i][j].z - position[p][j].z;
+         v2.x = position[i][j+1].x - position[p][j].x;
+         v2.y = position[i][j+1].y - position[p][j].y;
+         v2.z = position[i][j+1].z - position[p][j].z;
+         updateVertNorms(calcFaceNorm(v1, v2),
+                         vertexNormals[i][j], vertexNormals[p][j], vertexNormals[i][j+1]);
+         v1.x = position[p][j+1].x - position[p][j].x;
+         v1.y = position[p][j+1].y - position[p][j].y;
+         v1.z = position[p][j+1].z - position[p][j].z;
+         updateVertNorms(calcFaceNorm(v2, v1),
+                         vertexNormals[p][j+1], vertexNormals[p][j], vertexNormals[i][j+1]);
+      }
+   }
+   normalizeNorms();
+}
+
+/* resets the vertex normals to zero so they can be recalculated, every one of them: the seam
+ * column and the hem collect face normals like the rest
+ */
+void SkirtReference::resetNorms()
+{
+   for(int j = 0; j < yRes; j++)
+      for(int i = 0; i < xRes; i++){
+         vertexNormals[i][j].x = 0;
+         vertexNormals[i][j].y = 0;
+         vertexNormals[i][j].z = 0;
+      }
+}
+
+/* calculates the face normals for the triangles used to generate the skirt mesh
+ */
+SkirtReference::Vector SkirtReference::calcFaceNorm(Vector v1, Vector v2) const
+{
+   Vector normal;
+   
+   normal.x = v1.y*v2.z - v1.z*v2.y;
+   normal.y = v1.z*v2.x - v1.x*v2.z;
+   normal.z = v1.x*v2.y - v1.y*v2.x;
+   
+   return normal;
+}
+
+/* updates the normals of the vertices which share the same polygon to include its face normal
+ */
+void SkirtReference::updateVertNorms(Vector faceNorm, Vector &vert1Norm, Vector &vert2Norm,
+                                     Vector &vert3Norm)
+{
+   vert1Norm.x += faceNorm.x;
+   vert1Norm.y += faceNorm.y;
+   vert1Norm.z += faceNorm.z;
+   vert2Norm.x += faceNorm.x;
+   vert2Norm.y += faceNorm.y;
+   vert2Norm.z += faceNorm.z;
+   vert3Norm.x += faceNorm.x;
+   vert3Norm.y += faceNorm.y;
+   vert3Norm.z += faceNorm.z;
+}
+
+/* scales the vertex normals to unit length. A vertex with no area around it gets a zero normal
+ * rather than a NaN
+ */
+void SkirtReference::normalizeNorms()
+{
+   for(int j = 0; j < yRes; j++)
+      for(int i = 0; i < xRes; i++){
+         Vector &n = vertexNormals[i][j];
+         float lengthSq = n.x*n.x + n.y*n.y + n.z*n.z;
+         float inverse = 1/sqrt((lengthSq > FLT_MIN) ? lengthSq : FLT_MIN);
+         n.x *= inverse;
+         n.y *= inverse;
+         n.z *= inverse;
+      }
+}
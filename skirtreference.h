@@ -0,0 +1,116 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtreference.h - Interface for the SkirtReference class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SKIRTREFERENCE_H
+#define SKIRTREFERENCE_H
+
+#include "skirt.h"
+
+/* The explicit step of the Skirt class frozen as the per-vertex solver it started from, as the
+ * reference the optimized solvers (the spring list, the vectorized kernels, the threaded rows,
+ * SkirtT, SkirtBatch) are checked against by clothSimCheck. It shares nothing with them but the
+ * model: each free vertex sums the six springs to its neighbours on the grid itself, one axis at a
+ * time, and the normals are scattered from the faces of the strips into their corners. Only the
+ * parameters of the model (the rest lengths, weights and row profiles of the springs, gravity and
+ * the waist) and the state are taken from a Skirt. Keep it as it is: a change to the model belongs
+ * in Skirt, and here only once every solver has it
+ */
+class SkirtReference
+{
+public:
+   //constructor. Takes the model, state and motion of an explicit skirt
+   SkirtReference(const Skirt &skirt);
+   //destructor
+   ~SkirtReference();
+   //advances the simulation by one explicit step: the drive, the velocities, the positions and the
+   //normals
+   void updateSkirt();
+   //takes the positions, velocities, normals and phase of a skirt of the same resolution
+   void setState(const Skirt &skirt);
+   //gives a skirt of the same resolution its positions, velocities, normals and phase, e.g. for a
+   //checked solver to take a step from
+   void getState(Skirt &skirt) const;
+   
+//::ACCESSORS:://
+   int getXRes() const { return xRes; }
+   int getYRes() const { return yRes; }
+   GLfloat getX(int col, int row) const { return position[col][row].x; }
+   GLfloat getY(int col, int row) const { return position[col][row].y; }
+   GLfloat getZ(int col, int row) const { return position[col][row].z; }
+   GLfloat getNormalX(int col, int row) const { return vertexNormals[col][row].x; }
+   GLfloat getNormalY(int col, int row) const { return vertexNormals[col][row].y; }
+   GLfloat getNormalZ(int col, int row) const { return vertexNormals[col][row].z; }
+   //true if the last step drove the skirt toward a lowest or highest waist vertex that another
+   //was within TIE_ULPS of. The drive then turns on rounding, so a solver may rightly differ
+   bool isDriveTied() const { return isTied; }
+   
+//::CONSTANTS:://
+   static const int TIE_ULPS = 8;
+   
+private:
+//::STRUCTS:://
+   struct Vector { GLfloat x, y, z; };
+   
+//::VARIABLES:://
+   const int xRes, yRes;
+   Vector *initialPos, **position, **velocity, **vertexNormals;
+   //the stiffness and damping of each row, and the rest lengths and stiffness weights of the
+   //springs across, down and along the diagonals
+   GLfloat *rowKs, *rowKd;
+   GLfloat acrossLength, downLength, diagLength, acrossWeight, downWeight, diagWeight;
+   GLfloat gravity, waistDrop, amplitude, frequency, theta;
+   bool is3DRotation, isTied;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //places the pinned rows by the drive and accelerates the top free row, as
+   //Skirt::calcOscillatoryAcc() over one step
+   void calcOscillatoryAcc();
+   //updates the vertex velocities via Euler integration using the spring forces, gravity, and
+   //oscillatory forces as accelerations
+   void updateVelocity();
+   //updates the vertex positions via Euler integration of the vertex velocities
+   void updatePosition();
+   //determines the x components of the spring forces
+   GLfloat springX(int c, int r, float Fs1, float Fs2, float Fs3,
+                                 float Fs4, float Fs5, float Fs6) const;
+   //determines the y components of the spring forces
+   GLfloat springY(int c, int r, float Fs1, float Fs2, float Fs3,
+                                 float Fs4, float Fs5, float Fs6) const;
+   //determines the z components of the spring forces
+   GLfloat springZ(int c, int r, float Fs1, float Fs2, float Fs3,
+                                 float Fs4, float Fs5, float Fs6) const;
+   //helper for springX. Used to determine the percent of a force to give to x
+   GLfloat Fx(int col1, int row1, int col2, int row2) const;
+   //helper for springY. Used to determine the percent of a force to give to y
+   GLfloat Fy(int col1, int row1, int col2, int row2) const;
+   //helper for springZ. Used to determine the percent of a force to give to z
+   GLfloat Fz(int col1, int row1, int col2, int row2) const;
+   //returns the current length of a spring defined by the parameters
+   GLfloat currentLength(int col1, int row1, int col2, int row2) const;
+   //calculates the unit vertex normals
+   void calcNorms();
+   //resets the vertex normals to zero so they can be recalculated
+   void resetNorms();
+   //calculates the face normals for the triangles used to generate the skirt mesh
+   Vector calcFaceNorm(Vector v1, Vector v2) const;
+   //updates the normals of the vertices which share the same polygon to include its face normal
+   void updateVertNorms(Vector faceNorm, Vector &vert1Norm, Vector &vert2Norm, Vector &vert3Norm);
+   //scales the vertex normals to unit length
+   void normalizeNorms();
+   
+   //not copyable
+   SkirtReference(const SkirtReference &);
+   SkirtReference& operator=(const SkirtReference &);
+};
+
+#endif //SKIRTREFERENCE_H
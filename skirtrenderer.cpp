@@ -0,0 +1,214 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtrenderer.cpp - Implementation for the SkirtRenderer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirtrenderer.h"
+#include "profiler.h"
+#include <cstdio> //used for sscanf()
+#include <cmath> //used for sqrt()
+#ifdef _WIN32
+#include <windows.h> //used for wglGetProcAddress()
+#elif defined(CLOTHSIM_EGL)
+#include <EGL/egl.h> //used for eglGetProcAddress()
+#else
+#include <GL/glx.h> //used for glXGetProcAddressARB()
+#endif
+
+//returns the address of an OpenGL entry point of the current context, or 0 if there is none
+static void *getProcAddress(const char *name);
+
+//::CONSTANTS:://
+const GLuint SkirtRenderer::RESTART_INDEX = 0xFFFFFFFF;
+
+/* SkirtRenderer - CONSTRUCTOR
+ */
+SkirtRenderer::SkirtRenderer(const Skirt &skirt) : skirt(skirt), xRes(skirt.getXRes()),
+                                                   yRes(skirt.getYRes()), stride(skirt.getStride())
+{
+   canBuffer = canRestart = isBuffered = false;
+   vertexBuffer = texCoordBuffer = indexBuffer = 0;
+   indexCount = 0;
+}
+
+/* SkirtRenderer - DESTRUCTOR
+ */
+SkirtRenderer::~SkirtRenderer()
+{
+   if(canBuffer){
+      GLuint buffers[] = { vertexBuffer, texCoordBuffer, indexBuffer };
+      deleteBuffers(3, buffers);
+   }
+}
+
+/* builds the buffers in the current GL context, if it supports them. Buffer objects are core in
+ * OpenGL 1.5 and primitive restart in 3.1
+ */
+void SkirtRenderer::init()
+{
+   int major = 1, minor = 0;
+   const char *version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+   if(version) sscanf(version, "%d.%d", &major, &minor);
+   
+   genBuffers = (PFNGLGENBUFFERSPROC)getProcAddress("glGenBuffers");
+   deleteBuffers = (PFNGLDELETEBUFFERSPROC)getProcAddress("glDeleteBuffers");
+   bindBuffer = (PFNGLBINDBUFFERPROC)getProcAddress("glBindBuffer");
+   bufferData = (PFNGLBUFFERDATAPROC)getProcAddress("glBufferData");
+   mapBuffer = (PFNGLMAPBUFFERPROC)getProcAddress("glMapBuffer");
+   unmapBuffer = (PFNGLUNMAPBUFFERPROC)getProcAddress("glUnmapBuffer");
+   primitiveRestartIndex =
+      (PFNGLPRIMITIVERESTARTINDEXPROC)getProcAddress("glPrimitiveRestartIndex");
+   canBuffer = (major > 1 || minor >= 5) && genBuffers && deleteBuffers && bindBuffer &&
+               bufferData && mapBuffer && unmapBuffer;
+   canRestart = canBuffer && (major > 3 || (major == 3 && minor >= 1)) && primitiveRestartIndex;
+   isBuffered = canBuffer;
+   if(!canBuffer) return;
+   
+   GLuint buffers[3];
+   genBuffers(3, buffers);
+   vertexBuffer = buffers[0];
+   texCoordBuffer = buffers[1];
+   indexBuffer = buffers[2];
+   buildStaticBuffers();
+}
+
+/* draws a frame of the skirt interpolated by alpha, as Skirt::draw() does. The vertex buffer
+ * interleaves a position and a normal per vertex
+ */
+void SkirtRenderer::draw(const SkirtFrame &frame, GLfloat alpha)
+{
+   PROFILE_SCOPE(DRAW);
+   
+   if(!isBuffered || !streamVertices(frame, alpha)){
+      skirt.draw(frame, alpha);
+      return;
+   }
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 6*sizeof(GLfloat), 0);
+   glNormalPointer(GL_FLOAT, 6*sizeof(GLfloat), reinterpret_cast<GLvoid*>(3*sizeof(GLfloat)));
+   bindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+   glTexCoordPointer(2, GL_FLOAT, 0, 0);
+   bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+   if(canRestart){
+      glEnable(GL_PRIMITIVE_RESTART);
+      primitiveRestartIndex(RESTART_INDEX);
+      glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+      glDisable(GL_PRIMITIVE_RESTART);
+   }
+   else{
+      //each strip is 2*(xRes+1) indices followed by a restart index
+      for(int j = 0; j < yRes-1; j++)
+         glDrawElements(GL_TRIANGLE_STRIP, 2*(xRes+1), GL_UNSIGNED_INT,
+                        reinterpret_cast<GLvoid*>(j*(2*(xRes+1)+1)*sizeof(GLuint)));
+   }
+   bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   bindBuffer(GL_ARRAY_BUFFER, 0);
+   glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+   glDisableClientState(GL_NORMAL_ARRAY);
+   glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* builds the static texture coordinate and index buffers. The texture coordinates are those
+ * Skirt::draw() gives: column 0 starts at 0, column i at i/(xRes+10), and the closing copy of
+ * column 0 repeats the last column's. Strip j runs down and across between rows j and j+1 and ends
+ * with RESTART_INDEX
+ */
+void SkirtRenderer::buildStaticBuffers()
+{
+   GLfloat *texCoords = new GLfloat[2*yRes*(xRes+1)];
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i <= xRes; i++){
+         int col = (i == xRes) ? xRes-1 : i;
+         texCoords[2*vertexAt(i,j)] = GLfloat(col)/(xRes+10);
+         texCoords[2*vertexAt(i,j)+1] = GLfloat(j)/yRes;
+      }
+   }
+   bindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+   bufferData(GL_ARRAY_BUFFER, 2*yRes*(xRes+1)*sizeof(GLfloat), texCoords, GL_STATIC_DRAW);
+   bindBuffer(GL_ARRAY_BUFFER, 0);
+   delete [] texCoords;
+   
+   indexCount = (yRes-1)*(2*(xRes+1)+1);
+   GLuint *indices = new GLuint[indexCount], *index = indices;
+   for(int j = 0; j < yRes-1; j++){
+      for(int i = 0; i <= xRes; i++){
+         *index++ = vertexAt(i,j);
+         *index++ = vertexAt(i,j+1);
+      }
+      *index++ = RESTART_INDEX;
+   }
+   bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+   bufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount*sizeof(GLuint), indices, GL_STATIC_DRAW);
+   bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   delete [] indices;
+}
+
+/* streams the positions and normals of a frame interpolated by alpha into the vertex buffer, and
+ * leaves it bound. A blend of two unit normals is shorter than unit, and GL does not rescale
+ * normals, so they are normalized again. Reallocating the buffer first orphans the storage the last
+ * frame was drawn from, so mapping it never waits on the GPU. Returns false if the buffer could not
+ * be mapped
+ */
+bool SkirtRenderer::streamVertices(const SkirtFrame &frame, GLfloat alpha)
+{
+   const VectorArray &lastPos = frame.lastPosition, &pos = frame.position;
+   const VectorArray &lastNorm = frame.lastNormals, &norm = frame.normals;
+   const int size = 6*yRes*(xRes+1)*sizeof(GLfloat);
+   
+   bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+   bufferData(GL_ARRAY_BUFFER, size, 0, GL_STREAM_DRAW);
+   GLfloat *out = static_cast<GLfloat*>(mapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
+   if(!out){
+      bindBuffer(GL_ARRAY_BUFFER, 0);
+      return false;
+   }
+   for(int j = 0; j < yRes; j++){
+      for(int i = 0; i <= xRes; i++){
+         int v = j*stride + ((i == xRes) ? 0 : i);
+         out[0] = lastPos.x[v] + alpha*(pos.x[v] - lastPos.x[v]);
+         out[1] = lastPos.y[v] + alpha*(pos.y[v] - lastPos.y[v]);
+         out[2] = lastPos.z[v] + alpha*(pos.z[v] - lastPos.z[v]);
+         GLfloat nx = lastNorm.x[v] + alpha*(norm.x[v] - lastNorm.x[v]);
+         GLfloat ny = lastNorm.y[v] + alpha*(norm.y[v] - lastNorm.y[v]);
+         GLfloat nz = lastNorm.z[v] + alpha*(norm.z[v] - lastNorm.z[v]);
+         GLfloat lengthSq = nx*nx + ny*ny + nz*nz;
+         GLfloat inverse = (lengthSq > 0) ? 1/sqrt(lengthSq) : 1;
+         out[3] = nx*inverse;
+         out[4] = ny*inverse;
+         out[5] = nz*inverse;
+         out += 6;
+      }
+   }
+   if(unmapBuffer(GL_ARRAY_BUFFER)) return true;
+   //the buffer's contents were lost while it was mapped
+   bindBuffer(GL_ARRAY_BUFFER, 0);
+   return false;
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the address of an OpenGL entry point of the current context, or 0 if there is none. Only
+ * the existence of the entry point is checked; init() checks the version for the feature
+ */
+void *getProcAddress(const char *name)
+{
+#ifdef _WIN32
+   return reinterpret_cast<void*>(wglGetProcAddress(name));
+#elif defined(CLOTHSIM_EGL)
+   return reinterpret_cast<void*>(eglGetProcAddress(name));
+#else
+   return reinterpret_cast<void*>(glXGetProcAddressARB(reinterpret_cast<const GLubyte*>(name)));
+#endif
+}
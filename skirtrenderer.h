@@ -0,0 +1,88 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtrenderer.h - Interface for the SkirtRenderer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SKIRTRENDERER_H
+#define SKIRTRENDERER_H
+
+#include "skirt.h"
+#include <GL/gl.h> //used for various gl types and functions
+#include <GL/glext.h> //used for the buffer object function types and constants
+
+/* Draws frames of a Skirt from vertex buffer objects. The texture coordinates and the indices of
+ * the triangle strips never change, so they are built once into static buffers; each frame only
+ * the interpolated positions and normals are streamed into a buffer that is orphaned first, so the
+ * driver never has to wait for the previous frame to finish with it. With primitive restart
+ * (OpenGL 3.1) all the strips are drawn by a single indexed call, otherwise by one call per strip.
+ * Without buffer objects (OpenGL 1.5) it falls back to Skirt::draw().
+ */
+class SkirtRenderer
+{
+public:
+   //constructor. Draws frames of the given skirt. Makes no GL calls until init()
+   SkirtRenderer(const Skirt &skirt);
+   //destructor. Deletes the buffers; the context they were made in must be current
+   ~SkirtRenderer();
+   //builds the buffers in the current GL context, if it supports them
+   void init();
+   //draws a frame of the skirt interpolated by alpha, as Skirt::draw() does
+   void draw(const SkirtFrame &frame, GLfloat alpha);
+   
+//::ACCESSORS:://
+   //returns true if the context supports buffer objects
+   bool getCanBuffer() const { return canBuffer; }
+   //returns true if the context supports primitive restart
+   bool getCanRestart() const { return canRestart; }
+   //returns true if frames are drawn from the buffers rather than by Skirt::draw()
+   bool getIsBuffered() const { return isBuffered; }
+   
+//::MUTATORS:://
+   //selects drawing from the buffers (if supported) or by Skirt::draw()
+   void setBuffered(bool buffered) { isBuffered = buffered && canBuffer; }
+   
+private:
+//::CONSTANTS:://
+   //the index that ends one triangle strip and starts the next
+   static const GLuint RESTART_INDEX;
+   
+//::VARIABLES:://
+   const Skirt &skirt;
+   const int xRes, yRes, stride;
+   bool canBuffer, canRestart, isBuffered;
+   //the streamed positions and normals, the static texture coordinates and strip indices
+   GLuint vertexBuffer, texCoordBuffer, indexBuffer;
+   int indexCount;
+   //the entry points past OpenGL 1.1, looked up at init()
+   PFNGLGENBUFFERSPROC genBuffers;
+   PFNGLDELETEBUFFERSPROC deleteBuffers;
+   PFNGLBINDBUFFERPROC bindBuffer;
+   PFNGLBUFFERDATAPROC bufferData;
+   PFNGLMAPBUFFERPROC mapBuffer;
+   PFNGLUNMAPBUFFERPROC unmapBuffer;
+   PFNGLPRIMITIVERESTARTINDEXPROC primitiveRestartIndex;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //returns the index into the vertex buffers of column col of row row. Column xRes repeats
+   //column 0 to close the cylinder with its own texture coordinates
+   int vertexAt(int col, int row) const { return row*(xRes+1) + col; }
+   //builds the static texture coordinate and index buffers
+   void buildStaticBuffers();
+   //streams the positions and normals of a frame interpolated by alpha into the vertex buffer.
+   //Returns false if the buffer could not be mapped
+   bool streamVertices(const SkirtFrame &frame, GLfloat alpha);
+   
+   //not copyable
+   SkirtRenderer(const SkirtRenderer &);
+   SkirtRenderer& operator=(const SkirtRenderer &);
+};
+
+#endif // SKIRTRENDERER_H
@@ -0,0 +1,264 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtstate.cpp - Implementation for the Skirt class (checkpoints and the rest state)
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "mappedfile.h"
+#include <cmath> //used for fabs()
+#include <cstdio> //used for sprintf()
+#include <cstring> //used for memcpy(), memcmp(), memset(), strlen()
+
+using namespace std;
+
+//the layout of the start of a checkpoint: the resolution, the motion and its phase, the integrator,
+//the collisions, and the air and its wind. It is followed by the capsules of the body where the
+//drive last placed it and where it was the step before, and then the rows of xRes floats of the x,
+//y and z positions and then the x, y and z velocities. The byte order mark rejects a checkpoint
+//from a machine of the other endianness, and the constants one of other physics
+struct StateHeader
+{
+   char magic[8];
+   unsigned int byteOrder;
+   int xRes, yRes, integrator, implicitStep, constraintIterations, is3DRotation;
+   int collisions, isBodyPlaced, isAerodynamic;
+   float amplitude, frequency, theta;
+   float wind[3];
+   float constants[6];
+};
+static const char MAGIC[8] = { 'S', 'K', 'I', 'R', 'T', 'S', 'T', '4' };
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+/* writes a checkpoint of the skirt to path: the positions and velocities, the motion and its
+ * phase, the integrator, the air and its wind, and the collisions with the body as they last
+ * placed it. The rows are
+ * written straight from the buffers, without their padding. Returns false if it could not be
+ * written
+ */
+bool Skirt::saveState(const char *path) const
+{
+   StateHeader header;
+   const int rowCount = 6*yRes, partCount = rowCount + 3;
+   const GLfloat *const components[] = { position.x, position.y, position.z,
+                                         velocity.x, velocity.y, velocity.z };
+   const float constants[] = { GRAVITY, Ks, KsDiag, Kd, Hp, Hv };
+   
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, MAGIC, sizeof(MAGIC));
+   header.byteOrder = BYTE_ORDER_MARK;
+   header.xRes = xRes;
+   header.yRes = yRes;
+   header.integrator = integrator;
+   header.implicitStep = implicitStep;
+   header.constraintIterations = constraintIterations;
+   header.is3DRotation = is3DRotation;
+   header.collisions = collisions;
+   header.isBodyPlaced = isBodyPlaced;
+   header.isAerodynamic = isAerodynamic;
+   header.amplitude = amplitude;
+   header.frequency = frequency;
+   header.theta = theta;
+   header.wind[0] = wind.x;
+   header.wind[1] = wind.y;
+   header.wind[2] = wind.z;
+   memcpy(header.constants, constants, sizeof(constants));
+   
+   const void **parts = new const void*[partCount];
+   size_t *sizes = new size_t[partCount];
+   parts[0] = &header;
+   sizes[0] = sizeof(header);
+   parts[1] = body;
+   sizes[1] = sizeof(body);
+   parts[2] = lastBody;
+   sizes[2] = sizeof(lastBody);
+   for(int c = 0; c < 6; c++){
+      for(int j = 0; j < yRes; j++){
+         parts[3 + c*yRes + j] = components[c] + at(0,j);
+         sizes[3 + c*yRes + j] = xRes*sizeof(GLfloat);
+      }
+   }
+   bool isWritten = MappedFile::write(path, parts, sizes, partCount);
+   delete [] parts;
+   delete [] sizes;
+   return isWritten;
+}
+
+/* restores a checkpoint written by saveState() from a skirt of this resolution, which then steps
+ * on exactly as that one would have, in the same air and wind: nothing else carries over from one
+ * step to the next. Returns false and leaves the skirt as it was if there is none
+ */
+bool Skirt::restoreState(const char *path)
+{
+   return readState(path, true);
+}
+
+/* copies the positions, velocities, normals and phase of a skirt of the same resolution. With the
+ * same motion and integrator, this one then steps on exactly as that one would
+ */
+void Skirt::setState(const Skirt &skirt)
+{
+   copyArray(position, skirt.position);
+   copyArray(velocity, skirt.velocity);
+   copyArray(vertexNormals, skirt.vertexNormals);
+   theta = skirt.theta;
+}
+
+/* steps the skirt with its motion stopped until it hangs at rest in still air, or for at most
+ * maxSteps explicit steps. Every SETTLE_CHECK_STEPS steps it compares the positions with those
+ * before them; a single step moves too little to tell the last slow sag from rounding. The air is
+ * off while it settles, so the rest state does not depend on the wind. Returns the number of
+ * explicit steps taken
+ */
+int Skirt::settle(int maxSteps)
+{
+   const GLfloat amp = amplitude, freq = frequency;
+   const bool isAirOn = isAerodynamic;
+   const int updates = (SETTLE_CHECK_STEPS > getStepsPerUpdate()) ?
+                       SETTLE_CHECK_STEPS/getStepsPerUpdate() : 1;
+   VectorArray start;
+   int steps = 0;
+   bool isSettled = false;
+   
+   amplitude = frequency = 0;
+   isAerodynamic = false;
+   allocArray(start);
+   while(!isSettled && steps < maxSteps){
+      copyArray(start, position);
+      for(int u = 0; u < updates; u++) updateSkirt();
+      steps += updates*getStepsPerUpdate();
+      
+      float maxMove = 0;
+      for(int j = 2; j < yRes; j++){
+         for(int i = 0; i < xRes; i++){
+            int v = at(i,j);
+            float dx = fabs(position.x[v] - start.x[v]);
+            float dy = fabs(position.y[v] - start.y[v]);
+            float dz = fabs(position.z[v] - start.z[v]);
+            if(dx > maxMove) maxMove = dx;
+            if(dy > maxMove) maxMove = dy;
+            if(dz > maxMove) maxMove = dz;
+         }
+      }
+      isSettled = maxMove < SETTLE_TOLERANCE;
+   }
+   freeArray(start);
+   amplitude = amp;
+   frequency = freq;
+   isAerodynamic = isAirOn;
+   copyArray(lastPosition, position);
+   copyArray(lastNormals, vertexNormals);
+   return steps;
+}
+
+/* brings the skirt to rest before its motion starts: restores the rest state cached in directory
+ * for its resolution, integrator and collisions, or settles it and caches that state there, as a
+ * checkpoint of a still skirt. The motion and its phase are left as they were set. Returns the
+ * number of explicit steps settled, 0 if the cache was restored. If isCached is given, it is set to
+ * whether the rest state is in the cache afterwards: false only if it was settled and could not be
+ * written
+ */
+int Skirt::warmStart(const char *directory, bool *isCached)
+{
+   char *path = restStatePath(directory);
+   int steps = 0;
+   bool isWritten = true;
+   
+   if(!readState(path, false)){
+      steps = settle();
+      const GLfloat amp = amplitude, freq = frequency, phase = theta;
+      amplitude = frequency = theta = 0;
+      isWritten = saveState(path);
+      amplitude = amp;
+      frequency = freq;
+      theta = phase;
+   }
+   delete [] path;
+   if(isCached) *isCached = isWritten;
+   return steps;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* restores the positions and velocities of a checkpoint at path and the body as it was placed, and
+ * with isMotionRestored its motion, integrator, air and collisions too; without, its integrator and
+ * collisions must match this skirt's. The checkpoint is mapped rather than read, and must be of
+ * this resolution and physics. The normals and the state for saveFrame() are recalculated from the
+ * positions
+ */
+bool Skirt::readState(const char *path, bool isMotionRestored)
+{
+   MappedFile file(path);
+   StateHeader header;
+   const size_t rowBytes = xRes*sizeof(GLfloat);
+   const float constants[] = { GRAVITY, Ks, KsDiag, Kd, Hp, Hv };
+   
+   if(!file.isOpen() ||
+      file.getSize() != sizeof(header) + sizeof(body) + sizeof(lastBody) + 6*yRes*rowBytes)
+      return false;
+   memcpy(&header, file.getData(), sizeof(header));
+   if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) || header.byteOrder != BYTE_ORDER_MARK ||
+      header.xRes != xRes || header.yRes != yRes ||
+      memcmp(header.constants, constants, sizeof(constants)) ||
+      header.integrator < EXPLICIT || header.integrator > XPBD)
+      return false;
+   if(!isMotionRestored && (header.integrator != integrator || header.collisions != collisions ||
+      (integrator != EXPLICIT && header.implicitStep != implicitStep) ||
+      (integrator == XPBD && header.constraintIterations != constraintIterations)))
+      return false;
+   
+   const unsigned char *row = file.getData() + sizeof(header) + sizeof(body) + sizeof(lastBody);
+   GLfloat *const components[] = { position.x, position.y, position.z,
+                                   velocity.x, velocity.y, velocity.z };
+   for(int c = 0; c < 6; c++){
+      for(int j = 0; j < yRes; j++){
+         memcpy(components[c] + at(0,j), row, rowBytes);
+         row += rowBytes;
+      }
+   }
+   if(isMotionRestored){
+      amplitude = header.amplitude;
+      frequency = header.frequency;
+      theta = header.theta;
+      is3DRotation = header.is3DRotation;
+      setIntegrator(Integrator(header.integrator));
+      setImplicitStep(header.implicitStep);
+      setConstraintIterations(header.constraintIterations);
+      setCollisions(header.collisions);
+      setAerodynamic(header.isAerodynamic != 0);
+      setWind(header.wind[0], header.wind[1], header.wind[2]);
+   }
+   //after setCollisions(), which forgets the body when it is not resolved
+   memcpy(body, file.getData() + sizeof(header), sizeof(body));
+   memcpy(lastBody, file.getData() + sizeof(header) + sizeof(body), sizeof(lastBody));
+   isBodyPlaced = header.isBodyPlaced;
+   calcNorms();
+   copyArray(lastPosition, position);
+   copyArray(lastNormals, vertexNormals);
+   return true;
+}
+
+/* returns, in a new[] string, the path of the rest state cached in directory for the resolution,
+ * integrator and collisions of the skirt, e.g. rest_120x18_explicit.state or
+ * rest_120x18_implicit10_body.state. The air is off while the skirt settles, so it takes no part
+ */
+char *Skirt::restStatePath(const char *directory) const
+{
+   char *path = new char[strlen(directory) + 80];
+   int length = sprintf(path, "%s/rest_%dx%d_", directory, xRes, yRes);
+   
+   if(integrator == EXPLICIT) length += sprintf(path + length, "explicit");
+   else if(integrator == IMPLICIT) length += sprintf(path + length, "implicit%d", implicitStep);
+   else length += sprintf(path + length, "xpbd%d_%d", implicitStep, constraintIterations);
+   if(collisions & BODY_COLLISIONS) length += sprintf(path + length, "_body");
+   if(collisions & SELF_COLLISIONS) length += sprintf(path + length, "_self");
+   sprintf(path + length, ".state");
+   return path;
+}
@@ -0,0 +1,448 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtt.h - Interface and implementation for the SkirtT class template, the solver of the
+         Skirt class specialized at compile time for one mesh resolution
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SKIRTT_H
+#define SKIRTT_H
+
+#include "skirt.h"
+#include "kernels.h"
+#include "quaternion.h"
+#include "aligned.h"
+#include <cmath> //used for pow(), sqrt(), fabs(), sin(), cos()
+#include <limits> //used for numeric_limits<float>::infinity()
+#include <cstring> //used for memcpy()
+
+/* The simulation of the Skirt class for a skirt of XRes vertices around by YRes rows fixed at
+ * compile time. It steps the same model as Skirt and starts from the same state, but every loop
+ * trip count is a constant and the mesh boundaries need no tests:
+ * 1: Each row is padded with a ghost vertex on both sides holding a copy of the vertex across the
+ *    seam, so the neighbours of columns 0 and XRes-1 are read like any other
+ * 2: Springs are evaluated a row at a time into pull vectors per direction, which each vertex then
+ *    gathers scaled by the stiffness of its row. The hem row, which lacks springs below, is a
+ *    separate instantiation of the row update. Normals are gathered by the same vertexNormals
+ *    kernel as Skirt uses, a whole row at a time since the ghosts stand in for the seam
+ * 3: A buffer holds its x, y and z planes at fixed distances in one block, and the loops take
+ *    their buffers as restrict pointers, so the compiler can vectorize them
+ * It has no drawing or threading of its own; it is used where the resolution is known up front
+ */
+template <int XRes, int YRes>
+class SkirtT
+{
+public:
+   //constructor. Builds the skirt in the same initial state as Skirt(XRes, YRes)
+   SkirtT();
+   //destructor
+   ~SkirtT();
+   //calls subroutines for recalculating the vertex positions, velocities, and normals. This
+   //advances the simulation by one step
+   void updateSkirt();
+   
+//::ACCESSORS:://
+   GLfloat getHeight() const { return height; }
+   GLfloat getAmplitude() const { return amplitude; }
+   GLfloat getFrequency() const { return frequency; }
+   bool getIs3DRotation() const { return is3DRotation; }
+   int getXRes() const { return XRes; }
+   int getYRes() const { return YRes; }
+   int getVertexCount() const { return XRes*YRes; }
+   GLfloat getX(int col, int row) const { return position[at(col,row)]; }
+   GLfloat getY(int col, int row) const { return position[PLANE + at(col,row)]; }
+   GLfloat getZ(int col, int row) const { return position[2*PLANE + at(col,row)]; }
+   GLfloat getNormalX(int col, int row) const { return vertexNormals[at(col,row)]; }
+   GLfloat getNormalY(int col, int row) const { return vertexNormals[PLANE + at(col,row)]; }
+   GLfloat getNormalZ(int col, int row) const { return vertexNormals[2*PLANE + at(col,row)]; }
+   
+//::MUTATORS:://
+   //changes the animation to a 2D rotation about the z-axis
+   void rotate2D() { is3DRotation = false; }
+   //changes the animation to a 3D rotation about the x-axis and the z-axis independently
+   void rotate3D() { is3DRotation = true; }
+   //sets the amplitude of the motion, clamped to the range allowed by the arrow keys
+   void setAmplitude(GLfloat amp);
+   //sets the frequency of the motion, clamped to the range allowed by the arrow keys
+   void setFrequency(GLfloat freq);
+   //copies the positions, velocities, normals and phase of a skirt of this resolution. Its motion
+   //is left as set
+   void setState(const Skirt &skirt);
+   
+private:
+//::CONSTANTS:://
+   enum {
+      //column 0 of a row sits at offset LEAD, aligned, with its ghost vertex just before it; the
+      //ghost of column 0 follows column XRes-1
+      LEAD = ALIGNED_FLOATS,
+      STRIDE = (LEAD + XRes + 1 + ALIGNED_FLOATS-1)/ALIGNED_FLOATS*ALIGNED_FLOATS,
+      //the distance between the x, y and z planes of the vertex buffers
+      PLANE = YRes*STRIDE,
+      //the pull buffers hold one row of springs in one direction, with planes STRIDE apart: the
+      //across springs of the row being updated, and the down and diagonal springs of it and of
+      //the row above, alternating by row parity
+      PULL_ACROSS = 0, PULL_DOWN = 3*STRIDE, PULL_DIAG = 9*STRIDE, PULL_SIZE = 15*STRIDE
+   };
+   //a skirt needs at least three columns to close and three rows to have a free one
+   typedef char ResolutionCheck[(XRes >= 3 && YRes >= 3) ? 1 : -1];
+   
+//::VARIABLES:://
+   GLfloat initialX[XRes], initialY[XRes], initialZ[XRes], rowKs[YRes], rowKd[YRes];
+   GLfloat *position, *velocity, *vertexNormals, *pulls;
+   //the rest lengths and stiffness weights of the springs across, down and along the diagonals
+   GLfloat acrossLength, downLength, diagLength, acrossWeight, downWeight, diagWeight;
+   GLfloat height, waistDrop, gravity, amplitude, frequency, theta;
+   bool is3DRotation;
+   //the fastest kernels of this CPU, as Skirt picks them
+   const Kernels *kernels;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //returns the index of the vertex at column col and row row into the x plane of the vertex
+   //buffers. Columns -1 and XRes are the ghosts
+   static int at(int col, int row) { return row*STRIDE + LEAD + col; }
+   //copies the vertices across the seam of rows [firstRow, endRow) into their ghosts
+   void updateGhosts(int firstRow, int endRow);
+   //calculates the oscillatory acceleration applied to the top row of free-motion vertices
+   void calcOscillatoryAcc();
+   //updates the vertex velocities via Euler integration using the spring forces, gravity, and
+   //oscillatory forces as accelerations
+   void updateVelocity();
+   //evaluates the springs of row j and integrates the velocities of its vertices. The hem row has
+   //no springs below it
+   template <bool IsHem> void updateVelocityRow(int j);
+   //updates the vertex positions via Euler integration of the vertex velocities
+   void updatePosition();
+   //calculates the vertex normals
+   void calcNorms();
+   
+//::STATIC FUNCTIONS:://
+   //writes the pull vectors of the N springs from vertex a[k] to vertex b[k] into pull[k]
+   template <int N> static void calcPulls(const GLfloat *__restrict__ a,
+                                          const GLfloat *__restrict__ b, GLfloat rest,
+                                          GLfloat weight, GLfloat *__restrict__ pull);
+   //integrates the velocities of one row from the pulls of the springs at its vertices
+   template <bool IsHem> static void integrateRow(const GLfloat *__restrict__ across,
+                                                  const GLfloat *__restrict__ downAbove,
+                                                  const GLfloat *__restrict__ diagAbove,
+                                                  const GLfloat *__restrict__ down,
+                                                  const GLfloat *__restrict__ diag,
+                                                  GLfloat *__restrict__ v, GLfloat ks, GLfloat kd,
+                                                  GLfloat gravity);
+};
+
+/* SkirtT - CONSTRUCTOR. The initial vertices and the stiffness and damping profiles are taken from
+ * a generic Skirt of the same resolution, so both start from exactly the same state
+ */
+template <int XRes, int YRes>
+SkirtT<XRes,YRes>::SkirtT()
+{
+   Skirt stock(XRes, YRes);
+   
+   position = alignedAllocFloats(3*PLANE);
+   velocity = alignedAllocFloats(3*PLANE);
+   vertexNormals = alignedAllocFloats(3*PLANE);
+   pulls = alignedAllocFloats(PULL_SIZE);
+   kernels = &bestKernels();
+   for(int j = 0; j < YRes; j++){
+      const int row = stock.at(0,j);
+      memcpy(position + at(0,j), stock.position.x + row, XRes*sizeof(GLfloat));
+      memcpy(position + PLANE + at(0,j), stock.position.y + row, XRes*sizeof(GLfloat));
+      memcpy(position + 2*PLANE + at(0,j), stock.position.z + row, XRes*sizeof(GLfloat));
+      rowKs[j] = stock.rowStiffness(j);
+      rowKd[j] = stock.rowDamping(j);
+   }
+   for(int i = 0; i < XRes; i++){
+      initialX[i] = stock.initialPos.x[i];
+      initialY[i] = stock.initialPos.y[i];
+      initialZ[i] = stock.initialPos.z[i];
+   }
+   height = stock.height;
+   waistDrop = stock.waistDrop;
+   acrossLength = stock.acrossLength;
+   downLength = stock.downLength;
+   diagLength = stock.diagLength;
+   acrossWeight = stock.acrossWeight;
+   downWeight = stock.downWeight;
+   diagWeight = stock.diagWeight;
+   gravity = stock.gravity;
+   updateGhosts(0, YRes);
+   calcNorms();
+   
+   amplitude = Skirt::AMP_MIN;
+   frequency = Skirt::FREQ_MIN;
+   theta = 0;
+   is3DRotation = true;
+}
+
+/* SkirtT - DESTRUCTOR
+ */
+template <int XRes, int YRes>
+SkirtT<XRes,YRes>::~SkirtT()
+{
+   alignedFree(position);
+   alignedFree(velocity);
+   alignedFree(vertexNormals);
+   alignedFree(pulls);
+}
+
+/* calls subroutines for recalculating the vertex positions, velocities, and normals. This advances
+ * the simulation by one step
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::updateSkirt()
+{
+   updateVelocity();
+   updatePosition();
+   calcNorms();
+}
+
+/* sets the amplitude of the motion, clamped to the range allowed by the arrow keys
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::setAmplitude(GLfloat amp)
+{
+   amplitude = (amp < Skirt::AMP_MIN) ? Skirt::AMP_MIN :
+               (amp > Skirt::AMP_MAX) ? Skirt::AMP_MAX : amp;
+}
+
+/* sets the frequency of the motion, clamped to the range allowed by the arrow keys
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::setFrequency(GLfloat freq)
+{
+   frequency = (freq < Skirt::FREQ_MIN) ? Skirt::FREQ_MIN :
+               (freq > Skirt::FREQ_MAX) ? Skirt::FREQ_MAX : freq;
+}
+
+/* copies the positions, velocities, normals and phase of a skirt of this resolution, and fills the
+ * ghosts from them
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::setState(const Skirt &skirt)
+{
+   for(int j = 0; j < YRes; j++){
+      const int row = skirt.at(0,j);
+      memcpy(position + at(0,j), skirt.position.x + row, XRes*sizeof(GLfloat));
+      memcpy(position + PLANE + at(0,j), skirt.position.y + row, XRes*sizeof(GLfloat));
+      memcpy(position + 2*PLANE + at(0,j), skirt.position.z + row, XRes*sizeof(GLfloat));
+      memcpy(velocity + at(0,j), skirt.velocity.x + row, XRes*sizeof(GLfloat));
+      memcpy(velocity + PLANE + at(0,j), skirt.velocity.y + row, XRes*sizeof(GLfloat));
+      memcpy(velocity + 2*PLANE + at(0,j), skirt.velocity.z + row, XRes*sizeof(GLfloat));
+      memcpy(vertexNormals + at(0,j), skirt.vertexNormals.x + row, XRes*sizeof(GLfloat));
+      memcpy(vertexNormals + PLANE + at(0,j), skirt.vertexNormals.y + row, XRes*sizeof(GLfloat));
+      memcpy(vertexNormals + 2*PLANE + at(0,j), skirt.vertexNormals.z + row,
+             XRes*sizeof(GLfloat));
+   }
+   theta = skirt.theta;
+   updateGhosts(0, YRes);
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* copies the vertices across the seam of rows [firstRow, endRow) into their ghosts
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::updateGhosts(int firstRow, int endRow)
+{
+   for(int c = 0; c < 3*PLANE; c += PLANE){
+      for(int j = firstRow; j < endRow; j++){
+         position[c + at(-1,j)] = position[c + at(XRes-1,j)];
+         position[c + at(XRes,j)] = position[c + at(0,j)];
+      }
+   }
+}
+
+/* calculates the oscillatory acceleration applied to the top row of free-motion vertices. See
+ * Skirt::calcOscillatoryAcc()
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::calcOscillatoryAcc()
+{
+   GLfloat *px = position, *py = position + PLANE, *pz = position + 2*PLANE;
+   int minVertex = 0, maxVertex = 0;
+   float yMin = std::numeric_limits<float>::infinity(), yMax = -yMin;
+   bool isOscillating = false;
+   
+   theta += frequency;
+   Quaternion xrot(amplitude*cos(-theta), 1, 0, 0);
+   Quaternion zrot(amplitude*sin(-theta), 0, 0, 1);
+   float drive[9];
+   (is3DRotation ? zrot*xrot : xrot).toMatrix(drive);
+   Quaternion::rotatePoints(drive, initialX, initialY, initialZ, px + at(0,1), py + at(0,1),
+                            pz + at(0,1), XRes);
+   for(int i = 0; i < XRes; i++){
+      if(!isOscillating && ((px[at(i,0)] - px[at(i,1)] != 0) ||
+         (py[at(i,0)] - py[at(i,1)] != 0) || (pz[at(i,0)] - pz[at(i,1)] != 0)))
+         isOscillating = true;
+   
+      px[at(i,0)] = px[at(i,1)];
+      py[at(i,0)] = py[at(i,1)];
+      pz[at(i,0)] = pz[at(i,1)];
+      py[at(i,1)] -= waistDrop;
+   
+      if(yMin > py[at(i,0)]){
+         yMin = py[at(i,0)];
+         minVertex = i;
+      }
+      if(yMax < py[at(i,0)]){
+         yMax = py[at(i,0)];
+         maxVertex = i;
+      }
+   }
+   updateGhosts(0, 2);
+   
+   if(isOscillating){
+      int maxV = at(maxVertex,0), minV = at(minVertex,0);
+      float mag = sqrt(pow(px[maxV] - px[minV],2) + pow(py[maxV] - py[minV],2) +
+                       pow(pz[maxV] - pz[minV],2));
+      if(mag != 0){
+         float ax = (px[maxV] - px[minV])/(10*mag);
+         float ay = (py[maxV] - py[minV])/(10*mag);
+         float az = (pz[maxV] - pz[minV])/(10*mag);
+         //applies the oscillatory acceleration to the top row of free-motion vertices
+         for(int i = 0; i < XRes; i++){
+            velocity[at(i,2)] += Skirt::Hv*ax;
+            velocity[PLANE + at(i,2)] += Skirt::Hv*ay;
+            velocity[2*PLANE + at(i,2)] += Skirt::Hv*az;
+         }
+      }
+   }
+}
+
+/* updates the vertex velocities via Euler integration using the spring forces, gravity, and
+ * oscillatory forces as accelerations. Rows are updated top down, each from the pulls of the
+ * springs shared with the row above
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::updateVelocity()
+{
+   //Velocity Update: Oscillation
+   calcOscillatoryAcc();
+   //the springs from row 1 down; row 1 itself is pinned
+   calcPulls<XRes>(position + at(0,1), position + at(0,2), downLength, downWeight,
+                   pulls + PULL_DOWN + 3*STRIDE + LEAD);
+   calcPulls<XRes+1>(position + at(-1,1), position + at(0,2), diagLength, diagWeight,
+                     pulls + PULL_DIAG + 3*STRIDE + LEAD-1);
+   //Velocity Update: Spring Forces, Gravity and Spring Damping
+   for(int j = 2; j < YRes-1; j++)
+      updateVelocityRow<false>(j);
+   updateVelocityRow<true>(YRes-1);
+}
+
+/* evaluates the springs of row j and integrates the velocities of its vertices. The pulls of the
+ * springs from row j-1 down into row j were written when row j-1 was updated; the springs from
+ * row j down are written here for row j+1, unless j is the hem
+ */
+template <int XRes, int YRes>
+template <bool IsHem>
+void SkirtT<XRes,YRes>::updateVelocityRow(int j)
+{
+   GLfloat *across = pulls + PULL_ACROSS + LEAD;
+   GLfloat *down = pulls + PULL_DOWN + (j&1)*3*STRIDE + LEAD;
+   GLfloat *diag = pulls + PULL_DIAG + (j&1)*3*STRIDE + LEAD;
+   const GLfloat *downAbove = pulls + PULL_DOWN + (~j&1)*3*STRIDE + LEAD;
+   const GLfloat *diagAbove = pulls + PULL_DIAG + (~j&1)*3*STRIDE + LEAD;
+   
+   //the across springs from the ghost of column XRes-1 on, so both ends of the seam spring are
+   //in the run; likewise the diagonals
+   calcPulls<XRes+1>(position + at(-1,j), position + at(0,j), acrossLength, acrossWeight,
+                     across-1);
+   if(!IsHem){
+      calcPulls<XRes>(position + at(0,j), position + at(0,j+1), downLength, downWeight, down);
+      calcPulls<XRes+1>(position + at(-1,j), position + at(0,j+1), diagLength, diagWeight,
+                        diag-1);
+   }
+   integrateRow<IsHem>(across, downAbove, diagAbove, down, diag, velocity + at(0,j), rowKs[j],
+                       rowKd[j], gravity);
+}
+
+/* updates the vertex positions via Euler integration of the vertex velocities. The pinned rows,
+ * ghosts and padding have no velocity, so this is a single sweep over the buffers, after which
+ * the ghosts are refreshed
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::updatePosition()
+{
+   GLfloat *__restrict__ p = position;
+   const GLfloat *__restrict__ v = velocity;
+   
+   for(int k = 0; k < 3*PLANE; k++)
+      p[k] += Skirt::Hp*v[k];
+   updateGhosts(2, YRes);
+}
+
+/* calculates the vertex normals, a row at a time by the kernels' vertexNormals. The ghosts hold
+ * the neighbours across the seam, so unlike Skirt::calcNormRows() the first and last columns need
+ * no scalar pass of their own
+ */
+template <int XRes, int YRes>
+void SkirtT<XRes,YRes>::calcNorms()
+{
+   const VectorArray p = { position, position + PLANE, position + 2*PLANE };
+   VectorArray n = { vertexNormals, vertexNormals + PLANE, vertexNormals + 2*PLANE };
+   
+   for(int j = 0; j < YRes; j++)
+      kernels->vertexNormals(p, n, at(0,j), XRes, STRIDE, j > 0, j < YRes-1);
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* writes the pull vectors of the N springs from vertex a[k] to vertex b[k] into pull[k]: the
+ * signed squared direction of the spring scaled by its stretch and the weight of its direction,
+ * as in scalarSpringForces(). A spring pulls its first endpoint by -ks*pull and its second by
+ * +ks*pull
+ */
+template <int XRes, int YRes>
+template <int N>
+void SkirtT<XRes,YRes>::calcPulls(const GLfloat *__restrict__ a, const GLfloat *__restrict__ b,
+                                  GLfloat rest, GLfloat weight, GLfloat *__restrict__ pull)
+{
+   for(int k = 0; k < N; k++){
+      float dx = a[k] - b[k], dy = a[PLANE+k] - b[PLANE+k], dz = a[2*PLANE+k] - b[2*PLANE+k];
+      float lengthSq = dx*dx + dy*dy + dz*dz;
+      float stretch = weight*(std::sqrt(lengthSq) - rest)/lengthSq;
+      pull[k] = dx*std::fabs(dx)*stretch;
+      pull[STRIDE+k] = dy*std::fabs(dy)*stretch;
+      pull[2*STRIDE+k] = dz*std::fabs(dz)*stretch;
+   }
+}
+
+/* integrates the velocities of one row from the pulls of the springs at its vertices. Every spring
+ * endpoint feels the stiffness of its own row, so the force on a vertex is ks times the sum of the
+ * pulls of its six springs: the row's own across, down and diagonal springs pull it by -pull, the
+ * across spring from its left and the down and diagonal springs from the row above by +pull
+ */
+template <int XRes, int YRes>
+template <bool IsHem>
+void SkirtT<XRes,YRes>::integrateRow(const GLfloat *__restrict__ across,
+                                     const GLfloat *__restrict__ downAbove,
+                                     const GLfloat *__restrict__ diagAbove,
+                                     const GLfloat *__restrict__ down,
+                                     const GLfloat *__restrict__ diag, GLfloat *__restrict__ v,
+                                     GLfloat ks, GLfloat kd, GLfloat gravity)
+{
+   for(int c = 0; c < 3; c++){
+      const int s = c*STRIDE;
+      //gravity pulls along y only
+      const float g = (c == 1) ? Skirt::Hv*gravity : 0;
+      GLfloat *__restrict__ vc = v + c*PLANE;
+   
+      for(int i = 0; i < XRes; i++){
+         float f = across[s+i-1] - across[s+i] + downAbove[s+i] + diagAbove[s+i-1];
+         if(!IsHem) f -= down[s+i] + diag[s+i];
+         //Velocity Update: Spring Forces, then Gravity, then Spring Damping
+         vc[i] += Skirt::Hv*ks*f;
+         vc[i] += g;
+         vc[i] -= kd*vc[i];
+      }
+   }
+}
+
+#endif //SKIRTT_H
@@ -0,0 +1,145 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: skirtxpbd.cpp - Implementation for the Skirt class (position based dynamics)
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "skirt.h"
+#include "profiler.h"
+#include <cmath> //used for sqrt()
+#include <cstring> //used for memcpy(), memset()
+
+using namespace std;
+
+/* sets the number of constraint iterations of an XPBD step; more iterations hold the springs closer
+ * to their stiffness
+ */
+void Skirt::setConstraintIterations(int iterations)
+{
+   constraintIterations = (iterations < 1) ? 1 : iterations;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* updates the vertex positions and velocities by one XPBD step of implicitStep explicit steps,
+ * taken as implicitStep substeps of one explicit step each. In a substep the drive places the
+ * pinned rows, the vertices move under gravity and their own velocity, then every spring is
+ * projected back toward its rest length constraintIterations times, as a distance constraint
+ * whose compliance is the inverse of its stiffness. The velocities are whatever distance the
+ * vertices ended up moving. The weight of the skirt has to travel up every column within a
+ * substep, which takes many sweeps over the springs; a few sweeps of each of many short substeps
+ * hold the springs far closer to their stiffness than as many sweeps of one long step, so the
+ * skirt comes to rest where the explicit one does. The pinned rows are never corrected, so they
+ * act as kinematic constraints
+ */
+void Skirt::updateXPBD()
+{
+   for(int substep = 0; substep < implicitStep; substep++){
+      //Velocity Update: Oscillation
+      calcOscillatoryAcc(1);
+      PROFILE_LAP(DRIVE);
+      //Velocity Update: Gravity; Position Update
+      pool->parallelFor(predictJob, 2, yRes);
+      PROFILE_LAP(POSITION);
+      //Position Update: Spring Constraints
+      memset(lambda, 0, springs.count*sizeof(GLfloat));
+      for(solverIterations = 0; solverIterations < constraintIterations; solverIterations++){
+         //the springs of rows j and j+2 share no vertex, so the rows of one parity are swept in
+         //parallel, the odd ones from row 1 down first
+         for(sweepParity = 0; sweepParity < 2; sweepParity++)
+            pool->parallelFor(constraintJob, 0, (yRes - sweepParity)/2);
+      }
+      PROFILE_LAP(CONSTRAINTS);
+      //the velocities derived next carry the vertices' moves out of collisions
+      if(collisions){
+         collide();
+         PROFILE_LAP(COLLISIONS);
+      }
+      //Velocity Update: Spring Damping
+      pool->parallelFor(deriveJob, 2, yRes);
+      PROFILE_LAP(VELOCITY);
+   }
+}
+
+/* integrates the velocities of rows [firstRow, endRow) under gravity over one explicit step and
+ * moves their positions to where those velocities take them, keeping the old positions in previous
+ */
+void Skirt::predictPositionRows(int firstRow, int endRow)
+{
+   memcpy(previous.x + at(0,firstRow), position.x + at(0,firstRow),
+          (endRow - firstRow)*stride*sizeof(GLfloat));
+   memcpy(previous.y + at(0,firstRow), position.y + at(0,firstRow),
+          (endRow - firstRow)*stride*sizeof(GLfloat));
+   memcpy(previous.z + at(0,firstRow), position.z + at(0,firstRow),
+          (endRow - firstRow)*stride*sizeof(GLfloat));
+   for(int j = firstRow; j < endRow; j++)
+      for(int v = at(0,j); v < at(xRes,j); v++) velocity.y[v] += Hv*gravity;
+   kernels->integratePosition(position, velocity, at(0,firstRow), (endRow - firstRow)*stride, Hp);
+}
+
+/* sweeps the distance constraints of the springs of rows 1 + sweepParity + 2k, k in [first, end),
+ * by Gauss-Seidel. The springs of a row move only its own vertices and those of the row below, so
+ * no two of these rows touch the same vertex and the bands of k can run in parallel. Within a row
+ * the springs are swept in the order they are stored
+ */
+void Skirt::projectConstraintRows(int first, int end)
+{
+   const GLfloat h2 = Hv*Hp;
+   
+   for(int k = first; k < end; k++){
+      int j = 1 + sweepParity + 2*k;
+      projectConstraints(springs.rowStart[j], springs.rowStart[j+1], h2);
+   }
+}
+
+/* sets the velocities of rows [firstRow, endRow) to the distance their vertices moved over the
+ * substep, damped by the row's spring damping
+ */
+void Skirt::deriveVelocityRows(int firstRow, int endRow)
+{
+   for(int j = firstRow; j < endRow; j++){
+      GLfloat scale = (1 - rowDamping(j))/Hp;
+      for(int v = at(0,j); v < at(xRes,j); v++){
+         velocity.x[v] = scale*(position.x[v] - previous.x[v]);
+         velocity.y[v] = scale*(position.y[v] - previous.y[v]);
+         velocity.z[v] = scale*(position.z[v] - previous.z[v]);
+      }
+   }
+}
+
+/* projects the distance constraints of springs [begin, end) of an XPBD substep of squared step h2
+ * once each, in order, so each sees the corrections of those before it.
+ * A spring of stiffness ksA at a and ksB at b is a constraint of compliance 1/k, k the larger of
+ * the two, whose endpoints move in proportion to ksA/k and ksB/k. At equilibrium each endpoint
+ * then feels its own row's stiffness, as in the explicit model, and an endpoint in the pinned rows
+ * (stiffness 0) never moves
+ */
+void Skirt::projectConstraints(int begin, int end, GLfloat h2)
+{
+   for(int s = begin; s < end; s++){
+      int a = springs.a[s], b = springs.b[s];
+      GLfloat k = (springs.ksA[s] > springs.ksB[s]) ? springs.ksA[s] : springs.ksB[s];
+      GLfloat wA = springs.ksA[s]/k, wB = springs.ksB[s]/k, alpha = 1/(k*h2);
+      GLfloat dx = position.x[a] - position.x[b];
+      GLfloat dy = position.y[a] - position.y[b];
+      GLfloat dz = position.z[a] - position.z[b];
+      GLfloat length = sqrt(dx*dx + dy*dy + dz*dz);
+      GLfloat dLambda = (springs.rest[s] - length - alpha*lambda[s])/(wA + wB + alpha);
+      lambda[s] += dLambda;
+      //the constraint gradient is the unit vector from b to a
+      GLfloat scale = dLambda/length;
+      position.x[a] += wA*scale*dx;
+      position.y[a] += wA*scale*dy;
+      position.z[a] += wA*scale*dz;
+      position.x[b] -= wB*scale*dx;
+      position.y[b] -= wB*scale*dy;
+      position.z[b] -= wB*scale*dz;
+   }
+}
@@ -0,0 +1,102 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: spatialhash.cpp - Implementation for the SpatialHash class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "spatialhash.h"
+#include <cstring> //used for memset()
+
+using namespace std;
+
+/* SpatialHash - CONSTRUCTOR. The table has a power of two buckets, at least twice as many as there
+ * can be points, so most buckets hold the points of a single cell
+ */
+SpatialHash::SpatialHash(int maxPoints, float radius) : maxPoints(maxPoints), radius(radius),
+                                                        inverseCellSize(1/(2*radius))
+{
+   int buckets = 1;
+   
+   while(buckets < 2*maxPoints) buckets *= 2;
+   mask = buckets-1;
+   start = new int[buckets+1];
+   entries = new int[maxPoints];
+   bucketOf = new int[maxPoints];
+   memset(start, 0, (buckets+1)*sizeof(int));
+}
+
+/* SpatialHash - DESTRUCTOR
+ */
+SpatialHash::~SpatialHash()
+{
+   delete [] start;
+   delete [] entries;
+   delete [] bucketOf;
+}
+
+/* indexes the count points of the buffers at the given indices, replacing any indexed before: a
+ * counting sort of the points by bucket. Each bucket keeps its points in the order they were given,
+ * so the index, and whatever is summed over it, does not depend on anything but the points
+ */
+void SpatialHash::build(const VectorArray &points, const int *indices, int count)
+{
+   if(count > maxPoints) count = maxPoints;
+   memset(start, 0, (mask+2)*sizeof(int));
+   for(int k = 0; k < count; k++){
+      int p = indices[k];
+      bucketOf[k] = hash(cellOf(points.x[p]), cellOf(points.y[p]), cellOf(points.z[p]));
+      start[bucketOf[k]+1]++;
+   }
+   for(int b = 0; b <= mask; b++) start[b+1] += start[b];
+   //each point goes to the next free entry of its bucket, which start[b] tracks until it reaches
+   //start[b+1]; the starts are then shifted back down one bucket
+   for(int k = 0; k < count; k++) entries[start[bucketOf[k]]++] = indices[k];
+   for(int b = mask; b > 0; b--) start[b] = start[b-1];
+   start[0] = 0;
+}
+
+/* writes to buckets the distinct buckets of the cells that may hold points within the radius of
+ * point (x,y,z) and returns how many there are: along each axis, the point's cell and the one on
+ * the side of the nearer face. Empty buckets are left out, and a bucket shared by two of the cells
+ * is listed once, so no point is found twice
+ */
+int SpatialHash::findBuckets(float x, float y, float z, int buckets[NEIGHBOUR_CELLS]) const
+{
+   int cx[2], cy[2], cz[2], found = 0;
+   
+   nearestCellsOf(x, cx);
+   nearestCellsOf(y, cy);
+   nearestCellsOf(z, cz);
+   
+   for(int i = 0; i < 2; i++){
+      for(int j = 0; j < 2; j++){
+         for(int k = 0; k < 2; k++){
+            int bucket = hash(cx[i], cy[j], cz[k]), b = 0;
+            if(start[bucket] == start[bucket+1]) continue;
+            while(b < found && buckets[b] != bucket) b++;
+            if(b == found) buckets[found++] = bucket;
+         }
+      }
+   }
+   return found;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* writes to cells the cell coordinate of a coordinate along one axis and that of the neighbouring
+ * cell across the nearer face of it
+ */
+void SpatialHash::nearestCellsOf(float coordinate, int cells[2]) const
+{
+   float scaled = coordinate*inverseCellSize, cell = floor(scaled);
+   
+   cells[0] = int(cell);
+   cells[1] = cells[0] + ((scaled - cell < 0.5f) ? -1 : 1);
+}
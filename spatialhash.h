@@ -0,0 +1,80 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: spatialhash.h - Interface for the SpatialHash class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include "kernels.h"
+#include <cmath> //used for floor()
+
+/* A uniform grid of cubic cells over all of space, hashed into a fixed table of buckets, indexing
+ * a set of points so that those within a radius of any point can be found in time independent of
+ * how many there are. build() indexes the points afresh by a counting sort on their buckets, so it
+ * is rebuilt for every step of a moving set at a cost linear in its size. The cells are twice the
+ * radius across, so the ball around a point overlaps the 2x2x2 cells nearest it and no others.
+ * Distinct cells may share a bucket, so the points of a bucket are only candidates, to be checked
+ * for distance by the caller
+ */
+class SpatialHash
+{
+public:
+   //the most buckets findBuckets() returns: those of the 2x2x2 cells nearest a point
+   static const int NEIGHBOUR_CELLS = 8;
+   
+   //constructor. A table for up to maxPoints points, to be searched within radius of a point
+   SpatialHash(int maxPoints, float radius);
+   //destructor
+   ~SpatialHash();
+   //indexes the count points of the buffers at the given indices, replacing any indexed before
+   void build(const VectorArray &points, const int *indices, int count);
+   
+//::ACCESSORS:://
+   float getRadius() const { return radius; }
+   //writes to buckets the distinct buckets of the cells that may hold points within getRadius() of
+   //point (x,y,z), and returns how many there are
+   int findBuckets(float x, float y, float z, int buckets[NEIGHBOUR_CELLS]) const;
+   //returns the indices of the points in a bucket as the range [bucketBegin(), bucketEnd()), in
+   //the order they were given to build()
+   const int *bucketBegin(int bucket) const { return entries + start[bucket]; }
+   const int *bucketEnd(int bucket) const { return entries + start[bucket+1]; }
+   
+private:
+//::VARIABLES:://
+   int maxPoints, mask;
+   float radius, inverseCellSize;
+   //the points of bucket b are entries[start[b]] to entries[start[b+1]-1]; bucketOf is the bucket
+   //of each point given to build()
+   int *start, *entries, *bucketOf;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //returns the cell coordinate of a coordinate along one axis. Inlined, as every point hashes
+   //three of them
+   int cellOf(float coordinate) const { return int(std::floor(coordinate*inverseCellSize)); }
+   //writes to cells the cell coordinate of a coordinate along one axis and that of the
+   //neighbouring cell across the nearer face
+   void nearestCellsOf(float coordinate, int cells[2]) const;
+   //returns the bucket of the cell with the given coordinates, by the hash of Teschner et al.,
+   //"Optimized Spatial Hashing for Collision Detection of Deformable Objects". The products are
+   //taken unsigned so they wrap rather than overflow
+   int hash(int cx, int cy, int cz) const
+   {
+      return int(((unsigned(cx)*73856093u) ^ (unsigned(cy)*19349663u) ^ (unsigned(cz)*83492791u)) &
+                 unsigned(mask));
+   }
+   
+   //not copyable
+   SpatialHash(const SpatialHash &);
+   SpatialHash& operator=(const SpatialHash &);
+};
+
+#endif //SPATIALHASH_H
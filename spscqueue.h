@@ -0,0 +1,82 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: spscqueue.h - The SpscQueue class template
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+/* A bounded first-in first-out queue between one producer thread and one consumer thread that
+ * needs no locks. It is a ring of Capacity slots, one of which is always left empty to tell a full
+ * ring from an empty one. Only the producer moves the head and only the consumer moves the tail.
+ * Both indices are only ever read and moved by atomic operations, which are also full memory
+ * barriers, so neither side can see an index move before the slot behind it is ready.
+ */
+template <class T, int Capacity>
+class SpscQueue
+{
+public:
+   //constructor. The queue starts empty
+   SpscQueue() : head(0), tail(0) {}
+   
+   //producer side. Appends item and returns true, or returns false if the queue is full
+   bool push(const T &item);
+   //consumer side. Removes the oldest item into item and returns true, or returns false if the
+   //queue is empty
+   bool pop(T &item);
+   
+private:
+//::VARIABLES:://
+   T items[Capacity];
+   volatile int head, tail;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //atomically reads an index
+   static int load(volatile int &index) { return __sync_fetch_and_add(&index, 0); }
+   //atomically sets an index that only the calling side moves
+   static void store(volatile int &index, int value)
+   {
+      __sync_val_compare_and_swap(&index, load(index), value);
+   }
+   
+   //not copyable
+   SpscQueue(const SpscQueue &);
+   SpscQueue& operator=(const SpscQueue &);
+};
+
+/* producer side. Appends item and returns true, or returns false if the queue is full
+ */
+template <class T, int Capacity>
+bool SpscQueue<T,Capacity>::push(const T &item)
+{
+   int h = load(head), next = (h + 1)%Capacity;
+   
+   if(next == load(tail)) return false;
+   items[h] = item;
+   store(head, next);
+   return true;
+}
+
+/* consumer side. Removes the oldest item into item and returns true, or returns false if the queue
+ * is empty
+ */
+template <class T, int Capacity>
+bool SpscQueue<T,Capacity>::pop(T &item)
+{
+   int t = load(tail);
+   
+   if(t == load(head)) return false;
+   item = items[t];
+   store(tail, (t + 1)%Capacity);
+   return true;
+}
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,254 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: texturecache.cpp - Implementation for the TextureCache class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "texturecache.h"
+#include "mappedfile.h"
+#include <cstdio> //used for fopen(), fclose(), fread(), fscanf(), sscanf(), fgetc(), printf()
+#include <cstring> //used for strncmp(), memcmp(), memcpy()
+#include <sys/stat.h> //used for stat()
+
+//the layout of the start of a cache file. The byte order mark rejects a cache from a machine of
+//the other endianness
+struct CacheHeader
+{
+   char magic[8];
+   unsigned int byteOrder, width, height, levels;
+   long sourceSize, sourceTime;
+};
+static const char MAGIC[8] = { 'S', 'K', 'T', 'X', 'M', 'I', 'P', '1' };
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+//returns the number of mip levels of an image of the given size, down to 1x1
+static int levelCount(int width, int height);
+//returns the number of bytes of all the mip levels of an image of the given size
+static size_t chainSize(int width, int height);
+
+/* TextureCache - CONSTRUCTOR
+ */
+TextureCache::TextureCache(const char *source, const char *cachePath)
+{
+   struct stat info;
+   
+   file = 0;
+   levels = width = height = 0;
+   rebuilt = false;
+   if(stat(source, &info)){
+      printf("Unable to find texture %s\n", source);
+      return;
+   }
+   if(open(cachePath, info.st_size, info.st_mtime)) return;
+   rebuilt = true;
+   if(build(source, cachePath, info.st_size, info.st_mtime)){
+      printf("Built texture cache %s\n", cachePath);
+      open(cachePath, info.st_size, info.st_mtime);
+   }
+}
+
+/* TextureCache - DESTRUCTOR
+ */
+TextureCache::~TextureCache()
+{
+   close();
+}
+
+/* returns the width of a mip level: halved at each level, but never below 1
+ */
+int TextureCache::getWidth(int level) const
+{
+   return (width >> level) ? width >> level : 1;
+}
+
+/* returns the height of a mip level: halved at each level, but never below 1
+ */
+int TextureCache::getHeight(int level) const
+{
+   return (height >> level) ? height >> level : 1;
+}
+
+/* returns the RGB pixels of a mip level, which follow those of every larger level
+ */
+const unsigned char *TextureCache::getPixels(int level) const
+{
+   const unsigned char *pixels = file->getData() + sizeof(CacheHeader);
+   
+   for(int l = 0; l < level; l++) pixels += 3*getWidth(l)*getHeight(l);
+   return pixels;
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* reads the P6 PPM image at path into a new[] array of RGB pixels and its size. Prints why and
+ * returns 0 if it cannot
+ */
+unsigned char *TextureCache::readPPM(const char *path, int &width, int &height)
+{
+   int i = 0, junk;
+   char header[70];
+   unsigned char *image;
+   FILE *in = fopen(path, "rb");
+   if(!in){
+      printf("Unable to open texture for reading\n");
+      return 0;
+   }
+   //read in header data
+   if(fscanf(in, "%69s", header) != 1 || strncmp(header, "P6", 2)){
+      printf("Incompatible image format. Please load a P6 (RAW) PPM.\n");
+      fclose(in);
+      return 0;
+   }
+   while(i < 3){
+      if(fscanf(in, "%69s", header) != 1){
+         printf("Truncated PPM header in %s\n", path);
+         fclose(in);
+         return 0;
+      }
+      if(header[0] != '#'){
+         if(i == 0)       i += sscanf(header, "%i %i %i", &width, &height, &junk);
+         else if (i == 1) i += sscanf(header, "%i %i", &height, &junk);
+         else if (i == 2) i += sscanf(header, "%i", &junk);
+      }
+   }
+   
+   fgetc(in);
+   //read in pixel data
+   image = new unsigned char[width*height*3];
+   if(fread(image, sizeof(unsigned char), width*height*3, in) != size_t(width*height*3)){
+      printf("Truncated pixel data in %s\n", path);
+      delete [] image;
+      image = 0;
+   }
+   fclose(in);
+   return image;
+}
+
+/* writes the next mip level of an image of the given size to next: each pixel the rounded average
+ * of a 2x2 block. Once a side is down to 1 it is the truncated average of a pair of pixels, as in
+ * gluBuild2DMipmaps()
+ */
+void TextureCache::halveImage(const unsigned char *image, int width, int height,
+                              unsigned char *next)
+{
+   if(width == 1 || height == 1){
+      const int count = (width > height) ? width/2 : height/2;
+      for(int p = 0; p < count; p++)
+         for(int c = 0; c < 3; c++) *next++ = (image[6*p + c] + image[6*p + 3 + c])/2;
+      if(!count) for(int c = 0; c < 3; c++) next[c] = image[c];
+      return;
+   }
+   for(int j = 0; j < height/2; j++){
+      const unsigned char *row = image + 3*width*2*j;
+      for(int i = 0; i < width/2; i++){
+         const unsigned char *p = row + 6*i;
+         for(int c = 0; c < 3; c++)
+            *next++ = (p[c] + p[c+3] + p[c+3*width] + p[c+3*width+3] + 2)/4;
+      }
+   }
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* maps the cache at path if it matches a source of the given size and time: the header must be
+ * ours, record that source, and be followed by the whole mip chain it describes
+ */
+bool TextureCache::open(const char *path, long sourceSize, long sourceTime)
+{
+   CacheHeader header;
+   file = new MappedFile(path);
+   
+   if(file->isOpen() && file->getSize() >= sizeof(header)){
+      memcpy(&header, file->getData(), sizeof(header));
+      if(!memcmp(header.magic, MAGIC, sizeof(MAGIC)) && header.byteOrder == BYTE_ORDER_MARK &&
+         header.sourceSize == sourceSize && header.sourceTime == sourceTime && header.width &&
+         header.height && int(header.levels) == levelCount(header.width, header.height) &&
+         file->getSize() == sizeof(header) + chainSize(header.width, header.height)){
+         width = header.width;
+         height = header.height;
+         levels = header.levels;
+         return true;
+      }
+   }
+   close();
+   return false;
+}
+
+/* releases the mapping
+ */
+void TextureCache::close()
+{
+   delete file;
+   file = 0;
+}
+
+/* builds the cache at path from the PPM image at source. The chain is written to a temporary file
+ * that is renamed over the old cache once complete, so a cache is never seen half written
+ */
+bool TextureCache::build(const char *source, const char *path, long sourceSize, long sourceTime)
+{
+   int width, height;
+   unsigned char *image = readPPM(source, width, height);
+   if(!image) return false;
+   
+   CacheHeader header;
+   memcpy(header.magic, MAGIC, sizeof(MAGIC));
+   header.byteOrder = BYTE_ORDER_MARK;
+   header.width = width;
+   header.height = height;
+   header.levels = levelCount(width, height);
+   header.sourceSize = sourceSize;
+   header.sourceTime = sourceTime;
+   unsigned char *chain = new unsigned char[chainSize(width, height)], *level = chain;
+   memcpy(chain, image, 3*width*height);
+   delete [] image;
+   for(int l = 1; l < int(header.levels); l++){
+      int w = (width >> (l-1)) ? width >> (l-1) : 1, h = (height >> (l-1)) ? height >> (l-1) : 1;
+      halveImage(level, w, h, level + 3*w*h);
+      level += 3*w*h;
+   }
+   
+   const void *parts[] = { &header, chain };
+   const size_t sizes[] = { sizeof(header), chainSize(width, height) };
+   bool isWritten = MappedFile::write(path, parts, sizes, 2);
+   if(!isWritten) printf("Unable to write texture cache %s\n", path);
+   delete [] chain;
+   return isWritten;
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* returns the number of mip levels of an image of the given size, down to 1x1
+ */
+int levelCount(int width, int height)
+{
+   int levels = 1;
+   
+   while(width > 1 || height > 1){
+      width = (width > 1) ? width/2 : 1;
+      height = (height > 1) ? height/2 : 1;
+      levels++;
+   }
+   return levels;
+}
+
+/* returns the number of bytes of all the mip levels of an image of the given size
+ */
+size_t chainSize(int width, int height)
+{
+   size_t bytes = 3*width*height;
+   
+   while(width > 1 || height > 1){
+      width = (width > 1) ? width/2 : 1;
+      height = (height > 1) ? height/2 : 1;
+      bytes += 3*width*height;
+   }
+   return bytes;
+}
@@ -0,0 +1,75 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: texturecache.h - Interface for the TextureCache class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+class MappedFile;
+
+/* A binary cache of the whole mip chain of a texture, kept next to the P6 PPM image it is built
+ * from so the chain need not be rebuilt at every startup. The file is a fixed header (the size and
+ * modification time of the source, and the size of the image) followed by every level from the
+ * full image down to 1x1, each as tightly packed RGB rows in the order of the PPM. It is mapped
+ * into memory rather than read, so each level can be handed to OpenGL straight from the page cache.
+ * The cache is rebuilt whenever the source no longer matches the size and time recorded in it.
+ */
+class TextureCache
+{
+public:
+   //constructor. Maps the cache at cachePath of the PPM image at source, first building it if it
+   //is missing, unreadable or stale. Check isLoaded(): a cache that cannot be written or mapped is
+   //left unloaded
+   TextureCache(const char *source, const char *cachePath);
+   //destructor. Unmaps the cache
+   ~TextureCache();
+   
+//::ACCESSORS:://
+   bool isLoaded() const { return file != 0; }
+   //returns true if the cache had to be built from the source first
+   bool wasRebuilt() const { return rebuilt; }
+   int getLevelCount() const { return levels; }
+   int getWidth(int level) const;
+   int getHeight(int level) const;
+   //returns the RGB pixels of a mip level, level 0 being the full image
+   const unsigned char *getPixels(int level) const;
+   
+//::STATIC FUNCTIONS:://
+   //reads the P6 PPM image at path into a new[] array of RGB pixels and its size. Prints why and
+   //returns 0 if it cannot
+   static unsigned char *readPPM(const char *path, int &width, int &height);
+   //writes the next mip level of an image of the given size to next: the average of each 2x2
+   //block (or pair, once a side is 1) as gluBuild2DMipmaps() takes it for a power of two size
+   static void halveImage(const unsigned char *image, int width, int height, unsigned char *next);
+   
+private:
+//::VARIABLES:://
+   //the mapped cache, or 0 if it could not be loaded
+   MappedFile *file;
+   int levels, width, height;
+   bool rebuilt;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //maps the cache at path if it matches a source of the given size and time. Returns false if not
+   bool open(const char *path, long sourceSize, long sourceTime);
+   //releases the mapping
+   void close();
+   //builds the cache at path from the PPM image at source of the given size and time. Returns
+   //false if the image cannot be read or the cache written
+   static bool build(const char *source, const char *path, long sourceSize, long sourceTime);
+   
+   //not copyable
+   TextureCache(const TextureCache &);
+   TextureCache& operator=(const TextureCache &);
+};
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,146 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: threadpool.cpp - Implementation for the ThreadPool class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L //exposes sysconf() under -ansi
+#endif
+
+#include "threadpool.h"
+#ifdef _WIN32
+#include <windows.h> //used for GetSystemInfo()
+#else
+#include <unistd.h> //used for sysconf()
+#endif
+
+//the argument handed to each worker thread
+struct WorkerArg { ThreadPool *pool; int band; };
+
+/* ThreadPool - CONSTRUCTOR
+ */
+ThreadPool::ThreadPool(int threads)
+{
+   threadCount = (threads < 1) ? 1 : threads;
+   generation = pending = jobBegin = jobEnd = 0;
+   isQuitting = false;
+   job = 0;
+   pthread_mutex_init(&lock, 0);
+   pthread_cond_init(&wake, 0);
+   pthread_cond_init(&done, 0);
+   workers = new pthread_t[threadCount];
+   for(int w = 1; w < threadCount; w++){
+      WorkerArg *arg = new WorkerArg;
+      arg->pool = this;
+      arg->band = w;
+      pthread_create(&workers[w], 0, workerMain, arg);
+   }
+}
+
+/* ThreadPool - DESTRUCTOR
+ */
+ThreadPool::~ThreadPool()
+{
+   pthread_mutex_lock(&lock);
+   isQuitting = true;
+   pthread_cond_broadcast(&wake);
+   pthread_mutex_unlock(&lock);
+   for(int w = 1; w < threadCount; w++)
+      pthread_join(workers[w], 0);
+   delete [] workers;
+   pthread_cond_destroy(&done);
+   pthread_cond_destroy(&wake);
+   pthread_mutex_destroy(&lock);
+}
+
+/* splits [begin, end) into getThreadCount() contiguous bands, runs job on every band in parallel,
+ * and returns once all of them are done
+ */
+void ThreadPool::parallelFor(Job &j, int begin, int end)
+{
+   if(threadCount == 1){
+      j.run(begin, end);
+      return;
+   }
+   pthread_mutex_lock(&lock);
+   job = &j;
+   jobBegin = begin;
+   jobEnd = end;
+   pending = threadCount-1;
+   generation++;
+   pthread_cond_broadcast(&wake);
+   pthread_mutex_unlock(&lock);
+   
+   runBand(0);
+   
+   pthread_mutex_lock(&lock);
+   while(pending > 0)
+      pthread_cond_wait(&done, &lock);
+   pthread_mutex_unlock(&lock);
+}
+
+/* returns the number of hardware threads available to this process
+ */
+int ThreadPool::hardwareThreads()
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors;
+#else
+   long count = sysconf(_SC_NPROCESSORS_ONLN);
+   return (count < 1) ? 1 : int(count);
+#endif
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* entry point of the worker threads. arg is a WorkerArg
+ */
+void *ThreadPool::workerMain(void *arg)
+{
+   WorkerArg worker = *static_cast<WorkerArg*>(arg);
+   delete static_cast<WorkerArg*>(arg);
+   worker.pool->workerLoop(worker.band);
+   return 0;
+}
+
+/* waits for jobs and runs band number band of each
+ */
+void ThreadPool::workerLoop(int band)
+{
+   int seen = 0;
+   
+   pthread_mutex_lock(&lock);
+   while(true){
+      while(generation == seen && !isQuitting)
+         pthread_cond_wait(&wake, &lock);
+      if(isQuitting) break;
+      seen = generation;
+      pthread_mutex_unlock(&lock);
+      
+      runBand(band);
+      
+      pthread_mutex_lock(&lock);
+      if(--pending == 0)
+         pthread_cond_signal(&done);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+/* runs band number band of the current job. The bands differ in size by at most one
+ */
+void ThreadPool::runBand(int band)
+{
+   int count = jobEnd - jobBegin;
+   int begin = jobBegin + (count*band)/threadCount, end = jobBegin + (count*(band+1))/threadCount;
+   if(begin < end) job->run(begin, end);
+}
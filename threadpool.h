@@ -0,0 +1,88 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: threadpool.h - Interface for the ThreadPool class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h> //used for pthread_t, pthread_mutex_t, pthread_cond_t
+
+/* A persistent pool of worker threads that splits a range of rows into contiguous bands and
+ * processes the bands in parallel. The calling thread works on the first band, so a pool of one
+ * thread starts no workers and simply runs the job inline.
+ */
+class ThreadPool
+{
+public:
+   /* A unit of work that can be split into bands of a range
+    */
+   class Job
+   {
+   public:
+      virtual ~Job() {}
+      //processes the band [begin, end)
+      virtual void run(int begin, int end) = 0;
+   };
+   
+   //constructor. Starts threads-1 workers
+   ThreadPool(int threads);
+   //destructor. Stops and joins the workers
+   ~ThreadPool();
+   
+   //splits [begin, end) into getThreadCount() contiguous bands, runs job on every band in parallel,
+   //and returns once all of them are done
+   void parallelFor(Job &job, int begin, int end);
+   
+//::ACCESSORS:://
+   int getThreadCount() const { return threadCount; }
+   
+//::STATIC FUNCTIONS:://
+   //returns the number of hardware threads available to this process
+   static int hardwareThreads();
+   
+private:
+//::VARIABLES:://
+   int threadCount, generation, pending, jobBegin, jobEnd;
+   bool isQuitting;
+   Job *job;
+   pthread_t *workers;
+   pthread_mutex_t lock;
+   pthread_cond_t wake, done;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //entry point of the worker threads. arg is a WorkerArg
+   static void *workerMain(void *arg);
+   //waits for jobs and runs band number band of each
+   void workerLoop(int band);
+   //runs band number band of the current job
+   void runBand(int band);
+   
+   //not copyable
+   ThreadPool(const ThreadPool &);
+   ThreadPool& operator=(const ThreadPool &);
+};
+
+/* Adapts a member function taking a band [begin, end) to a ThreadPool::Job
+ */
+template <class T>
+class MemberJob : public ThreadPool::Job
+{
+public:
+   MemberJob(T &obj, void (T::*func)(int, int)) : object(obj), function(func) {}
+   void run(int begin, int end) { (object.*function)(begin, end); }
+   
+private:
+   T &object;
+   void (T::*function)(int, int);
+};
+
+#endif // THREADPOOL_H
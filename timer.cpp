@@ -0,0 +1,60 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: timer.cpp - Implementation for the Timer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L //exposes clock_gettime() under -ansi
+#endif
+
+#include "timer.h"
+#ifdef _WIN32
+#include <windows.h> //used for QueryPerformanceCounter(), QueryPerformanceFrequency()
+#else
+#include <time.h> //used for clock_gettime(), CLOCK_MONOTONIC
+#endif
+
+/* Timer - CONSTRUCTOR
+ */
+Timer::Timer()
+{
+   start();
+}
+
+/* restarts the timer
+ */
+void Timer::start()
+{
+   startTime = now();
+}
+
+/* returns the number of seconds elapsed since the timer was last started
+ */
+double Timer::elapsed() const
+{
+   return now() - startTime;
+}
+
+/* returns the current value of the monotonic clock in seconds
+ */
+double Timer::now()
+{
+#ifdef _WIN32
+   LARGE_INTEGER count, freq;
+   QueryPerformanceCounter(&count);
+   QueryPerformanceFrequency(&freq);
+   return double(count.QuadPart)/double(freq.QuadPart);
+#else
+   timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec*1e-9;
+#endif
+}
@@ -0,0 +1,39 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: timer.h - Interface for the Timer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+/* A monotonic wall-clock stopwatch used to measure simulation throughput.
+ */
+class Timer
+{
+public:
+   //constructor. The timer starts running immediately
+   Timer();
+   
+   //restarts the timer
+   void start();
+   //returns the number of seconds elapsed since the timer was last started
+   double elapsed() const;
+   
+//::STATIC FUNCTIONS:://
+   //returns the current value of the monotonic clock in seconds
+   static double now();
+   
+private:
+//::VARIABLES:://
+   double startTime;
+};
+
+#endif // TIMER_H
@@ -0,0 +1,73 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: trajectory.h - The file format of recorded skirt trajectories
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+/* A trajectory file holds every recorded frame of a skirt's motion: the positions of its vertices
+ * and, optionally, their normals. It is laid out as
+ *    TrajectoryHeader
+ *    chunks, each a TrajectoryChunk followed by its frames
+ *    the file offset of each chunk, as longs
+ *    TrajectoryTrailer
+ * Within a chunk every coordinate is quantized to an integer in [0, TRAJECTORY_LEVELS]: positions
+ * over the bounding box of the chunk, normals over [-1, 1]. The first frame of a chunk (its key
+ * frame) holds each quantized value as an unsigned short. Every later frame predicts each value
+ * from the frames before it: as the value of the frame before for the second frame, and as that
+ * value moved on by its change over the two frames before for the rest. Neighbouring vertices
+ * tend to miss their predictions alike, so what is stored, as a zigzag encoded varint (7 bits a
+ * byte, low bits first), is the residual: how much more a value missed than the one listed
+ * before it. That is one byte when less than 64 steps. A frame lists x of every vertex row by
+ * row, then y, then z, then the normals in the same order; each of the six lists starts afresh.
+ * Any frame is decoded from the key frame of its chunk, so the index gives random access at the
+ * cost of at most chunkFrames-1 delta frames.
+ * A file whose recorder did not finish has no index or trailer, but its complete chunks can still
+ * be read one after another.
+ */
+
+//the largest quantized value: the step is 1/TRAJECTORY_LEVELS of the range quantized over
+const int TRAJECTORY_LEVELS = 65535;
+//the range normals are quantized over
+const float TRAJECTORY_NORMAL_MIN = -1, TRAJECTORY_NORMAL_MAX = 1;
+//marks the start and the end of a file, and its byte order
+static const char TRAJECTORY_MAGIC[8] = { 'S', 'K', 'T', 'R', 'A', 'J', '0', '1' };
+const unsigned int TRAJECTORY_BYTE_ORDER = 0x01020304;
+
+struct TrajectoryHeader
+{
+   char magic[8];
+   unsigned int byteOrder;
+   int xRes, yRes;
+   //explicit steps from one frame to the next, and 1 if normals are stored
+   int stepsPerFrame, hasNormals;
+   //frames per chunk, but for the last
+   int chunkFrames;
+};
+
+struct TrajectoryChunk
+{
+   int firstFrame, frameCount;
+   //the bounding box of the positions of the chunk's frames
+   float min[3], max[3];
+   //the bytes of the frames that follow
+   unsigned int bytes;
+};
+
+struct TrajectoryTrailer
+{
+   long indexOffset;
+   int chunkCount, frameCount;
+   char magic[8];
+};
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,267 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: trajectoryplayer.cpp - Implementation for the TrajectoryPlayer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "trajectoryplayer.h"
+#include "skirt.h"
+#include "mappedfile.h"
+#include <cstring> //used for memcpy(), memcmp() and memset()
+#include <algorithm> //used for swap()
+
+using namespace std;
+
+//decodes count values of frame f of a chunk from in, which ends at end, as encodeValues() of the
+//recorder wrote them: unsigned shorts for the key frame, otherwise zigzag varints of residuals
+//(see trajectory.h). last and previous hold the values of the two frames before, and are updated.
+//Returns the position after them
+static const unsigned char *decodeValues(const unsigned char *in, const unsigned char *end,
+                                         int count, int f, unsigned short *last,
+                                         unsigned short *previous);
+
+/* TrajectoryPlayer - CONSTRUCTOR
+ */
+TrajectoryPlayer::TrajectoryPlayer(const char *path)
+{
+   file = new MappedFile(path);
+   memset(&header, 0, sizeof(header));
+   vertexCount = valueCount = frameCount = chunkCount = 0;
+   index = 0;
+   chunkNumber = decoded = loaded = -1;
+   cursor = chunkEnd = 0;
+   last = previous = 0;
+   loadedInto = 0;
+   decodedFrames = 0;
+   
+   if(!file->isOpen() || file->getSize() < sizeof(header)) return;
+   memcpy(&header, file->getData(), sizeof(header));
+   if(memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) ||
+      header.byteOrder != TRAJECTORY_BYTE_ORDER || header.xRes < 3 || header.yRes < 3 ||
+      header.stepsPerFrame < 1 || header.chunkFrames < 1)
+      return;
+   vertexCount = header.xRes*header.yRes;
+   valueCount = (header.hasNormals ? 6 : 3)*vertexCount;
+   if(!readIndex()) scanChunks();
+   last = new unsigned short[valueCount];
+   previous = new unsigned short[valueCount];
+}
+
+/* TrajectoryPlayer - DESTRUCTOR
+ */
+TrajectoryPlayer::~TrajectoryPlayer()
+{
+   delete file;
+   delete [] index;
+   delete [] last;
+   delete [] previous;
+}
+
+/* returns the frame to load to show the motion step explicit steps into the recording, and in
+ * alpha how far between the frame before it and that frame the step is. A step on a recorded frame
+ * loads the frame after it at alpha 0, so playing on from there decodes only the next frame
+ */
+int TrajectoryPlayer::frameAt(double step, GLfloat &alpha) const
+{
+   double position = step/header.stepsPerFrame;
+   
+   alpha = 1;
+   if(position <= 0) return 0;
+   if(position >= frameCount - 1) return frameCount - 1;
+   int f = int(position) + 1;
+   alpha = GLfloat(position - (f - 1));
+   return f;
+}
+
+/* loads recorded frame f into frame as the state after the last update and frame f-1 as the one
+ * before it. Playing on to the next frame swaps the two states and decodes the new one only;
+ * anything else decodes both, from the key frame of their chunk if need be
+ */
+void TrajectoryPlayer::loadFrame(int f, const Skirt &skirt, SkirtFrame &frame)
+{
+   f = (f < 0) ? 0 : (f >= frameCount) ? frameCount - 1 : f;
+   if(&frame == loadedInto && f == loaded) return;
+   
+   if(&frame == loadedInto && f == loaded + 1){
+      swap(frame.position, frame.lastPosition);
+      swap(frame.normals, frame.lastNormals);
+   }
+   else{
+      decode((f > 0) ? f - 1 : 0);
+      dequantize(skirt, frame.lastPosition, frame.lastNormals);
+      if(!header.hasNormals) skirt.calcNormals(frame.lastPosition, frame.lastNormals);
+   }
+   decode(f);
+   dequantize(skirt, frame.position, frame.normals);
+   if(!header.hasNormals) skirt.calcNormals(frame.position, frame.normals);
+   loaded = f;
+   loadedInto = &frame;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* reads the index at the end of the file and checks every chunk it points to. Returns false if
+ * the file has no trailer, or the index does not fit the file or the chunks
+ */
+bool TrajectoryPlayer::readIndex()
+{
+   const unsigned char *data = file->getData();
+   const size_t size = file->getSize();
+   TrajectoryTrailer trailer;
+   
+   if(size < sizeof(header) + sizeof(trailer)) return false;
+   memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+   if(memcmp(trailer.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) ||
+      trailer.chunkCount < 1 || trailer.indexOffset < long(sizeof(header)) ||
+      size_t(trailer.indexOffset) + trailer.chunkCount*sizeof(long) + sizeof(trailer) != size)
+      return false;
+   
+   index = new long[trailer.chunkCount];
+   memcpy(index, data + trailer.indexOffset, trailer.chunkCount*sizeof(long));
+   int frames = 0;
+   for(int c = 0; c < trailer.chunkCount; c++){
+      TrajectoryChunk info;
+      if(!readChunk(index[c], frames, info)) break;
+      frames += info.frameCount;
+   }
+   if(frames != trailer.frameCount){
+      delete [] index;
+      index = 0;
+      return false;
+   }
+   chunkCount = trailer.chunkCount;
+   frameCount = frames;
+   return true;
+}
+
+/* finds the complete chunks of the file one after another from the header on, as an unfinished
+ * recording leaves them, and indexes them
+ */
+void TrajectoryPlayer::scanChunks()
+{
+   int capacity = 64;
+   long offset = sizeof(header);
+   TrajectoryChunk info;
+   
+   index = new long[capacity];
+   while(readChunk(offset, frameCount, info)){
+      if(chunkCount == capacity){
+         long *grown = new long[2*capacity];
+         memcpy(grown, index, chunkCount*sizeof(long));
+         delete [] index;
+         index = grown;
+         capacity *= 2;
+      }
+      index[chunkCount++] = offset;
+      frameCount += info.frameCount;
+      offset += sizeof(info) + info.bytes;
+   }
+}
+
+/* reads the chunk at offset into info. Every chunk but the last holds chunkFrames frames, so
+ * frame f is in chunk f/chunkFrames. Returns false if the chunk does not fit in the file or does
+ * not hold the frames from firstFrame on
+ */
+bool TrajectoryPlayer::readChunk(long offset, int firstFrame, TrajectoryChunk &info) const
+{
+   const size_t size = file->getSize();
+   
+   if(offset < long(sizeof(header)) || size_t(offset) + sizeof(info) > size) return false;
+   memcpy(&info, file->getData() + offset, sizeof(info));
+   return info.firstFrame == firstFrame && firstFrame%header.chunkFrames == 0 &&
+          info.frameCount >= 1 && info.frameCount <= header.chunkFrames &&
+          info.bytes <= size - offset - sizeof(info);
+}
+
+/* decodes the quantized values of frame f into last: onward from the frame decoded last if it is
+ * before f in the same chunk, otherwise from the key frame of f's chunk
+ */
+void TrajectoryPlayer::decode(int f)
+{
+   int c = f/header.chunkFrames;
+   
+   if(c != chunkNumber || f < decoded){
+      const unsigned char *start = file->getData() + index[c];
+      memcpy(&chunk, start, sizeof(chunk));
+      cursor = start + sizeof(chunk);
+      chunkEnd = cursor + chunk.bytes;
+      chunkNumber = c;
+      decoded = chunk.firstFrame - 1;
+   }
+   while(decoded < f){
+      int k = ++decoded - chunk.firstFrame;
+      for(int p = 0; p < valueCount/vertexCount; p++)
+         cursor = decodeValues(cursor, chunkEnd, vertexCount, k, last + p*vertexCount,
+                               previous + p*vertexCount);
+      decodedFrames++;
+   }
+}
+
+/* writes the values decoded last into positions and normals, laid out as skirt's: every row is
+ * stride floats apart, the recording's rows are not padded. The positions are quantized over the
+ * bounding box of the chunk, the normals over their fixed range
+ */
+void TrajectoryPlayer::dequantize(const Skirt &skirt, VectorArray &positions,
+                                  VectorArray &normals) const
+{
+   float *planes[] = { positions.x, positions.y, positions.z, normals.x, normals.y, normals.z };
+   const int xRes = header.xRes, stride = skirt.getStride();
+   
+   for(int p = 0; p < valueCount/vertexCount; p++){
+      float min = (p < 3) ? chunk.min[p] : TRAJECTORY_NORMAL_MIN;
+      float max = (p < 3) ? chunk.max[p] : TRAJECTORY_NORMAL_MAX;
+      float step = (max - min)/TRAJECTORY_LEVELS;
+      const unsigned short *values = last + p*vertexCount;
+      for(int j = 0; j < header.yRes; j++)
+         for(int i = 0; i < xRes; i++)
+            planes[p][j*stride + i] = min + step*values[j*xRes + i];
+   }
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* decodes count values of frame f of a chunk from in, which ends at end, as encodeValues() of the
+ * recorder wrote them. Each value is the prediction from the frames before, corrected by the miss
+ * of the value before it plus its own residual. A damaged chunk decodes to garbage within the
+ * quantized range, never past end. Returns the position after the values
+ */
+const unsigned char *decodeValues(const unsigned char *in, const unsigned char *end, int count,
+                                  int f, unsigned short *last, unsigned short *previous)
+{
+   int missBefore = 0;
+   
+   for(int v = 0; v < count; v++){
+      int q = 0;
+      if(f == 0){
+         unsigned short value = 0;
+         if(end - in >= int(sizeof(value))){
+            memcpy(&value, in, sizeof(value));
+            in += sizeof(value);
+         }
+         q = value;
+      }
+      else{
+         unsigned int zigzag = 0;
+         for(int shift = 0; in < end && shift < 32; shift += 7){
+            unsigned char byte = *in++;
+            zigzag |= unsigned(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) break;
+         }
+         int residual = (zigzag & 1) ? -int((zigzag - 1)/2) - 1 : int(zigzag/2);
+         int miss = missBefore + residual;
+         q = miss + ((f == 1) ? last[v] : 2*last[v] - previous[v]);
+         q = (q < 0) ? 0 : (q > TRAJECTORY_LEVELS) ? TRAJECTORY_LEVELS : q;
+         missBefore = miss;
+      }
+      previous[v] = last[v];
+      last[v] = q;
+   }
+   return in;
+}
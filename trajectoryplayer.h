@@ -0,0 +1,101 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: trajectoryplayer.h - Interface for the TrajectoryPlayer class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TRAJECTORYPLAYER_H
+#define TRAJECTORYPLAYER_H
+
+#include "trajectory.h"
+#include <GL/gl.h> //used for GLfloat
+
+class Skirt;
+class MappedFile;
+struct SkirtFrame;
+struct VectorArray;
+
+/* Plays back a trajectory file written by a TrajectoryRecorder (see trajectory.h) without
+ * simulating anything. The file is mapped into memory and its frames are decoded only when asked
+ * for: onward from the frame decoded last when playing forwards, otherwise from the key frame of
+ * the chunk the chunk index points to, so seeking anywhere costs at most one chunk's delta frames.
+ * Frames are loaded into a SkirtFrame of a Skirt of the recorded resolution and drawn as the
+ * simulation's are
+ */
+class TrajectoryPlayer
+{
+public:
+   //constructor. Maps the trajectory at path and reads its chunk index, or finds its complete
+   //chunks if the recording was not finished; check isOpen()
+   TrajectoryPlayer(const char *path);
+   //destructor. Unmaps the file
+   ~TrajectoryPlayer();
+   
+   //returns the frame to load to show the motion step explicit steps into the recording, and in
+   //alpha how far between the frame before it and that frame the step is. Steps past either end
+   //show the first or the last frame
+   int frameAt(double step, GLfloat &alpha) const;
+   //loads recorded frame f into frame as the state after the last update and frame f-1 (f itself
+   //for the first) as the one before it, for drawing between them. The normals are calculated by
+   //skirt, of the recorded resolution, if they were not recorded. frame is taken to hold what the
+   //last call loaded into it, so playing on to the next frame decodes only that one
+   void loadFrame(int f, const Skirt &skirt, SkirtFrame &frame);
+   
+//::ACCESSORS:://
+   bool isOpen() const { return frameCount > 0; }
+   int getXRes() const { return header.xRes; }
+   int getYRes() const { return header.yRes; }
+   int getStepsPerFrame() const { return header.stepsPerFrame; }
+   bool getHasNormals() const { return header.hasNormals != 0; }
+   int getFrameCount() const { return frameCount; }
+   //returns the explicit steps from the first frame to the last
+   double getSteps() const { return double(frameCount - 1)*header.stepsPerFrame; }
+   //returns the frames decoded so far, counting each time a frame is decoded again
+   long getDecodedFrames() const { return decodedFrames; }
+   
+private:
+//::VARIABLES:://
+   MappedFile *file;
+   TrajectoryHeader header;
+   int vertexCount, valueCount, frameCount, chunkCount;
+   //the offset of each chunk in the file
+   long *index;
+   //the chunk being decoded, the next of its frames' bytes, and the frame its values are of
+   TrajectoryChunk chunk;
+   int chunkNumber, decoded;
+   const unsigned char *cursor, *chunkEnd;
+   //the quantized values of the frame decoded last and of the one before it
+   unsigned short *last, *previous;
+   //the frame loadFrame() last loaded, and where to
+   int loaded;
+   const SkirtFrame *loadedInto;
+   long decodedFrames;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //reads the index at the end of the file. Returns false if it has none or it does not fit
+   bool readIndex();
+   //finds the complete chunks of the file one after another, as an unfinished recording leaves
+   //them
+   void scanChunks();
+   //reads the chunk at offset into info. Returns false if it does not fit in the file or does not
+   //hold the frames from firstFrame on
+   bool readChunk(long offset, int firstFrame, TrajectoryChunk &info) const;
+   //decodes the quantized values of frame f into last
+   void decode(int f);
+   //writes the values decoded last into positions and normals, laid out as skirt's, or into
+   //positions only if the normals were not recorded
+   void dequantize(const Skirt &skirt, VectorArray &positions, VectorArray &normals) const;
+   
+   //not copyable
+   TrajectoryPlayer(const TrajectoryPlayer &);
+   TrajectoryPlayer& operator=(const TrajectoryPlayer &);
+};
+
+#endif // TRAJECTORYPLAYER_H
@@ -0,0 +1,282 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: trajectoryrecorder.cpp - Implementation for the TrajectoryRecorder class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#include "trajectoryrecorder.h"
+#include "skirt.h"
+#include "timer.h"
+#include <cstring> //used for memcpy()
+
+const int TrajectoryRecorder::DEFAULT_SLOTS = 64, TrajectoryRecorder::DEFAULT_CHUNK_FRAMES = 16;
+
+//appends count values of frame f of a chunk, quantized over [min, max], to out: as unsigned shorts
+//for the key frame, otherwise as zigzag varints of their residuals (see trajectory.h). last and
+//previous hold the values of the two frames before, and are updated. Returns the new end of out
+static unsigned char *encodeValues(const float *values, int count, float min, float max, int f,
+                                   unsigned short *last, unsigned short *previous,
+                                   unsigned char *out);
+
+/* TrajectoryRecorder - CONSTRUCTOR
+ */
+TrajectoryRecorder::TrajectoryRecorder(const char *path, const Skirt &skirt, int interval,
+                                       bool hasNormals, int slotCount, int chunkFrames) :
+                                       interval(interval), slotCount(slotCount),
+                                       vertexCount(skirt.getVertexCount()),
+                                       valueCount((hasNormals ? 6 : 3)*skirt.getVertexCount())
+{
+   memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+   header.byteOrder = TRAJECTORY_BYTE_ORDER;
+   header.xRes = skirt.getXRes();
+   header.yRes = skirt.getYRes();
+   header.stepsPerFrame = interval*skirt.getStepsPerUpdate();
+   header.hasNormals = hasNormals;
+   header.chunkFrames = chunkFrames;
+   offered = frames = 0;
+   bytes = 0;
+   recordSeconds = waitSeconds = 0;
+   slots = new float*[slotCount];
+   for(int s = 0; s < slotCount; s++) slots[s] = new float[valueCount];
+   head = tail = queued = 0;
+   isRunning = isQuitting = isFailed = false;
+   chunk = new float[chunkFrames*valueCount];
+   chunkCount = 0;
+   last = new unsigned short[valueCount];
+   previous = new unsigned short[valueCount];
+   //a key frame takes 2 bytes a value and a varint of a difference at most 3
+   encoded = new unsigned char[3*chunkFrames*valueCount];
+   indexCapacity = 64;
+   index = new long[indexCapacity];
+   chunks = written = 0;
+   
+   out = fopen(path, "wb");
+   if(!out) return;
+   write(&header, sizeof(header));
+   pthread_mutex_init(&lock, 0);
+   pthread_cond_init(&wake, 0);
+   pthread_cond_init(&space, 0);
+   isRunning = !pthread_create(&thread, 0, threadMain, this);
+}
+
+/* TrajectoryRecorder - DESTRUCTOR
+ */
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+   bool isOpened = out != 0;
+   
+   finish();
+   if(isOpened){
+      pthread_cond_destroy(&space);
+      pthread_cond_destroy(&wake);
+      pthread_mutex_destroy(&lock);
+   }
+   for(int s = 0; s < slotCount; s++) delete [] slots[s];
+   delete [] slots;
+   delete [] chunk;
+   delete [] last;
+   delete [] previous;
+   delete [] encoded;
+   delete [] index;
+}
+
+/* offers the state of the skirt after a step; every interval-th one is copied into the next free
+ * slot and queued for the writing thread. Without a writing thread the frame is added at once
+ */
+void TrajectoryRecorder::record(const Skirt &skirt)
+{
+   if(!out || (offered++)%interval) return;
+   Timer timer;
+   
+   pthread_mutex_lock(&lock);
+   while(queued == slotCount) pthread_cond_wait(&space, &lock);
+   float *slot = slots[head];
+   pthread_mutex_unlock(&lock);
+   waitSeconds += timer.elapsed();
+   
+   //the rows are copied without their padding
+   const VectorArray &position = skirt.getPositions(), &normals = skirt.getNormals();
+   const float *planes[] = { position.x, position.y, position.z, normals.x, normals.y, normals.z };
+   const int xRes = header.xRes, stride = skirt.getStride();
+   for(int c = 0; c < valueCount/vertexCount; c++)
+      for(int j = 0; j < header.yRes; j++)
+         memcpy(slot + c*vertexCount + j*xRes, planes[c] + j*stride, xRes*sizeof(float));
+   frames++;
+   
+   if(!isRunning) addFrame(slot);
+   else{
+      pthread_mutex_lock(&lock);
+      head = (head + 1)%slotCount;
+      //the writer is woken once there is a chunk to write, not for every frame
+      if(++queued == header.chunkFrames || queued == slotCount) pthread_cond_signal(&wake);
+      pthread_mutex_unlock(&lock);
+   }
+   recordSeconds += timer.elapsed();
+}
+
+/* waits until every queued frame is written, then writes the last chunk, the index and the trailer
+ * and closes the file
+ */
+void TrajectoryRecorder::finish()
+{
+   if(isRunning){
+      pthread_mutex_lock(&lock);
+      isQuitting = true;
+      pthread_cond_signal(&wake);
+      pthread_mutex_unlock(&lock);
+      pthread_join(thread, 0);
+      isRunning = false;
+   }
+   if(!out) return;
+   if(chunkCount) writeChunk();
+   
+   TrajectoryTrailer trailer;
+   trailer.indexOffset = bytes;
+   trailer.chunkCount = chunks;
+   trailer.frameCount = written;
+   memcpy(trailer.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+   write(index, chunks*sizeof(long));
+   write(&trailer, sizeof(trailer));
+   if(fclose(out)) isFailed = true;
+   out = 0;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* entry point of the writing thread. arg is the TrajectoryRecorder
+ */
+void *TrajectoryRecorder::threadMain(void *arg)
+{
+   static_cast<TrajectoryRecorder*>(arg)->run();
+   return 0;
+}
+
+/* gathers queued frames into chunks and writes them until finish(). Once the queue is empty it
+ * sleeps until a chunk's worth is queued, then takes every queued frame. The lock is released while
+ * a frame is added, so the simulating thread can fill and queue other slots meanwhile
+ */
+void TrajectoryRecorder::run()
+{
+   pthread_mutex_lock(&lock);
+   for(;;){
+      if(!queued)
+         while(queued < header.chunkFrames && queued < slotCount && !isQuitting)
+            pthread_cond_wait(&wake, &lock);
+      if(!queued) break;
+      const float *slot = slots[tail];
+      pthread_mutex_unlock(&lock);
+      
+      addFrame(slot);
+      
+      pthread_mutex_lock(&lock);
+      tail = (tail + 1)%slotCount;
+      queued--;
+      pthread_cond_signal(&space);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+/* adds the values of a frame to the chunk, writing the chunk once full
+ */
+void TrajectoryRecorder::addFrame(const float *values)
+{
+   memcpy(chunk + chunkCount*valueCount, values, valueCount*sizeof(float));
+   if(++chunkCount == header.chunkFrames) writeChunk();
+}
+
+/* quantizes, encodes and writes the chunk gathered so far: the positions over the bounding box of
+ * all its frames, so the box is written once for the chunk, and the normals over their fixed range
+ */
+void TrajectoryRecorder::writeChunk()
+{
+   TrajectoryChunk info;
+   
+   info.firstFrame = written;
+   info.frameCount = chunkCount;
+   for(int c = 0; c < 3; c++){
+      info.min[c] = info.max[c] = chunk[c*vertexCount];
+      for(int f = 0; f < chunkCount; f++){
+         const float *plane = chunk + f*valueCount + c*vertexCount;
+         for(int v = 0; v < vertexCount; v++){
+            if(plane[v] < info.min[c]) info.min[c] = plane[v];
+            if(plane[v] > info.max[c]) info.max[c] = plane[v];
+         }
+      }
+   }
+   unsigned char *end = encoded;
+   for(int f = 0; f < chunkCount; f++){
+      for(int c = 0; c < valueCount/vertexCount; c++){
+         float min = (c < 3) ? info.min[c] : TRAJECTORY_NORMAL_MIN;
+         float max = (c < 3) ? info.max[c] : TRAJECTORY_NORMAL_MAX;
+         end = encodeValues(chunk + f*valueCount + c*vertexCount, vertexCount, min, max, f,
+                            last + c*vertexCount, previous + c*vertexCount, end);
+      }
+   }
+   info.bytes = end - encoded;
+   
+   if(chunks == indexCapacity){
+      long *grown = new long[2*indexCapacity];
+      memcpy(grown, index, chunks*sizeof(long));
+      delete [] index;
+      index = grown;
+      indexCapacity *= 2;
+   }
+   index[chunks++] = bytes;
+   write(&info, sizeof(info));
+   write(encoded, info.bytes);
+   written += chunkCount;
+   chunkCount = 0;
+}
+
+/* writes size bytes to the file, noting a failure
+ */
+void TrajectoryRecorder::write(const void *data, size_t size)
+{
+   if(fwrite(data, 1, size, out) != size) isFailed = true;
+   bytes += size;
+}
+
+//::STATIC FUNCTIONS:://////////////////////////////////////////////////////////////////////////////
+
+/* appends count values of frame f of a chunk, quantized over [min, max], to out: as unsigned shorts
+ * for the key frame, otherwise as zigzag varints of their residuals (see trajectory.h), so the
+ * small residuals of smooth motion take one byte whatever their sign. last and previous hold the
+ * values of the two frames before, and are updated. Returns the new end of out
+ */
+unsigned char *encodeValues(const float *values, int count, float min, float max, int f,
+                            unsigned short *last, unsigned short *previous, unsigned char *out)
+{
+   const float scale = (max > min) ? TRAJECTORY_LEVELS/(max - min) : 0;
+   int missBefore = 0;
+   
+   for(int v = 0; v < count; v++){
+      int q = int((values[v] - min)*scale + 0.5f);
+      q = (q < 0) ? 0 : (q > TRAJECTORY_LEVELS) ? TRAJECTORY_LEVELS : q;
+      if(f == 0){
+         unsigned short value = q;
+         memcpy(out, &value, sizeof(value));
+         out += sizeof(value);
+      }
+      else{
+         int miss = q - ((f == 1) ? last[v] : 2*last[v] - previous[v]);
+         int residual = miss - missBefore;
+         unsigned int zigzag = (residual < 0) ? 2*unsigned(-residual) - 1 : 2*unsigned(residual);
+         while(zigzag >= 0x80){
+            *out++ = (zigzag & 0x7f) | 0x80;
+            zigzag >>= 7;
+         }
+         *out++ = zigzag;
+         missBefore = miss;
+      }
+      previous[v] = last[v];
+      last[v] = q;
+   }
+   return out;
+}
@@ -0,0 +1,101 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: trajectoryrecorder.h - Interface for the TrajectoryRecorder class
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include "trajectory.h"
+#include <cstdio> //used for FILE
+#include <pthread.h> //used for pthread_t, pthread_mutex_t, pthread_cond_t
+
+class Skirt;
+
+/* Records the motion of a skirt to a trajectory file (see trajectory.h) for other tools, or for
+ * playback. The simulating thread only copies every interval-th state offered to record() into a
+ * fixed ring of slots; a thread of its own gathers them into chunks, quantizes and delta encodes
+ * each chunk and writes it. The simulation waits only when every slot is still queued, i.e. when
+ * the disk cannot keep up on average
+ */
+class TrajectoryRecorder
+{
+public:
+   //the slots of the ring and the frames of a chunk unless given otherwise
+   static const int DEFAULT_SLOTS, DEFAULT_CHUNK_FRAMES;
+   
+   //constructor. Records every interval-th state of the skirt offered to record() to path, with
+   //the normals if hasNormals. Starts the writing thread; check isOpen()
+   TrajectoryRecorder(const char *path, const Skirt &skirt, int interval, bool hasNormals,
+                      int slotCount = DEFAULT_SLOTS, int chunkFrames = DEFAULT_CHUNK_FRAMES);
+   //destructor. Finishes the file
+   ~TrajectoryRecorder();
+   
+   //offers the state of the skirt after a step; every interval-th one is recorded
+   void record(const Skirt &skirt);
+   //waits until every queued frame is written, then writes the index and closes the file
+   void finish();
+   
+//::ACCESSORS:://
+   bool isOpen() const { return out != 0; }
+   int getFrames() const { return frames; }
+   //returns the bytes written so far, header and index included once finished
+   long getBytes() const { return bytes; }
+   //returns the time the simulating thread spent in record() copying states, and of that the
+   //time it waited for a free slot
+   double getRecordSeconds() const { return recordSeconds; }
+   double getWaitSeconds() const { return waitSeconds; }
+   bool getFailed() const { return isFailed; }
+   
+private:
+//::VARIABLES:://
+   FILE *out;
+   TrajectoryHeader header;
+   const int interval, slotCount, vertexCount, valueCount;
+   int offered, frames;
+   long bytes;
+   double recordSeconds, waitSeconds;
+   //each slot holds the positions, x then y then z, followed by the normals if recorded
+   float **slots;
+   //the next slot to fill, the next to write and the number queued, guarded by lock
+   int head, tail, queued;
+   bool isRunning, isQuitting, isFailed;
+   pthread_t thread;
+   pthread_mutex_t lock;
+   pthread_cond_t wake, space;
+   //the frames of the chunk being gathered by the writing thread, the quantized values of the two
+   //frames before, and the encoded chunk
+   float *chunk;
+   int chunkCount;
+   unsigned short *last, *previous;
+   unsigned char *encoded;
+   //the offsets of the chunks written, and the frames written in them
+   long *index;
+   int indexCapacity, chunks, written;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //entry point of the writing thread. arg is the TrajectoryRecorder
+   static void *threadMain(void *arg);
+   //gathers queued frames into chunks and writes them until finish()
+   void run();
+   //adds the values of a frame to the chunk, writing the chunk once full
+   void addFrame(const float *values);
+   //quantizes, encodes and writes the chunk gathered so far
+   void writeChunk();
+   //writes size bytes to the file, noting a failure
+   void write(const void *data, size_t size);
+   
+   //not copyable
+   TrajectoryRecorder(const TrajectoryRecorder &);
+   TrajectoryRecorder& operator=(const TrajectoryRecorder &);
+};
+
+#endif // TRAJECTORYRECORDER_H
@@ -0,0 +1,94 @@
+/* Author: Arash Ghodsi (aghodsi)
+   Class: CMPS161 - Animation & Visualization
+   Term: Winter 2011
+   File: triplebuffer.h - The TripleBuffer class template
+   prog3: Simulate a hula skirt using physically based animation. The animation is generated using
+          Hooke's law for springs on the edges of the triangle mesh skirt, and rotation quaternions
+          or versors for the oscillatory motion.
+          The user can control the amplitude and frequency of the oscillation and whether the motion
+          is 2-dimensional about the z-axis or 3-dimensional about both the x-axis and z-axis,
+          independently. Finally, the user can switch in and out of wireframe rendering. Please see
+          the README for controls.
+ */
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+/* Hands the latest of a stream of values from one producer thread to one consumer thread without
+ * locks or copies. Of the three buffers, the producer writes one (the back), the consumer reads one
+ * (the front), and the third (the middle) holds the latest published value. Publishing swaps the
+ * back with the middle; acquiring swaps the front with the middle if it holds a value the consumer
+ * has not seen. Neither side ever waits for the other, and values the consumer was too slow to
+ * see are simply overwritten.
+ * The swaps are atomic compare-and-swaps, which are also full memory barriers, so a value is
+ * completely written before the consumer can acquire it.
+ */
+template <class T>
+class TripleBuffer
+{
+public:
+   //constructor
+   TripleBuffer() : front(0), back(1), middle(2) {}
+   
+   //returns buffer i (0 to 2) regardless of its role, for setting the buffers up before use
+   T &getBuffer(int i) { return buffers[i]; }
+   
+//::PRODUCER:://
+   //returns the buffer the producer writes the next value into
+   T &getBack() { return buffers[back]; }
+   //publishes the back buffer as the latest value and takes over a free buffer as the new back
+   void publish() { back = exchange(back | FRESH) & INDEX; }
+   
+//::CONSUMER:://
+   //makes the latest published value the front buffer if the consumer has not seen it yet.
+   //Returns true if it did
+   bool acquire();
+   //returns the buffer the consumer reads; the latest value as of the last acquire()
+   const T &getFront() const { return buffers[front]; }
+   
+private:
+//::CONSTANTS:://
+   //middle holds a buffer index in its low bits and FRESH while it holds an unseen value
+   enum { INDEX = 3, FRESH = 4 };
+   
+//::VARIABLES:://
+   T buffers[3];
+   int front, back;
+   volatile int middle;
+   
+//::PRIVATE MEMBER FUNCTIONS:://
+   //atomically replaces middle with value and returns what it held
+   int exchange(int value);
+   
+   //not copyable
+   TripleBuffer(const TripleBuffer &);
+   TripleBuffer& operator=(const TripleBuffer &);
+};
+
+/* makes the latest published value the front buffer if the consumer has not seen it yet. Returns
+ * true if it did. Only the producer can change the middle in between, and only to a fresh value, so
+ * the check need not be part of the swap
+ */
+template <class T>
+bool TripleBuffer<T>::acquire()
+{
+   if(!(__sync_fetch_and_add(&middle, 0) & FRESH)) return false;
+   front = exchange(front) & INDEX;
+   return true;
+}
+
+//::PRIVATE MEMBER FUNCTIONS:://////////////////////////////////////////////////////////////////////
+
+/* atomically replaces middle with value and returns what it held
+ */
+template <class T>
+int TripleBuffer<T>::exchange(int value)
+{
+   int old;
+   
+   do old = __sync_fetch_and_add(&middle, 0);
+   while(__sync_val_compare_and_swap(&middle, old, value) != old);
+   return old;
+}
+
+#endif // TRIPLEBUFFER_H